@@ -1,6 +1,27 @@
 #include <benchmark/benchmark.h>
 
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+#include "../gradient_field.h"
+#include "../grid_file.h"
+#include "../huge_page_allocator.h"
+#include "../reduced_precision_field.h"
+#include "../sparse_field.h"
 #include "../spherical_volume_rendering_util.h"
+#include "../spherical_voxel_field.h"
+#include "../transfer_function.h"
 
 // Benchmarking for the spherical coordinate voxel traversal algorithm.
 // Utilises the Google Benchmark library.
@@ -61,6 +82,399 @@ void inline orthographicTraverseXSquaredRaysinYCubedVoxels(
   }
 }
 
+// Traverses the same orthographic projection as above as a single image. This
+// view is mirror symmetric across both the XZ and YZ planes, so with
+// EXPLOIT_MIRROR_SYMMETRY only a quarter of the rays are traversed.
+void inline orthographicImageXSquaredRaysinYCubedVoxels(
+    const std::size_t X, const std::size_t Y,
+    svr::ImageTraversalMode mode) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const svr::OrthographicImage image = {
+      .image_center = BoundVec3(0.0, 0.0, -(sphere_max_radius + 1.0)),
+      .horizontal = FreeVec3(2000.0, 0.0, 0.0),
+      .vertical = FreeVec3(0.0, 2000.0, 0.0),
+      .direction = UnitVec3(0.0, 0.0, 1.0),
+      .width = X,
+      .height = X};
+  const auto pixels = svr::walkOrthographicImage(image, grid, 1.0, mode);
+  benchmark::DoNotOptimize(pixels.data());
+}
+
+// Sends X^2 rays with uniformly random origins and directions within the
+// bounding box of a Y^3 voxel sphere. Since consecutive rays are incoherent,
+// this is used to compare traversal in input and coherent ray order.
+void inline randomBatchTraverseXSquaredRaysinYCubedVoxels(
+    const std::size_t X, const std::size_t Y,
+    svr::RayOrdering ordering) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-sphere_max_radius,
+                                                sphere_max_radius);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  RayBatch rays;
+  rays.reserve(X * X);
+  for (std::size_t i = 0; i < X * X; ++i) {
+    rays.push_back(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        FreeVec3(direction(generator), direction(generator),
+                 direction(generator)));
+  }
+  const auto voxels =
+      svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0, ordering);
+  benchmark::DoNotOptimize(voxels.data());
+}
+
+// Sends X^2 perspective rays with a 90 degree field of view through a Y^3
+// voxel sphere. The camera lies 5 sphere radii from the sphere center, so most
+// rays miss the sphere. If cull_misses is true, the missing rays are first
+// rejected with raysIntersectingGrid(). Otherwise, every ray is traversed.
+void inline wideFieldOfViewTraverseXSquaredRaysinYCubedVoxels(
+    const std::size_t X, const std::size_t Y, bool cull_misses) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const BoundVec3 camera(0.0, 0.0, -5.0 * sphere_max_radius);
+  RayBatch rays;
+  rays.reserve(X * X);
+  for (std::size_t i = 0; i < X; ++i) {
+    for (std::size_t j = 0; j < X; ++j) {
+      rays.push_back(camera, FreeVec3(2.0 * (i + 0.5) / X - 1.0,
+                                      2.0 * (j + 0.5) / X - 1.0, 1.0));
+    }
+  }
+  std::vector<std::size_t> ray_indices(rays.size());
+  std::iota(ray_indices.begin(), ray_indices.end(), 0);
+  const auto voxels =
+      cull_misses
+          ? svr::walkSphericalVolumeBatch(rays, grid, 1.0)
+          : svr::walkSphericalVolumeBatch(rays, ray_indices, grid, 1.0);
+  benchmark::DoNotOptimize(voxels.data());
+}
+
+// Sends X^2 orthographic rays through a Y^3 voxel sphere as a single batch.
+// If interleave is true, the rays are traversed with
+// walkSphericalVolumeInterleaved(). Otherwise, they are traversed one at a
+// time with walkSphericalVolumeBatch().
+void inline orthographicBatchTraverseXSquaredRaysinYCubedVoxels(
+    const std::size_t X, const std::size_t Y, bool interleave) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const double ray_origin_plane = -sphere_max_radius - 1.0;
+  RayBatch rays;
+  rays.reserve(X * X);
+  for (std::size_t i = 0; i < X; ++i) {
+    for (std::size_t j = 0; j < X; ++j) {
+      const double x = -1000.0 + 2000.0 * (i + 0.5) / X;
+      const double y = -1000.0 + 2000.0 * (j + 0.5) / X;
+      rays.push_back(BoundVec3(x, y, ray_origin_plane),
+                     FreeVec3(0.0, 0.0, 1.0));
+    }
+  }
+  const std::vector<std::size_t> ray_indices =
+      svr::raysIntersectingGrid(rays, grid);
+  const auto voxels =
+      interleave ? svr::walkSphericalVolumeInterleaved(rays, ray_indices, grid,
+                                                       /*max_t=*/1.0)
+                 : svr::walkSphericalVolumeBatch(rays, ray_indices, grid,
+                                                 /*max_t=*/1.0);
+  benchmark::DoNotOptimize(voxels.data());
+}
+
+// Sends X^2 orthographic rays through a Y^3 voxel sphere, as in
+// orthographicTraverseXSquaredRaysinYCubedVoxels(), but only traverses the
+// window of each ray between the sphere center plane and 1/8th of the max
+// radius past it. If seek is true, the voxel at the beginning of the window is
+// located directly. Otherwise, the ray is walked from the sphere entrance to
+// the end of the window.
+void inline windowTraverseXSquaredRaysinYCubedVoxels(const std::size_t X,
+                                                     const std::size_t Y,
+                                                     bool seek) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const UnitVec3 ray_direction(0.0, 0.0, 1.0);
+  const double ray_origin_z = -(sphere_max_radius + 1.0);
+  const double t_window_begin = sphere_max_radius + 1.0;
+  const double t_window_end = t_window_begin + sphere_max_radius / 8.0;
+  for (std::size_t i = 0; i < X; ++i) {
+    for (std::size_t j = 0; j < X; ++j) {
+      const Ray ray(BoundVec3(-1000.0 + 2000.0 * (i + 0.5) / X,
+                              -1000.0 + 2000.0 * (j + 0.5) / X, ray_origin_z),
+                    ray_direction);
+      const auto voxels = svr::walkSphericalVolume(
+          ray, grid, seek ? t_window_begin : 0.0, t_window_end);
+      benchmark::DoNotOptimize(voxels.data());
+    }
+  }
+}
+
+// Locates X uniformly distributed points within the bounding cube of a Y^3
+// voxel sphere.
+void inline locateXPointsinYCubedVoxels(const std::size_t X,
+                                        const std::size_t Y) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> coordinate(-sphere_max_radius,
+                                                    sphere_max_radius);
+  std::vector<double> points(3 * X);
+  for (double &point : points) point = coordinate(generator);
+  std::vector<int> voxels(3 * X);
+  svr::locatePoints(points.data(), X, grid, voxels.data());
+  benchmark::DoNotOptimize(voxels.data());
+}
+
+// Sends X^2 orthographic rays through a Y^3 voxel sphere, as in
+// windowTraverseXSquaredRaysinYCubedVoxels(), and interpolates a field at
+// num_samples samples of each traversed voxel.
+void inline interpolateXSquaredRaysinYCubedVoxels(
+    const std::size_t X, const std::size_t Y,
+    std::size_t num_samples) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  std::vector<double> values(Y * Y * Y);
+  std::iota(values.begin(), values.end(), 0.0);
+  const svr::SphericalVoxelField field(grid, std::move(values));
+  const UnitVec3 ray_direction(0.0, 0.0, 1.0);
+  const double ray_origin_z = -(sphere_max_radius + 1.0);
+  std::vector<svr::VoxelSample> samples;
+  std::vector<double> interpolated;
+  for (std::size_t i = 0; i < X; ++i) {
+    for (std::size_t j = 0; j < X; ++j) {
+      const Ray ray(BoundVec3(-1000.0 + 2000.0 * (i + 0.5) / X,
+                              -1000.0 + 2000.0 * (j + 0.5) / X, ray_origin_z),
+                    ray_direction);
+      svr::walkSphericalVolume(ray, grid, 0.0, 3.0 * sphere_max_radius,
+                               num_samples, samples);
+      interpolated.resize(samples.size());
+      field.interpolate(samples.data(), samples.size(), interpolated.data());
+      benchmark::DoNotOptimize(interpolated.data());
+    }
+  }
+}
+
+// Returns the values of a smoothly varying field over a Y^3 voxel grid, in
+// the layout of SphericalVoxelField.
+std::vector<double> smoothFieldValues(const std::size_t Y) noexcept {
+  std::vector<double> values;
+  values.reserve(Y * Y * Y);
+  for (std::size_t r = 0; r < Y; ++r) {
+    for (std::size_t p = 0; p < Y; ++p) {
+      for (std::size_t a = 0; a < Y; ++a) {
+        values.push_back(std::sin(0.1 * r) + std::cos(0.05 * p) *
+                                                 std::sin(0.07 * a));
+      }
+    }
+  }
+  return values;
+}
+
+// Sends X^2 orthographic rays through the sphere of the field's grid, as in
+// interpolateXSquaredRaysinYCubedVoxels(), and interpolates the field at
+// num_samples samples of each traversed voxel.
+template <typename Values>
+void inline interpolateXSquaredRaysinField(
+    const std::size_t X, const svr::BasicSphericalVoxelField<Values> &field,
+    std::size_t num_samples) noexcept {
+  const svr::SphericalVoxelGrid &grid = field.grid();
+  const double sphere_max_radius = grid.sphereMaxRadius();
+  const UnitVec3 ray_direction(0.0, 0.0, 1.0);
+  const double ray_origin_z = -(sphere_max_radius + 1.0);
+  std::vector<svr::VoxelSample> samples;
+  std::vector<double> interpolated;
+  for (std::size_t i = 0; i < X; ++i) {
+    for (std::size_t j = 0; j < X; ++j) {
+      const Ray ray(BoundVec3(-1000.0 + 2000.0 * (i + 0.5) / X,
+                              -1000.0 + 2000.0 * (j + 0.5) / X, ray_origin_z),
+                    ray_direction);
+      svr::walkSphericalVolume(ray, grid, 0.0, 3.0 * sphere_max_radius,
+                               num_samples, samples);
+      interpolated.resize(samples.size());
+      field.interpolate(samples.data(), samples.size(), interpolated.data());
+      benchmark::DoNotOptimize(interpolated.data());
+    }
+  }
+}
+
+// Sends X^2 orthographic rays through a Y^3 voxel sphere, as in
+// interpolateXSquaredRaysinField(), and interpolates 3 fields at num_samples
+// samples of each traversed voxel. If fused, the fields are interpolated as a
+// SphericalVoxelFieldSet with a single traversal per ray, and otherwise each
+// field is interpolated with its own traversal.
+void inline interpolate3FieldsXSquaredRaysinYCubedVoxels(
+    const std::size_t X, const std::size_t Y, std::size_t num_samples,
+    bool fused) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const std::vector<double> values = smoothFieldValues(Y);
+  const svr::SphericalVoxelFieldSet fields(grid, {values, values, values});
+  const UnitVec3 ray_direction(0.0, 0.0, 1.0);
+  const double ray_origin_z = -(sphere_max_radius + 1.0);
+  std::vector<svr::VoxelSample> samples;
+  std::vector<double> interpolated;
+  for (std::size_t i = 0; i < X; ++i) {
+    for (std::size_t j = 0; j < X; ++j) {
+      const Ray ray(BoundVec3(-1000.0 + 2000.0 * (i + 0.5) / X,
+                              -1000.0 + 2000.0 * (j + 0.5) / X, ray_origin_z),
+                    ray_direction);
+      if (fused) {
+        svr::walkSphericalVolume(ray, grid, 0.0, 3.0 * sphere_max_radius,
+                                 num_samples, samples);
+        interpolated.resize(samples.size() * fields.numFields());
+        fields.interpolate(samples.data(), samples.size(),
+                           interpolated.data());
+        benchmark::DoNotOptimize(interpolated.data());
+        continue;
+      }
+      for (std::size_t f = 0; f < fields.numFields(); ++f) {
+        svr::walkSphericalVolume(ray, grid, 0.0, 3.0 * sphere_max_radius,
+                                 num_samples, samples);
+        interpolated.resize(samples.size());
+        fields.field(f).interpolate(samples.data(), samples.size(),
+                                    interpolated.data());
+        benchmark::DoNotOptimize(interpolated.data());
+      }
+    }
+  }
+}
+
+// Interpolates X^2 orthographic rays through a Y^3 voxel field stored in a
+// Values container, as in interpolateXSquaredRaysinField(). Reports the
+// maximum absolute error against the field stored in doubles at random
+// positions, and the bytes per voxel of the container.
+template <typename Values>
+void interpolateReducedPrecisionField(benchmark::State &state,
+                                      const std::size_t X, const std::size_t Y,
+                                      std::size_t bytes_per_voxel) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const std::vector<double> values = smoothFieldValues(Y);
+  const svr::SphericalVoxelField reference(grid, values);
+  const svr::BasicSphericalVoxelField<Values> field(grid, Values(values));
+  for (auto _ : state) {
+    interpolateXSquaredRaysinField(X, field, /*num_samples=*/4);
+  }
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> radius_distribution(
+      0.0, sphere_max_radius);
+  std::uniform_real_distribution<double> angle_distribution(0.0, 2 * M_PI);
+  double max_abs_error = 0.0;
+  for (std::size_t i = 0; i < 100000; ++i) {
+    const double radius = radius_distribution(generator);
+    const double polar = angle_distribution(generator);
+    const double azimuthal = angle_distribution(generator);
+    max_abs_error = std::max(
+        max_abs_error,
+        std::abs(field.interpolate(radius, polar, azimuthal) -
+                 reference.interpolate(radius, polar, azimuthal)));
+  }
+  state.counters["max_abs_error"] = max_abs_error;
+  state.counters["bytes_per_voxel"] = bytes_per_voxel;
+}
+
+// Sends X^2 orthographic rays through a Y^3 voxel sphere, as in
+// windowTraverseXSquaredRaysinYCubedVoxels(), and composites a field along
+// each ray with a pre-integrated transfer function. If a pipeline is given,
+// the rays are composited as a batch with it, and otherwise one at a time.
+void inline compositeXSquaredRaysinYCubedVoxels(
+    const std::size_t X, const std::size_t Y,
+    const svr::PreIntegrationTable &table,
+    const svr::PipelineParameters *pipeline = nullptr) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  std::vector<double> values(Y * Y * Y);
+  std::iota(values.begin(), values.end(), 0.0);
+  const svr::SphericalVoxelField field(grid, std::move(values));
+  const UnitVec3 ray_direction(0.0, 0.0, 1.0);
+  const double ray_origin_z = -(sphere_max_radius + 1.0);
+  if (pipeline != nullptr) {
+    RayBatch rays;
+    rays.reserve(X * X);
+    for (std::size_t i = 0; i < X; ++i) {
+      for (std::size_t j = 0; j < X; ++j) {
+        rays.push_back(BoundVec3(-1000.0 + 2000.0 * (i + 0.5) / X,
+                                 -1000.0 + 2000.0 * (j + 0.5) / X,
+                                 ray_origin_z),
+                       FreeVec3(0.0, 0.0, 1.0));
+      }
+    }
+    const std::vector<svr::RGBA> colors = svr::compositeFrontToBack(
+        rays, field, table, 0.0, 3.0 * sphere_max_radius, 1.0, *pipeline);
+    benchmark::DoNotOptimize(colors.data());
+    return;
+  }
+  for (std::size_t i = 0; i < X; ++i) {
+    for (std::size_t j = 0; j < X; ++j) {
+      const Ray ray(BoundVec3(-1000.0 + 2000.0 * (i + 0.5) / X,
+                              -1000.0 + 2000.0 * (j + 0.5) / X, ray_origin_z),
+                    ray_direction);
+      const svr::RGBA color = svr::compositeFrontToBack(
+          ray, field, table, 0.0, 3.0 * sphere_max_radius);
+      benchmark::DoNotOptimize(color);
+    }
+  }
+}
+
 static void Orthographic_128SquaredRays_64CubedVoxels(benchmark::State &state) {
   for (auto _ : state) {
     orthographicTraverseXSquaredRaysinYCubedVoxels(128, 64);
@@ -100,6 +514,603 @@ static void Orthographic_512SquaredRays_128CubedVoxels(
   }
 }
 
+static void OrthographicImage_256SquaredRays_64CubedVoxels(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    orthographicImageXSquaredRaysinYCubedVoxels(256, 64,
+                                                svr::TRAVERSE_ALL_RAYS);
+  }
+}
+
+static void OrthographicImage_256SquaredRays_64CubedVoxels_Symmetric(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    orthographicImageXSquaredRaysinYCubedVoxels(256, 64,
+                                                svr::EXPLOIT_MIRROR_SYMMETRY);
+  }
+}
+
+static void RandomBatch_256SquaredRays_128CubedVoxels(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    randomBatchTraverseXSquaredRaysinYCubedVoxels(256, 128, svr::INPUT_ORDER);
+  }
+}
+
+static void RandomBatch_256SquaredRays_128CubedVoxels_Coherent(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    randomBatchTraverseXSquaredRaysinYCubedVoxels(256, 128,
+                                                  svr::COHERENT_ORDER);
+  }
+}
+
+static void WideFieldOfView_512SquaredRays_64CubedVoxels(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    wideFieldOfViewTraverseXSquaredRaysinYCubedVoxels(512, 64,
+                                                      /*cull_misses=*/false);
+  }
+}
+
+static void WideFieldOfView_512SquaredRays_64CubedVoxels_Culled(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    wideFieldOfViewTraverseXSquaredRaysinYCubedVoxels(512, 64,
+                                                      /*cull_misses=*/true);
+  }
+}
+
+static void OrthographicBatch_256SquaredRays_128CubedVoxels(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    orthographicBatchTraverseXSquaredRaysinYCubedVoxels(256, 128,
+                                                        /*interleave=*/false);
+  }
+}
+
+static void OrthographicBatch_256SquaredRays_128CubedVoxels_Interleaved(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    orthographicBatchTraverseXSquaredRaysinYCubedVoxels(256, 128,
+                                                        /*interleave=*/true);
+  }
+}
+
+static void Window_256SquaredRays_128CubedVoxels(benchmark::State &state) {
+  for (auto _ : state) {
+    windowTraverseXSquaredRaysinYCubedVoxels(256, 128, /*seek=*/false);
+  }
+}
+
+static void Window_256SquaredRays_128CubedVoxels_Seek(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    windowTraverseXSquaredRaysinYCubedVoxels(256, 128, /*seek=*/true);
+  }
+}
+
+static void LocatePoints_1MPoints_128CubedVoxels(benchmark::State &state) {
+  for (auto _ : state) {
+    locateXPointsinYCubedVoxels(1 << 20, 128);
+  }
+}
+
+// Starts up a grid of X polar and X azimuthal sections, either by
+// constructing it, or by mapping a grid file written beforehand. A mapped grid
+// reads its tables in place, so their pages are only loaded once traversed.
+void startUpGridWithXAngularSections(benchmark::State &state,
+                                     const std::size_t X,
+                                     bool map_file) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = 10e4, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const std::string path = "benchmark_grid.svrg";
+  if (map_file) {
+    const svr::SphericalVoxelGrid grid(min_bound, max_bound, 128, X, X,
+                                       sphere_center);
+    if (!svr::writeGridFile(path, grid)) {
+      state.SkipWithError("The grid file could not be written.");
+      return;
+    }
+  }
+  for (auto _ : state) {
+    if (map_file) {
+      const svr::MappedGridFile file(path);
+      benchmark::DoNotOptimize(file.grid().deltaPhi());
+    } else {
+      const svr::SphericalVoxelGrid grid(min_bound, max_bound, 128, X, X,
+                                         sphere_center);
+      benchmark::DoNotOptimize(grid.deltaPhi());
+    }
+  }
+  if (map_file) std::remove(path.c_str());
+}
+
+static void GridStartup_1MAngularSections_Construct(benchmark::State &state) {
+  startUpGridWithXAngularSections(state, 1 << 20, /*map_file=*/false);
+}
+
+static void GridStartup_1MAngularSections_Map(benchmark::State &state) {
+  startUpGridWithXAngularSections(state, 1 << 20, /*map_file=*/true);
+}
+
+static void Interpolate_128SquaredRays_64CubedVoxels_4Samples(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    interpolateXSquaredRaysinYCubedVoxels(128, 64, /*num_samples=*/4);
+  }
+}
+
+static void Composite_128SquaredRays_64CubedVoxels_PreIntegrated(
+    benchmark::State &state) {
+  const svr::TransferFunction transfer_function = {
+      .min_value = 0.0,
+      .max_value = 64.0 * 64.0 * 64.0,
+      .control_points = {{.red = 0.0, .green = 0.0, .blue = 1.0, .alpha = 0.0},
+                         {.red = 1.0, .green = 0.0, .blue = 0.0,
+                          .alpha = 1e-5}}};
+  const svr::PreIntegrationParameters parameters = {
+      .num_scalar_samples = 256,
+      .num_length_samples = 16,
+      .max_segment_length = 2e4,
+      .num_integration_steps = 32,
+      .num_threads = 0};
+  const svr::PreIntegrationTable table(transfer_function, parameters);
+  for (auto _ : state) {
+    compositeXSquaredRaysinYCubedVoxels(128, 64, table);
+  }
+}
+
+// Similar to Composite_128SquaredRays_64CubedVoxels_PreIntegrated, but with
+// a pipeline of state.range(0) traversal threads and state.range(1) shading
+// threads.
+static void Composite_128SquaredRays_64CubedVoxels_Pipelined(
+    benchmark::State &state) {
+  const svr::TransferFunction transfer_function = {
+      .min_value = 0.0,
+      .max_value = 64.0 * 64.0 * 64.0,
+      .control_points = {{.red = 0.0, .green = 0.0, .blue = 1.0, .alpha = 0.0},
+                         {.red = 1.0, .green = 0.0, .blue = 0.0,
+                          .alpha = 1e-5}}};
+  const svr::PreIntegrationParameters parameters = {
+      .num_scalar_samples = 256,
+      .num_length_samples = 16,
+      .max_segment_length = 2e4,
+      .num_integration_steps = 32,
+      .num_threads = 0};
+  const svr::PreIntegrationTable table(transfer_function, parameters);
+  const svr::PipelineParameters pipeline = {
+      .num_traversal_threads = static_cast<std::size_t>(state.range(0)),
+      .num_shading_threads = static_cast<std::size_t>(state.range(1)),
+      .batch_size = 256,
+      .queue_capacity = 4096};
+  for (auto _ : state) {
+    compositeXSquaredRaysinYCubedVoxels(128, 64, table, &pipeline);
+  }
+}
+
+static void GradientField_128CubedVoxels(benchmark::State &state) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = 10e4, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, 128, 128, 128,
+                                     sphere_center);
+  std::vector<double> values(128 * 128 * 128);
+  std::iota(values.begin(), values.end(), 0.0);
+  const svr::SphericalVoxelField field(grid, std::move(values));
+  for (auto _ : state) {
+    const svr::SphericalGradientField gradients(field);
+    benchmark::DoNotOptimize(gradients.scale());
+  }
+}
+
+static void Interpolate_128SquaredRays_128CubedVoxels_Double(
+    benchmark::State &state) {
+  interpolateReducedPrecisionField<std::vector<double>>(state, 128, 128, 8);
+}
+
+static void Interpolate_128SquaredRays_128CubedVoxels_Half(
+    benchmark::State &state) {
+  interpolateReducedPrecisionField<svr::HalfVector>(state, 128, 128, 2);
+}
+
+static void Interpolate_128SquaredRays_128CubedVoxels_BFloat16(
+    benchmark::State &state) {
+  interpolateReducedPrecisionField<svr::BFloat16Vector>(state, 128, 128, 2);
+}
+
+static void Interpolate_128SquaredRays_128CubedVoxels_Quantized(
+    benchmark::State &state) {
+  interpolateReducedPrecisionField<svr::QuantizedVector>(state, 128, 128, 1);
+}
+
+// Interpolates X^2 orthographic rays through a Y^3 voxel field whose values
+// are non-zero only within 4 shells and an eighth of the polar voxels, stored
+// in a SparseVector. Reports the bytes per voxel of the container.
+static void Interpolate_128SquaredRays_128CubedVoxels_Sparse(
+    benchmark::State &state) {
+  const std::size_t X = 128, Y = 128;
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = 10e4, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  std::vector<double> values = smoothFieldValues(Y);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    const std::size_t r = i / (Y * Y), p = i / Y % Y;
+    if (r < Y / 2 || r >= Y / 2 + 4 || p >= Y / 8) values[i] = 0.0;
+  }
+  const svr::SparseSphericalVoxelField field(grid,
+                                             svr::SparseVector(values, Y));
+  for (auto _ : state) {
+    interpolateXSquaredRaysinField(X, field, /*num_samples=*/4);
+  }
+  state.counters["bytes_per_voxel"] =
+      static_cast<double>(field.values().sizeInBytes()) / values.size();
+}
+
+static void Interpolate3Fields_128SquaredRays_64CubedVoxels_Separate(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    interpolate3FieldsXSquaredRaysinYCubedVoxels(128, 64, /*num_samples=*/4,
+                                                 /*fused=*/false);
+  }
+}
+
+static void Interpolate3Fields_128SquaredRays_64CubedVoxels_Fused(
+    benchmark::State &state) {
+  for (auto _ : state) {
+    interpolate3FieldsXSquaredRaysinYCubedVoxels(128, 64, /*num_samples=*/4,
+                                                 /*fused=*/true);
+  }
+}
+
+// Gathers the values of 3 fields at the voxels of X^2 random rays through a
+// Y^3 voxel sphere, as in randomBatchTraverseXSquaredRaysinYCubedVoxels(). The
+// rays are traversed once, outside of the timed loop. If reordered, the
+// values are gathered in memory order with a VoxelGatherPlan, which is built
+// within the timed loop, and otherwise in the order of each path.
+void gatherXSquaredRaysinYCubedVoxels(benchmark::State &state,
+                                      const std::size_t X, const std::size_t Y,
+                                      bool reordered) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const std::vector<double> values = smoothFieldValues(Y);
+  const svr::SphericalVoxelFieldSet fields(grid, {values, values, values});
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+  RayBatch rays;
+  rays.reserve(X * X);
+  for (std::size_t i = 0; i < X * X; ++i) {
+    rays.push_back(BoundVec3(sphere_max_radius * distribution(generator),
+                             sphere_max_radius * distribution(generator),
+                             sphere_max_radius * distribution(generator)),
+                   FreeVec3(distribution(generator), distribution(generator),
+                            distribution(generator)));
+  }
+  const std::vector<std::vector<svr::SphericalVoxel>> traversals =
+      svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0);
+  std::size_t num_voxels = 0;
+  for (const auto &traversal : traversals) num_voxels += traversal.size();
+  std::vector<std::vector<double>> gathered(
+      fields.numFields(), std::vector<double>(num_voxels));
+  for (auto _ : state) {
+    if (reordered) {
+      const svr::VoxelGatherPlan plan(grid, traversals);
+      for (std::size_t f = 0; f < fields.numFields(); ++f) {
+        plan.gather(fields.field(f), gathered[f].data());
+      }
+    } else {
+      std::size_t position = 0;
+      for (const auto &traversal : traversals) {
+        for (const svr::SphericalVoxel &voxel : traversal) {
+          for (std::size_t f = 0; f < fields.numFields(); ++f) {
+            gathered[f][position] = fields.field(f).value(voxel);
+          }
+          ++position;
+        }
+      }
+    }
+    benchmark::DoNotOptimize(gathered.data());
+  }
+}
+
+static void Gather3Fields_128SquaredRays_256CubedVoxels_PathOrder(
+    benchmark::State &state) {
+  gatherXSquaredRaysinYCubedVoxels(state, 128, 256, /*reordered=*/false);
+}
+
+static void Gather3Fields_128SquaredRays_256CubedVoxels_Reordered(
+    benchmark::State &state) {
+  gatherXSquaredRaysinYCubedVoxels(state, 128, 256, /*reordered=*/true);
+}
+
+// The outputs of a batch traversal.
+enum BatchOutput {
+  // A vector of voxels per ray.
+  VOXEL_VECTORS = 0,
+
+  // A span per ray within a TraversalArena, reset per batch.
+  ARENA_SPANS = 1,
+
+  // VoxelColumns, reused across batches.
+  COLUMNS = 2
+};
+
+// Traverses X^2 random rays through a Y^3 voxel sphere as a batch, as in
+// randomBatchTraverseXSquaredRaysinYCubedVoxels(), then sums the length of
+// every traversed voxel, as an integrating consumer would.
+void batchTraverseXSquaredRaysinYCubedVoxels(benchmark::State &state,
+                                             const std::size_t X,
+                                             const std::size_t Y,
+                                             BatchOutput output) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-sphere_max_radius,
+                                                sphere_max_radius);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  RayBatch rays;
+  rays.reserve(X * X);
+  for (std::size_t i = 0; i < X * X; ++i) {
+    rays.push_back(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        FreeVec3(direction(generator), direction(generator),
+                 direction(generator)));
+  }
+  svr::TraversalArena arena;
+  svr::VoxelColumns columns;
+  for (auto _ : state) {
+    double length = 0.0;
+    switch (output) {
+      case VOXEL_VECTORS: {
+        const std::vector<std::vector<svr::SphericalVoxel>> voxels =
+            svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0);
+        for (const auto &traversal : voxels) {
+          for (const svr::SphericalVoxel &voxel : traversal) {
+            length += voxel.exit_t - voxel.enter_t;
+          }
+        }
+        break;
+      }
+      case ARENA_SPANS: {
+        arena.reset();
+        const std::vector<svr::VoxelSpan> spans =
+            svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0, arena);
+        for (const svr::VoxelSpan &span : spans) {
+          for (const svr::SphericalVoxel &voxel : span) {
+            length += voxel.exit_t - voxel.enter_t;
+          }
+        }
+        break;
+      }
+      case COLUMNS: {
+        svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0, columns);
+        for (std::size_t row = 0; row < columns.size(); ++row) {
+          length += columns.exit_t[row] - columns.enter_t[row];
+        }
+        break;
+      }
+    }
+    benchmark::DoNotOptimize(length);
+  }
+}
+
+static void BatchOutput_256SquaredRays_128CubedVoxels_Vectors(
+    benchmark::State &state) {
+  batchTraverseXSquaredRaysinYCubedVoxels(state, 256, 128, VOXEL_VECTORS);
+}
+
+static void BatchOutput_256SquaredRays_128CubedVoxels_Arena(
+    benchmark::State &state) {
+  batchTraverseXSquaredRaysinYCubedVoxels(state, 256, 128, ARENA_SPANS);
+}
+
+static void BatchOutput_256SquaredRays_128CubedVoxels_Columns(
+    benchmark::State &state) {
+  batchTraverseXSquaredRaysinYCubedVoxels(state, 256, 128, COLUMNS);
+}
+
+// Traverses X^2 random rays through a Y^3 voxel field into VoxelColumns, as
+// in batchTraverseXSquaredRaysinYCubedVoxels(), then integrates the field
+// along every ray. The value of each voxel is addressed either by the index
+// emitted with the traversal, or by converting its voxel indices.
+void integrateColumnsXSquaredRaysinYCubedVoxels(benchmark::State &state,
+                                                const std::size_t X,
+                                                const std::size_t Y,
+                                                bool emit_indices) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const svr::VoxelLayout layout(grid);
+  const std::vector<double> values(layout.size(), 1.0);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-sphere_max_radius,
+                                                sphere_max_radius);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  RayBatch rays;
+  rays.reserve(X * X);
+  for (std::size_t i = 0; i < X * X; ++i) {
+    rays.push_back(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        FreeVec3(direction(generator), direction(generator),
+                 direction(generator)));
+  }
+  svr::VoxelColumns columns;
+  for (auto _ : state) {
+    double integral = 0.0;
+    if (emit_indices) {
+      svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0, columns,
+                                    svr::INPUT_ORDER, &layout);
+      for (std::size_t row = 0; row < columns.size(); ++row) {
+        integral += (columns.exit_t[row] - columns.enter_t[row]) *
+                    values[columns.index[row]];
+      }
+    } else {
+      svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0, columns);
+      for (std::size_t row = 0; row < columns.size(); ++row) {
+        const std::size_t index =
+            (static_cast<std::size_t>(columns.radial[row] - 1) * Y +
+             static_cast<std::size_t>(columns.polar[row])) *
+                Y +
+            static_cast<std::size_t>(columns.azimuthal[row]);
+        integral +=
+            (columns.exit_t[row] - columns.enter_t[row]) * values[index];
+      }
+    }
+    benchmark::DoNotOptimize(integral);
+  }
+}
+
+static void IntegrateColumns_256SquaredRays_128CubedVoxels_ComputedIndices(
+    benchmark::State &state) {
+  integrateColumnsXSquaredRaysinYCubedVoxels(state, 256, 128, false);
+}
+
+static void IntegrateColumns_256SquaredRays_128CubedVoxels_EmittedIndices(
+    benchmark::State &state) {
+  integrateColumnsXSquaredRaysinYCubedVoxels(state, 256, 128, true);
+}
+
+// Counts the data TLB load misses of the calling thread in user space, where
+// the hardware counter is available. Otherwise, misses() returns -1.
+class DataTLBMissCounter {
+ public:
+  DataTLBMissCounter() noexcept {
+#ifdef __linux__
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HW_CACHE;
+    attributes.config = PERF_COUNT_HW_CACHE_DTLB |
+                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    fd_ = static_cast<int>(
+        syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+  }
+
+  ~DataTLBMissCounter() noexcept {
+#ifdef __linux__
+    if (fd_ >= 0) close(fd_);
+#endif
+  }
+
+  double misses() const noexcept {
+#ifdef __linux__
+    long long count;
+    if (fd_ >= 0 && read(fd_, &count, sizeof(count)) == sizeof(count)) {
+      return static_cast<double>(count);
+    }
+#endif
+    return -1.0;
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+// Returns the MiB of anonymous memory of this process that is backed by
+// transparent huge pages, or -1 if unknown.
+double anonymousHugePageMiB() noexcept {
+  std::ifstream rollup("/proc/self/smaps_rollup");
+  std::string key;
+  double kib;
+  while (rollup >> key) {
+    if (key == "AnonHugePages:" && rollup >> kib) return kib / 1024.0;
+  }
+  return -1.0;
+}
+
+// Looks up the values of a Y^3 voxel field at the voxels of X^2 random rays,
+// in the order of each path, with the field's values allocated with the given
+// huge page policy. The rays are traversed outside of the timed loop. Reports
+// the data TLB misses per voxel where the counter is available, and the MiB
+// of the process backed by transparent huge pages.
+void lookUpXSquaredRaysinYCubedVoxels(benchmark::State &state,
+                                      const std::size_t X, const std::size_t Y,
+                                      svr::HugePagePolicy policy) noexcept {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const svr::SphereBound min_bound = {
+      .radial = 0.0, .polar = 0.0, .azimuthal = 0.0};
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = 2 * M_PI, .azimuthal = 2 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, Y, Y, Y,
+                                     sphere_center);
+  const svr::BasicSphericalVoxelField<svr::HugePageVector<double>> field(
+      grid, svr::toHugePageVector(smoothFieldValues(Y), policy));
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+  RayBatch rays;
+  rays.reserve(X * X);
+  for (std::size_t i = 0; i < X * X; ++i) {
+    rays.push_back(BoundVec3(sphere_max_radius * distribution(generator),
+                             sphere_max_radius * distribution(generator),
+                             sphere_max_radius * distribution(generator)),
+                   FreeVec3(distribution(generator), distribution(generator),
+                            distribution(generator)));
+  }
+  const std::vector<std::vector<svr::SphericalVoxel>> traversals =
+      svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0);
+  std::size_t num_voxels = 0;
+  for (const auto &traversal : traversals) num_voxels += traversal.size();
+  const DataTLBMissCounter counter;
+  const double misses_before = counter.misses();
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (const auto &traversal : traversals) {
+      for (const svr::SphericalVoxel &voxel : traversal) {
+        sum += field.value(voxel);
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  if (misses_before >= 0.0) {
+    state.counters["dtlb_misses_per_voxel"] =
+        (counter.misses() - misses_before) /
+        (static_cast<double>(num_voxels) * state.iterations());
+  }
+  state.counters["anon_huge_page_mib"] = anonymousHugePageMiB();
+}
+
+static void LookUp_128SquaredRays_256CubedVoxels_BasePages(
+    benchmark::State &state) {
+  lookUpXSquaredRaysinYCubedVoxels(state, 128, 256, svr::BASE_PAGES);
+}
+
+static void LookUp_128SquaredRays_256CubedVoxels_TransparentHugePages(
+    benchmark::State &state) {
+  lookUpXSquaredRaysinYCubedVoxels(state, 128, 256,
+                                   svr::TRANSPARENT_HUGE_PAGES);
+}
+
 constexpr std::size_t NUM_ITERATIONS = 10;
 BENCHMARK(Orthographic_128SquaredRays_64CubedVoxels)
     ->Unit(benchmark::kMillisecond)
@@ -119,6 +1130,109 @@ BENCHMARK(Orthographic_256SquaredRays_128CubedVoxels)
 BENCHMARK(Orthographic_512SquaredRays_128CubedVoxels)
     ->Unit(benchmark::kMillisecond)
     ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(OrthographicImage_256SquaredRays_64CubedVoxels)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(OrthographicImage_256SquaredRays_64CubedVoxels_Symmetric)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(RandomBatch_256SquaredRays_128CubedVoxels)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(RandomBatch_256SquaredRays_128CubedVoxels_Coherent)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(WideFieldOfView_512SquaredRays_64CubedVoxels)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(WideFieldOfView_512SquaredRays_64CubedVoxels_Culled)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(OrthographicBatch_256SquaredRays_128CubedVoxels)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(OrthographicBatch_256SquaredRays_128CubedVoxels_Interleaved)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Window_256SquaredRays_128CubedVoxels)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Window_256SquaredRays_128CubedVoxels_Seek)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(LocatePoints_1MPoints_128CubedVoxels)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(GridStartup_1MAngularSections_Construct)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(GridStartup_1MAngularSections_Map)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Interpolate_128SquaredRays_64CubedVoxels_4Samples)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Composite_128SquaredRays_64CubedVoxels_PreIntegrated)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Composite_128SquaredRays_64CubedVoxels_Pipelined)
+    ->Args({1, 1})
+    ->Args({1, 2})
+    ->Args({2, 2})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(GradientField_128CubedVoxels)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Interpolate_128SquaredRays_128CubedVoxels_Double)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Interpolate_128SquaredRays_128CubedVoxels_Half)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Interpolate_128SquaredRays_128CubedVoxels_BFloat16)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Interpolate_128SquaredRays_128CubedVoxels_Quantized)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Interpolate_128SquaredRays_128CubedVoxels_Sparse)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Interpolate3Fields_128SquaredRays_64CubedVoxels_Separate)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Interpolate3Fields_128SquaredRays_64CubedVoxels_Fused)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Gather3Fields_128SquaredRays_256CubedVoxels_PathOrder)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(Gather3Fields_128SquaredRays_256CubedVoxels_Reordered)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(BatchOutput_256SquaredRays_128CubedVoxels_Vectors)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(BatchOutput_256SquaredRays_128CubedVoxels_Arena)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(BatchOutput_256SquaredRays_128CubedVoxels_Columns)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(IntegrateColumns_256SquaredRays_128CubedVoxels_ComputedIndices)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(IntegrateColumns_256SquaredRays_128CubedVoxels_EmittedIndices)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(LookUp_128SquaredRays_256CubedVoxels_BasePages)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
+BENCHMARK(LookUp_128SquaredRays_256CubedVoxels_TransparentHugePages)
+    ->Unit(benchmark::kMillisecond)
+    ->Repetitions(NUM_ITERATIONS);
 
 }  // namespace
 
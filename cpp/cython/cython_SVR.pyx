@@ -3,13 +3,19 @@
 import numpy as np
 cimport numpy as np
 cimport cython
+from cpython.ref cimport Py_INCREF
 from libcpp.vector cimport vector
 
+np.import_array()
+
 cdef extern from "../spherical_volume_rendering_util.h" namespace "svr":
     cdef cppclass SphericalVoxel:
         int radial, polar, azimuthal
     cdef cppclass SphereBound:
         double radial, polar, azimuthal
+    cdef enum TraversalDirection:
+        FRONT_TO_BACK
+        BACK_TO_FRONT
 
     vector[SphericalVoxel] walkSphericalVolume(double *ray_origin, double *ray_direction,
                                                double *min_bound, double *max_bound,
@@ -17,6 +23,29 @@ cdef extern from "../spherical_volume_rendering_util.h" namespace "svr":
                                                size_t num_azimuthal_voxels, double *sphere_center,
                                                double max_t)
 
+    vector[SphericalVoxel] walkSphericalVolume(double *ray_origin, double *ray_direction,
+                                               double *min_bound, double *max_bound,
+                                               size_t num_radial_voxels, size_t num_polar_voxels,
+                                               size_t num_azimuthal_voxels, double *sphere_center,
+                                               double t_begin, double t_end,
+                                               TraversalDirection direction)
+
+    cdef cppclass VoxelColumns:
+        vector[int] radial, polar, azimuthal
+        vector[double] enter_t, exit_t
+        vector[size_t] first, count
+        size_t size()
+
+    void walkSphericalVolumeBatch(const double *ray_origins, const double *ray_directions,
+                                  size_t num_rays, double *min_bound, double *max_bound,
+                                  size_t num_radial_voxels, size_t num_polar_voxels,
+                                  size_t num_azimuthal_voxels, double *sphere_center,
+                                  double max_t, VoxelColumns &columns)
+
+    void locatePoints(const double *points, size_t num_points, double *min_bound,
+                      double *max_bound, size_t num_radial_voxels, size_t num_polar_voxels,
+                      size_t num_azimuthal_voxels, double *sphere_center, int *voxels)
+
 @cython.boundscheck(False)
 @cython.wraparound(False)
 @cython.cdivision(True)
@@ -69,4 +98,147 @@ def walk_spherical_volume(np.ndarray[np.float64_t, ndim=1, mode="c"] ray_origin,
         cyVoxels[i,0] = voxels[i].radial
         cyVoxels[i,1] = voxels[i].polar
         cyVoxels[i,2] = voxels[i].azimuthal
-    return cyVoxels
\ No newline at end of file
+    return cyVoxels
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+@cython.cdivision(True)
+def walk_spherical_volume_window(np.ndarray[np.float64_t, ndim=1, mode="c"] ray_origin,
+                                 np.ndarray[np.float64_t, ndim=1, mode="c"] ray_direction,
+                                 np.ndarray[np.float64_t, ndim=1, mode="c"] min_bound,
+                                 np.ndarray[np.float64_t, ndim=1, mode="c"] max_bound,
+                                 int num_radial_voxels, int num_polar_voxels, int num_azimuthal_voxels,
+                                 np.ndarray[np.float64_t, ndim=1, mode="c"] sphere_center,
+                                 np.float64_t t_begin, np.float64_t t_end, bint back_to_front = False):
+    '''
+    Windowed Spherical Coordinate Voxel Traversal Algorithm
+    Similar to walk_spherical_volume, but only traverses the ray within the window of times
+    [t_begin, t_end]. The voxel at t_begin is located directly rather than walked to from the
+    sphere entrance.
+    Arguments:
+           t_begin: The time at which the traversal begins, i.e. the point ray_origin + t_begin * ray_direction.
+           t_end: The time at which the traversal ends.
+           back_to_front: If true, the voxels are traversed from far to near, beginning at the
+                          end of the window. Defaulted to False.
+           For the remaining arguments, see walk_spherical_volume.
+    Returns:
+           A numpy array of the spherical voxel coordinates, as in walk_spherical_volume.
+    Notes:
+        - Unlike max_t, t_begin and t_end are not unitized. The window is clipped to the sphere.
+    '''
+    assert(ray_origin.size == 3)
+    assert(ray_direction.size == 3)
+    assert(sphere_center.size == 3)
+    assert(min_bound.size == 3)
+    assert(max_bound.size == 3)
+
+    cdef vector[SphericalVoxel] voxels = walkSphericalVolume(&ray_origin[0], &ray_direction[0],
+                                                             &min_bound[0], &max_bound[0],
+                                                             num_radial_voxels, num_polar_voxels,
+                                                             num_azimuthal_voxels, &sphere_center[0],
+                                                             t_begin, t_end,
+                                                             BACK_TO_FRONT if back_to_front else FRONT_TO_BACK)
+    cdef np.ndarray cyVoxels = np.empty((voxels.size(), 3), dtype=int)
+    for i in range(voxels.size()):
+        cyVoxels[i,0] = voxels[i].radial
+        cyVoxels[i,1] = voxels[i].polar
+        cyVoxels[i,2] = voxels[i].azimuthal
+    return cyVoxels
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+@cython.cdivision(True)
+def locate_points(np.ndarray[np.float64_t, ndim=2, mode="c"] points,
+                  np.ndarray[np.float64_t, ndim=1, mode="c"] min_bound,
+                  np.ndarray[np.float64_t, ndim=1, mode="c"] max_bound,
+                  int num_radial_voxels, int num_polar_voxels, int num_azimuthal_voxels,
+                  np.ndarray[np.float64_t, ndim=1, mode="c"] sphere_center):
+    '''
+    Batched Point Location
+    Locates the spherical voxel containing each of the given points.
+    Arguments:
+           points: A numpy array of shape (N, 3) of the (x,y,z) points.
+           For the remaining arguments, see walk_spherical_volume.
+    Returns:
+           A numpy array of shape (N, 3) of the spherical voxel coordinates, as in
+           walk_spherical_volume. The voxel coordinates of a point outside the grid are all -1.
+    Notes:
+        - A point on a voxel boundary is located in the outer radial voxel and the lower
+          angular voxel, i.e. the voxel of a traversal with that point as the ray origin.
+    '''
+    assert(points.shape[1] == 3)
+    assert(sphere_center.size == 3)
+    assert(min_bound.size == 3)
+    assert(max_bound.size == 3)
+
+    cdef np.ndarray[int, ndim=2, mode="c"] cyVoxels = np.empty((points.shape[0], 3), dtype=np.intc)
+    if points.shape[0] == 0:
+        return cyVoxels
+    locatePoints(&points[0,0], points.shape[0], &min_bound[0], &max_bound[0],
+                 num_radial_voxels, num_polar_voxels, num_azimuthal_voxels,
+                 &sphere_center[0], &cyVoxels[0,0])
+    return cyVoxels
+
+cdef class _VoxelColumnsOwner:
+    # Owns the columns of a batch traversal. The NumPy arrays returned by
+    # walk_spherical_volume_batch view its columns, and keep it alive.
+    cdef VoxelColumns columns
+
+cdef np.ndarray _column_view(_VoxelColumnsOwner owner, void *data, np.npy_intp size, int typenum):
+    if size == 0:
+        return np.PyArray_SimpleNew(1, &size, typenum)
+    cdef np.ndarray column = np.PyArray_SimpleNewFromData(1, &size, typenum, data)
+    # PyArray_SetBaseObject steals the reference.
+    Py_INCREF(owner)
+    np.PyArray_SetBaseObject(column, owner)
+    return column
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+@cython.cdivision(True)
+def walk_spherical_volume_batch(np.ndarray[np.float64_t, ndim=2, mode="c"] ray_origins,
+                                np.ndarray[np.float64_t, ndim=2, mode="c"] ray_directions,
+                                np.ndarray[np.float64_t, ndim=1, mode="c"] min_bound,
+                                np.ndarray[np.float64_t, ndim=1, mode="c"] max_bound,
+                                int num_radial_voxels, int num_polar_voxels, int num_azimuthal_voxels,
+                                np.ndarray[np.float64_t, ndim=1, mode="c"] sphere_center,
+                                np.float64_t max_t = 1.0):
+    '''
+    Batched Spherical Coordinate Voxel Traversal Algorithm
+    Traverses each ray of a batch, and returns the voxels of the batch as columns.
+    Arguments:
+           ray_origins: A numpy array of shape (N, 3) of the (x,y,z) ray origins.
+           ray_directions: A numpy array of shape (N, 3) of the (x,y,z) ray directions.
+           For the remaining arguments, see walk_spherical_volume.
+    Returns:
+           A dictionary of 1-dimensional numpy arrays:
+             'radial', 'polar', 'azimuthal': The voxel coordinates of each traversed voxel.
+             'enter_t', 'exit_t': The times at which the ray enters and exits each voxel.
+             'first', 'count': Of shape (N,). The voxels of ray i are the rows
+                               [first[i], first[i] + count[i]) of the other columns.
+    Notes:
+        - The arrays view the memory to which the voxels were traversed, so no copies are made.
+    '''
+    assert(ray_origins.shape[1] == 3)
+    assert(ray_directions.shape[0] == ray_origins.shape[0] and ray_directions.shape[1] == 3)
+    assert(sphere_center.size == 3)
+    assert(min_bound.size == 3)
+    assert(max_bound.size == 3)
+
+    cdef _VoxelColumnsOwner owner = _VoxelColumnsOwner()
+    cdef size_t num_rays = ray_origins.shape[0]
+    if num_rays > 0:
+        walkSphericalVolumeBatch(&ray_origins[0,0], &ray_directions[0,0], num_rays,
+                                 &min_bound[0], &max_bound[0],
+                                 num_radial_voxels, num_polar_voxels, num_azimuthal_voxels,
+                                 &sphere_center[0], max_t, owner.columns)
+    cdef np.npy_intp num_voxels = owner.columns.size()
+    return {
+        'radial': _column_view(owner, owner.columns.radial.data(), num_voxels, np.NPY_INT),
+        'polar': _column_view(owner, owner.columns.polar.data(), num_voxels, np.NPY_INT),
+        'azimuthal': _column_view(owner, owner.columns.azimuthal.data(), num_voxels, np.NPY_INT),
+        'enter_t': _column_view(owner, owner.columns.enter_t.data(), num_voxels, np.NPY_DOUBLE),
+        'exit_t': _column_view(owner, owner.columns.exit_t.data(), num_voxels, np.NPY_DOUBLE),
+        'first': _column_view(owner, owner.columns.first.data(), num_rays, np.NPY_UINTP),
+        'count': _column_view(owner, owner.columns.count.data(), num_rays, np.NPY_UINTP),
+    }
@@ -17,9 +17,11 @@ from Cython.Distutils import build_ext
 
 ext_modules = [Extension(
     name="cython_SVR",
-    sources=["cython_SVR.pyx", "../spherical_volume_rendering_util.cpp"],
+    sources=["cython_SVR.pyx", "../spherical_volume_rendering_util.cpp",
+             "../transfer_function.cpp", "../gradient_field.cpp",
+             "../grid_file.cpp"],
     language="c++",
-    extra_compile_args=["-std=c++11", "-O3", "-march=native", "-flto", "-fno-signed-zeros", "-funroll-loops"],
+    extra_compile_args=["-std=c++11", "-O3", "-march=native", "-flto", "-fno-signed-zeros", "-fno-math-errno", "-funroll-loops"],
     define_macros = [('NPY_NO_DEPRECATED_API', 'NPY_1_7_API_VERSION')], # Hides deprecated Numpy warning.
     include_dirs = [numpy.get_include()],
 )]
@@ -809,6 +809,112 @@ class TestWalkSphericalVolume(unittest.TestCase):
         last_radial_voxel = voxels[voxels[0].size - 1][0]
         assert (last_radial_voxel != 0)
 
+    def test_window_readme_example(self):
+        ray_origin = np.array([-13.0, -13.0, -13.0])
+        ray_direction = np.array([1.0, 1.0, 1.0])
+        sphere_center = np.array([0.0, 0.0, 0.0])
+        sphere_max_radius = 10.0
+        num_radial_sections = 4
+        num_polar_sections = 4
+        num_azimuthal_sections = 4
+        min_bound = np.array([0.0, 0.0, 0.0])
+        max_bound = np.array([sphere_max_radius, 2 * np.pi, 2 * np.pi])
+        voxels = cython_SVR.walk_spherical_volume_window(ray_origin, ray_direction, min_bound, max_bound,
+                                                         num_radial_sections, num_polar_sections,
+                                                         num_azimuthal_sections, sphere_center, 0.0, 40.0)
+        expected_radial_voxels = [1, 2, 3, 4, 4, 3, 2, 1]
+        expected_theta_voxels = [2, 2, 2, 2, 0, 0, 0, 0]
+        expected_phi_voxels = [2, 2, 2, 2, 0, 0, 0, 0]
+        self.verify_voxels(voxels, expected_radial_voxels, expected_theta_voxels, expected_phi_voxels)
+
+    def test_window_begins_within_sphere(self):
+        ray_origin = np.array([-13.0, -13.0, -13.0])
+        ray_direction = np.array([1.0, 1.0, 1.0])
+        sphere_center = np.array([0.0, 0.0, 0.0])
+        sphere_max_radius = 10.0
+        num_radial_sections = 4
+        num_polar_sections = 4
+        num_azimuthal_sections = 4
+        min_bound = np.array([0.0, 0.0, 0.0])
+        max_bound = np.array([sphere_max_radius, 2 * np.pi, 2 * np.pi])
+        # The ray passes through the sphere center at t = sqrt(3) * 13.
+        t_center = np.sqrt(3.0) * 13.0
+        voxels = cython_SVR.walk_spherical_volume_window(ray_origin, ray_direction, min_bound, max_bound,
+                                                         num_radial_sections, num_polar_sections,
+                                                         num_azimuthal_sections, sphere_center,
+                                                         t_center + 1.0, 40.0)
+        expected_radial_voxels = [4, 3, 2, 1]
+        expected_theta_voxels = [0, 0, 0, 0]
+        expected_phi_voxels = [0, 0, 0, 0]
+        self.verify_voxels(voxels, expected_radial_voxels, expected_theta_voxels, expected_phi_voxels)
+
+    def test_window_back_to_front(self):
+        ray_origin = np.array([-13.0, -12.0, -11.0])
+        ray_direction = np.array([1.0, 1.0, 1.0])
+        sphere_center = np.array([0.0, 0.0, 0.0])
+        sphere_max_radius = 10.0
+        num_radial_sections = 4
+        num_polar_sections = 4
+        num_azimuthal_sections = 4
+        min_bound = np.array([0.0, 0.0, 0.0])
+        max_bound = np.array([sphere_max_radius, 2 * np.pi, 2 * np.pi])
+        front_to_back = cython_SVR.walk_spherical_volume_window(ray_origin, ray_direction, min_bound, max_bound,
+                                                                num_radial_sections, num_polar_sections,
+                                                                num_azimuthal_sections, sphere_center, 0.0, 25.0)
+        back_to_front = cython_SVR.walk_spherical_volume_window(ray_origin, ray_direction, min_bound, max_bound,
+                                                                num_radial_sections, num_polar_sections,
+                                                                num_azimuthal_sections, sphere_center, 0.0, 25.0,
+                                                                back_to_front=True)
+        self.assertListEqual(back_to_front.tolist(), front_to_back[::-1].tolist())
+
+    def test_locate_points(self):
+        sphere_center = np.array([0.0, 0.0, 0.0])
+        sphere_max_radius = 10.0
+        num_radial_sections = 4
+        num_polar_sections = 4
+        num_azimuthal_sections = 4
+        min_bound = np.array([0.0, 0.0, 0.0])
+        max_bound = np.array([sphere_max_radius, 2 * np.pi, 2 * np.pi])
+        points = np.array([[5.0, 0.0, 0.0],
+                           [-1.0, 0.0, 0.0],
+                           [0.0, 0.0, -7.5],
+                           [10.0, 0.0, 0.0]])
+        voxels = cython_SVR.locate_points(points, min_bound, max_bound, num_radial_sections,
+                                          num_polar_sections, num_azimuthal_sections, sphere_center)
+        expected_voxels = [[2, 0, 0], [4, 1, 1], [1, 0, 2], [-1, -1, -1]]
+        self.assertListEqual(voxels.tolist(), expected_voxels)
+
+        no_voxels = cython_SVR.locate_points(np.empty((0, 3)), min_bound, max_bound, num_radial_sections,
+                                             num_polar_sections, num_azimuthal_sections, sphere_center)
+        assert no_voxels.shape == (0, 3)
+
+    def test_walk_spherical_volume_batch(self):
+        sphere_center = np.array([0.0, 0.0, 0.0])
+        sphere_max_radius = 10.0
+        num_radial_sections = 4
+        num_polar_sections = 4
+        num_azimuthal_sections = 4
+        min_bound = np.array([0.0, 0.0, 0.0])
+        max_bound = np.array([sphere_max_radius, 2 * np.pi, 2 * np.pi])
+        ray_origins = np.array([[-13.0, -13.0, -13.0],
+                                [15.0, 15.0, 15.0],
+                                [-3.0, 4.0, 5.0]])
+        ray_directions = np.array([[1.0, 1.0, 1.0],
+                                   [0.0, 0.0, 1.0],
+                                   [1.0, -1.0, -1.0]])
+        columns = cython_SVR.walk_spherical_volume_batch(ray_origins, ray_directions, min_bound, max_bound,
+                                                         num_radial_sections, num_polar_sections,
+                                                         num_azimuthal_sections, sphere_center)
+        self.assertListEqual(columns['count'].tolist(), [8, 0, 9])
+        for i in range(ray_origins.shape[0]):
+            voxels = cython_SVR.walk_spherical_volume(ray_origins[i].copy(), ray_directions[i].copy(), min_bound,
+                                                      max_bound, num_radial_sections, num_polar_sections,
+                                                      num_azimuthal_sections, sphere_center)
+            rows = slice(columns['first'][i], columns['first'][i] + columns['count'][i])
+            actual = np.stack([columns['radial'][rows], columns['polar'][rows], columns['azimuthal'][rows]], axis=1)
+            self.assertListEqual(actual.reshape(-1, 3).tolist(), voxels.reshape(-1, 3).tolist())
+            assert np.all(columns['exit_t'][rows] >= columns['enter_t'][rows])
+
 
 if __name__ == '__main__':
     unittest.main()
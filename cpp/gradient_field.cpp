@@ -0,0 +1,142 @@
+#include "gradient_field.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "parallel_util.h"
+
+namespace svr {
+
+namespace {
+
+// Returns the difference between the neighbors of voxel i per voxel, along a
+// dimension whose voxel j is at line[offsets[j]], where 'offsets' are those of
+// the dimension within the layout of the field. The neighbors wrap around if
+// 'wraps', and are otherwise clamped to the dimension, in which case the
+// difference is one-sided.
+inline double difference(const double *line,
+                         const std::vector<std::size_t> &offsets,
+                         std::size_t i, bool wraps) noexcept {
+  const std::size_t n = offsets.size();
+  if (n < 2) return 0.0;
+  std::size_t lower = i - 1, upper = i + 1;
+  double distance = 2.0;
+  if (i == 0) {
+    lower = wraps ? n - 1 : 0;
+    if (!wraps) distance = 1.0;
+  }
+  if (upper == n) {
+    upper = wraps ? 0 : i;
+    if (!wraps) distance = 1.0;
+  }
+  return (line[offsets[upper]] - line[offsets[lower]]) / distance;
+}
+
+// Converts the partial derivatives of a function with respect to the radius,
+// polar angle, and azimuthal angle at the given position to its Cartesian
+// gradient. As in the grid, the polar angle is measured within the xy-plane
+// and the azimuthal angle within the xz-plane, both from the x-axis.
+inline FreeVec3 cartesianGradient(double radius, double polar,
+                                  double azimuthal, double df_dradius,
+                                  double df_dpolar,
+                                  double df_dazimuthal) noexcept {
+  const double cos_polar = std::cos(polar), sin_polar = std::sin(polar);
+  const double cos_azimuthal = std::cos(azimuthal);
+  const double sin_azimuthal = std::sin(azimuthal);
+  // The x-coordinate of a position has the sign of both cosines. Where their
+  // signs differ, no position has both angles, and the angles are treated as
+  // if the signs were equal.
+  double xy_weight = std::abs(cos_azimuthal), xz_weight = std::abs(cos_polar);
+  if (xy_weight == 0.0 && xz_weight == 0.0) xy_weight = xz_weight = 1.0;
+  const double norm = std::hypot(xy_weight, xz_weight * sin_azimuthal);
+  const FreeVec3 direction(cos_polar * xy_weight / norm,
+                           sin_polar * xy_weight / norm,
+                           sin_azimuthal * xz_weight / norm);
+  // The distances of the position from the z-axis and the y-axis.
+  const double xy_distance = radius * xy_weight / norm;
+  const double xz_distance = radius * xz_weight / norm;
+  FreeVec3 gradient = direction * df_dradius;
+  if (xy_distance > 0.0) {
+    gradient +=
+        FreeVec3(-sin_polar, cos_polar, 0.0) * (df_dpolar / xy_distance);
+  }
+  if (xz_distance > 0.0) {
+    gradient += FreeVec3(-sin_azimuthal, 0.0, cos_azimuthal) *
+                (df_dazimuthal / xz_distance);
+  }
+  return gradient;
+}
+
+}  // namespace
+
+SphericalGradientField::SphericalGradientField(const SphericalVoxelField &field,
+                                               std::size_t num_threads) noexcept
+    : field_(&field), scale_(0.0), gradients_(3 * field.values().size()) {
+  const SphericalVoxelGrid &grid = field.grid();
+  const std::size_t num_radial_sections = grid.numRadialSections();
+  const std::size_t num_polar_sections = grid.numPolarSections();
+  const std::size_t num_azimuthal_sections = grid.numAzimuthalSections();
+  const VoxelLayout &layout = field.layout();
+  const std::vector<std::size_t> &radial_offsets = layout.radialOffsets();
+  const std::vector<std::size_t> &polar_offsets = layout.polarOffsets();
+  const std::vector<std::size_t> &azimuthal_offsets =
+      layout.azimuthalOffsets();
+  const double *values = field.values().data();
+  std::vector<double> gradients(gradients_.size());
+  // The maximum absolute gradient component within each radial shell.
+  std::vector<double> max_components(num_radial_sections, 0.0);
+  parallelFor(num_radial_sections, num_threads, [&](std::size_t r) {
+    const double radius =
+        grid.sphereMaxRadius() - (static_cast<double>(r) + 0.5) *
+                                     grid.deltaRadius();
+    double max_component = 0.0;
+    for (std::size_t p = 0; p < num_polar_sections; ++p) {
+      const double polar =
+          grid.sphereMinBoundPolar() +
+          (static_cast<double>(p) + 0.5) * grid.deltaTheta();
+      for (std::size_t a = 0; a < num_azimuthal_sections; ++a) {
+        const double azimuthal =
+            grid.sphereMinBoundAzi() +
+            (static_cast<double>(a) + 0.5) * grid.deltaPhi();
+        const std::size_t radial_offset = radial_offsets[r];
+        const std::size_t polar_offset = polar_offsets[p];
+        const std::size_t azimuthal_offset = azimuthal_offsets[a];
+        const std::size_t index =
+            radial_offset + polar_offset + azimuthal_offset;
+        // The radial index increases toward the sphere center.
+        const double df_dradius =
+            -difference(values + polar_offset + azimuthal_offset,
+                        radial_offsets, r, /*wraps=*/false) /
+            grid.deltaRadius();
+        const double df_dpolar =
+            difference(values + radial_offset + azimuthal_offset,
+                       polar_offsets, p, field.polarWraps()) /
+            grid.deltaTheta();
+        const double df_dazimuthal =
+            difference(values + radial_offset + polar_offset,
+                       azimuthal_offsets, a, field.azimuthalWraps()) /
+            grid.deltaPhi();
+        const FreeVec3 gradient =
+            cartesianGradient(radius, polar, azimuthal, df_dradius, df_dpolar,
+                              df_dazimuthal);
+        for (std::size_t i = 0; i < 3; ++i) {
+          gradients[3 * index + i] = gradient[i];
+          max_component = std::max(max_component, std::abs(gradient[i]));
+        }
+      }
+    }
+    max_components[r] = max_component;
+  });
+  const double max_component =
+      *std::max_element(max_components.begin(), max_components.end());
+  if (!(max_component > 0.0)) return;
+  scale_ = max_component / std::numeric_limits<std::int16_t>::max();
+  const double inverse_scale = 1.0 / scale_;
+  for (std::size_t i = 0; i < gradients.size(); ++i) {
+    gradients_[i] =
+        static_cast<std::int16_t>(std::lround(gradients[i] * inverse_scale));
+  }
+}
+
+}  // namespace svr
@@ -0,0 +1,80 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_GRADIENTFIELD_H
+#define SPHERICAL_VOLUME_RENDERING_GRADIENTFIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "spherical_volume_rendering_util.h"
+#include "spherical_voxel_field.h"
+#include "vec3.h"
+
+namespace svr {
+
+// The interpolated value and the gradient of a field at a sample.
+struct FieldSample {
+  double value;
+  FreeVec3 gradient;
+};
+
+// The Cartesian gradients of a SphericalVoxelField, with one gradient per
+// voxel in the layout of the field. Each gradient is estimated with central
+// differences between neighboring voxel values in (radius, polar, azimuthal),
+// and converted to Cartesian coordinates with the chain rule at the voxel
+// center, so lighting needs no per-sample conversion. The differences are
+// one-sided at the radial ends, and at the angular ends of a sectored grid.
+// Each component is quantized to 16 bits with a single scale for the entire
+// field. The field must outlive the gradients.
+class SphericalGradientField {
+ public:
+  // Computes the gradients with the given number of threads. If num_threads
+  // is 0, the number of hardware threads is used.
+  explicit SphericalGradientField(const SphericalVoxelField &field,
+                                  std::size_t num_threads = 0) noexcept;
+
+  inline FreeVec3 gradient(int radial, int polar,
+                           int azimuthal) const noexcept {
+    const std::int16_t *components =
+        &this->gradients_[3 * field_->index(radial, polar, azimuthal)];
+    return FreeVec3(components[0] * scale_, components[1] * scale_,
+                    components[2] * scale_);
+  }
+
+  inline FreeVec3 gradient(const SphericalVoxel &voxel) const noexcept {
+    return this->gradient(voxel.radial, voxel.polar, voxel.azimuthal);
+  }
+
+  // The gradient component represented by a single quantization step. Each
+  // component is within half a step of its unquantized value.
+  inline double scale() const noexcept { return this->scale_; }
+
+  inline const SphericalVoxelField &field() const noexcept {
+    return *this->field_;
+  }
+
+  // Interpolates the field at each of the num_samples samples within the
+  // given voxel, e.g. those of sampleVoxel(), and stores each value with the
+  // gradient of the voxel in 'field_samples'.
+  inline void sample(const SphericalVoxel &voxel, const VoxelSample *samples,
+                     std::size_t num_samples,
+                     FieldSample *field_samples) const noexcept {
+    const FreeVec3 voxel_gradient = this->gradient(voxel);
+    for (std::size_t i = 0; i < num_samples; ++i) {
+      field_samples[i] = {.value = field_->interpolate(samples[i]),
+                          .gradient = voxel_gradient};
+    }
+  }
+
+ private:
+  // The field of which the gradients are computed.
+  const SphericalVoxelField *field_;
+
+  double scale_;
+
+  // The quantized x, y, and z components of each voxel's gradient.
+  std::vector<std::int16_t> gradients_;
+};
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_GRADIENTFIELD_H
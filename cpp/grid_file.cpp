@@ -0,0 +1,407 @@
+#include "grid_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SVR_HAS_MMAP 1
+#endif
+
+namespace svr {
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'V', 'R', 'G', 'R', 'I', 'D', '\0'};
+constexpr std::uint32_t VERSION = 1;
+
+// Written in the byte order of the writer, so a reader of another byte order
+// reads a different value.
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+// The alignment of each section from the start of the file, i.e. a cache line.
+constexpr std::size_t SECTION_ALIGNMENT = 64;
+
+// The number of names tried for the temporary file of a writer before giving
+// up, should files of those names already exist.
+constexpr int MAX_TEMPORARY_FILE_ATTEMPTS = 100;
+
+// The names of the sections that hold the grid. Names with this prefix are
+// reserved for the grid.
+constexpr char RESERVED_PREFIX[] = "svr.";
+constexpr char GRID_PARAMETERS[] = "svr.grid";
+constexpr char DELTA_RADII_SQUARED[] = "svr.delta_radii_squared";
+constexpr char POLAR_TRIG_VALUES[] = "svr.polar_trig_values";
+constexpr char AZIMUTHAL_TRIG_VALUES[] = "svr.azimuthal_trig_values";
+constexpr char P_MAX_POLAR[] = "svr.p_max_polar";
+constexpr char P_MAX_AZIMUTHAL[] = "svr.p_max_azimuthal";
+constexpr char CENTER_TO_POLAR_BOUNDS[] = "svr.center_to_polar_bounds";
+constexpr char CENTER_TO_AZIMUTHAL_BOUNDS[] = "svr.center_to_azimuthal_bounds";
+
+// The file begins with the header, followed by one entry per section.
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint64_t num_sections;
+  std::uint64_t reserved;
+};
+
+// A section of the file, which is 'size' bytes at 'offset' from the start of
+// the file. The name is null-terminated.
+struct SectionEntry {
+  char name[48];
+  std::uint64_t offset;
+  std::uint64_t size;
+};
+
+// The parameters with which the grid was constructed.
+struct GridParameters {
+  double min_bound[3];
+  double max_bound[3];
+  double sphere_center[3];
+  std::uint64_t num_sections[3];
+};
+
+inline bool isReserved(const std::string &name) noexcept {
+  return name.compare(0, sizeof(RESERVED_PREFIX) - 1, RESERVED_PREFIX) == 0;
+}
+
+inline std::size_t alignSection(std::size_t offset) noexcept {
+  return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+// The tables of vectors are written, and read in place, as three coordinates
+// per vector.
+static_assert(sizeof(BoundVec3) == 3 * sizeof(double),
+              "A BoundVec3 is not stored as three coordinates.");
+
+// Returns the section with the given name, or nullptr if there is none.
+const GridSection *findSection(const std::vector<GridSection> &sections,
+                               const std::string &name) noexcept {
+  for (const GridSection &section : sections) {
+    if (section.name == name) return &section;
+  }
+  return nullptr;
+}
+
+// Stores in 'table' the section, which must hold exactly 'count' values of
+// type T, in place. Returns false if the section is missing or of another
+// size.
+template <typename T>
+bool readTable(const GridSection *section, std::size_t count,
+               const T *&table) noexcept {
+  if (section == nullptr || section->size % sizeof(T) != 0 ||
+      section->size / sizeof(T) != count) {
+    return false;
+  }
+  table = static_cast<const T *>(section->data);
+  return true;
+}
+
+// Creates and opens for writing a file alongside 'path' that no other writer
+// uses, and stores its name in 'temporary_path'. The name is unique to the
+// process and the call, and the file is created exclusively, so concurrent
+// writers of the same path never share a temporary file. Unlike mkstemp(),
+// the file is created with the permissions of the umask, like fopen(), so
+// other processes may map it once renamed. Returns nullptr on failure.
+std::FILE *createTemporaryFile(const std::string &path,
+                               std::string &temporary_path) noexcept {
+  static std::atomic<unsigned long> num_temporary_files(0);
+#ifdef SVR_HAS_MMAP
+  const unsigned long process = static_cast<unsigned long>(getpid());
+#else
+  const unsigned long process = 0;
+#endif
+  for (int attempt = 0; attempt < MAX_TEMPORARY_FILE_ATTEMPTS; ++attempt) {
+    temporary_path = path + "." + std::to_string(process) + "." +
+                     std::to_string(num_temporary_files++) + ".tmp";
+#ifdef SVR_HAS_MMAP
+    const int fd =
+        open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0) {
+      if (errno == EEXIST) continue;
+      return nullptr;
+    }
+    std::FILE *file = fdopen(fd, "wb");
+    if (file == nullptr) {
+      close(fd);
+      std::remove(temporary_path.c_str());
+    }
+    return file;
+#else
+    // The "x" mode of C11 creates the file exclusively.
+    std::FILE *file = std::fopen(temporary_path.c_str(), "wbx");
+    if (file != nullptr) return file;
+#endif
+  }
+  return nullptr;
+}
+
+// Writes 'size' zero bytes.
+bool writePadding(std::FILE *file, std::size_t size) noexcept {
+  static const char zeros[SECTION_ALIGNMENT] = {};
+  return size == 0 || std::fwrite(zeros, 1, size, file) == size;
+}
+
+}  // namespace
+
+bool writeGridFile(const std::string &path, const SphericalVoxelGrid &grid,
+                   const std::vector<GridSection> &sections) noexcept {
+  const GridParameters parameters = {
+      .min_bound = {grid.sphereMinRadius(), grid.sphereMinBoundPolar(),
+                    grid.sphereMinBoundAzi()},
+      .max_bound = {grid.sphereMaxRadius(), grid.sphereMaxBoundPolar(),
+                    grid.sphereMaxBoundAzi()},
+      .sphere_center = {grid.sphereCenter().x(), grid.sphereCenter().y(),
+                        grid.sphereCenter().z()},
+      .num_sections = {grid.numRadialSections(), grid.numPolarSections(),
+                       grid.numAzimuthalSections()}};
+  std::vector<GridSection> all_sections = {
+      {GRID_PARAMETERS, &parameters, sizeof(parameters)},
+      {DELTA_RADII_SQUARED, grid.deltaRadiiSquared().data(),
+       grid.deltaRadiiSquared().size() * sizeof(double)},
+      {POLAR_TRIG_VALUES, grid.polarTrigValues().data(),
+       grid.polarTrigValues().size() * sizeof(TrigonometricValues)},
+      {AZIMUTHAL_TRIG_VALUES, grid.azimuthalTrigValues().data(),
+       grid.azimuthalTrigValues().size() * sizeof(TrigonometricValues)},
+      {P_MAX_POLAR, grid.pMaxPolar().data(),
+       grid.pMaxPolar().size() * sizeof(LineSegment)},
+      {P_MAX_AZIMUTHAL, grid.pMaxAzimuthal().data(),
+       grid.pMaxAzimuthal().size() * sizeof(LineSegment)},
+      {CENTER_TO_POLAR_BOUNDS, grid.centerToPolarBounds().data(),
+       grid.centerToPolarBounds().size() * sizeof(BoundVec3)},
+      {CENTER_TO_AZIMUTHAL_BOUNDS, grid.centerToAzimuthalBounds().data(),
+       grid.centerToAzimuthalBounds().size() * sizeof(BoundVec3)}};
+  std::vector<std::string> names;
+  for (const GridSection &section : sections) {
+    if (isReserved(section.name)) return false;
+    all_sections.push_back(section);
+  }
+  for (const GridSection &section : all_sections) {
+    if (section.name.size() >= sizeof(SectionEntry::name)) return false;
+    names.push_back(section.name);
+  }
+  std::sort(names.begin(), names.end());
+  if (std::adjacent_find(names.begin(), names.end()) != names.end()) {
+    return false;
+  }
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.byte_order = BYTE_ORDER_MARK;
+  header.num_sections = all_sections.size();
+  std::vector<SectionEntry> entries(all_sections.size());
+  std::size_t offset = alignSection(
+      sizeof(FileHeader) + entries.size() * sizeof(SectionEntry));
+  for (std::size_t i = 0; i < all_sections.size(); ++i) {
+    std::memset(&entries[i], 0, sizeof(SectionEntry));
+    std::memcpy(entries[i].name, all_sections[i].name.data(),
+                all_sections[i].name.size());
+    entries[i].offset = offset;
+    entries[i].size = all_sections[i].size;
+    offset = alignSection(offset + all_sections[i].size);
+  }
+
+  std::string temporary_path;
+  std::FILE *file = createTemporaryFile(path, temporary_path);
+  if (file == nullptr) return false;
+  bool written =
+      std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+      std::fwrite(entries.data(), sizeof(SectionEntry), entries.size(),
+                  file) == entries.size();
+  std::size_t position =
+      sizeof(FileHeader) + entries.size() * sizeof(SectionEntry);
+  for (std::size_t i = 0; written && i < all_sections.size(); ++i) {
+    const GridSection &section = all_sections[i];
+    written = writePadding(file, entries[i].offset - position) &&
+              (section.size == 0 ||
+               std::fwrite(section.data, 1, section.size, file) ==
+                   section.size);
+    position = entries[i].offset + section.size;
+  }
+  written = std::fclose(file) == 0 && written;
+  if (!written || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    std::remove(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+MappedGridFile::MappedGridFile(const std::string &path) noexcept
+    : data_(nullptr), size_(0) {
+#ifdef SVR_HAS_MMAP
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0) {
+      const std::size_t size = static_cast<std::size_t>(status.st_size);
+      void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (mapping != MAP_FAILED) {
+        contents_.reset(mapping, [size](void *mapping) noexcept {
+          munmap(mapping, size);
+        });
+        data_ = static_cast<const unsigned char *>(mapping);
+        size_ = size;
+      }
+    }
+    close(fd);
+  }
+#endif
+  if (data_ == nullptr) {
+    // The buffer holds 64-bit words, so that the sections are aligned for any
+    // fundamental type.
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) return;
+    std::vector<unsigned char> contents;
+    unsigned char chunk[1 << 16];
+    std::size_t read;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file)) != 0) {
+      contents.insert(contents.end(), chunk, chunk + read);
+    }
+    std::fclose(file);
+    const std::shared_ptr<std::vector<std::uint64_t>> buffer =
+        std::make_shared<std::vector<std::uint64_t>>(
+            (contents.size() + sizeof(std::uint64_t) - 1) /
+            sizeof(std::uint64_t));
+    if (!contents.empty()) {
+      std::memcpy(buffer->data(), contents.data(), contents.size());
+    }
+    data_ = reinterpret_cast<const unsigned char *>(buffer->data());
+    size_ = contents.size();
+    contents_ = std::shared_ptr<const void>(buffer, data_);
+  }
+  if (!this->parse()) this->release();
+}
+
+MappedGridFile::MappedGridFile(MappedGridFile &&other) noexcept
+    : contents_(std::move(other.contents_)),
+      data_(other.data_),
+      size_(other.size_),
+      grid_(std::move(other.grid_)),
+      sections_(std::move(other.sections_)) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.sections_.clear();
+}
+
+MappedGridFile &MappedGridFile::operator=(MappedGridFile &&other) noexcept {
+  if (this == &other) return *this;
+  contents_ = std::move(other.contents_);
+  data_ = other.data_;
+  size_ = other.size_;
+  grid_ = std::move(other.grid_);
+  sections_ = std::move(other.sections_);
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.sections_.clear();
+  return *this;
+}
+
+MappedGridFile::~MappedGridFile() noexcept { this->release(); }
+
+const GridSection *MappedGridFile::section(
+    const std::string &name) const noexcept {
+  return findSection(sections_, name);
+}
+
+bool MappedGridFile::parse() noexcept {
+  FileHeader header;
+  if (data_ == nullptr || size_ < sizeof(header)) return false;
+  std::memcpy(&header, data_, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION || header.byte_order != BYTE_ORDER_MARK ||
+      header.num_sections >
+          (size_ - sizeof(header)) / sizeof(SectionEntry)) {
+    return false;
+  }
+  std::vector<GridSection> sections;
+  sections.reserve(header.num_sections);
+  for (std::size_t i = 0; i < header.num_sections; ++i) {
+    SectionEntry entry;
+    std::memcpy(&entry, data_ + sizeof(header) + i * sizeof(entry),
+                sizeof(entry));
+    if (entry.name[sizeof(entry.name) - 1] != '\0' || entry.offset > size_ ||
+        entry.size > size_ - entry.offset ||
+        entry.offset % SECTION_ALIGNMENT != 0) {
+      return false;
+    }
+    sections.push_back({.name = entry.name,
+                        .data = data_ + entry.offset,
+                        .size = static_cast<std::size_t>(entry.size)});
+  }
+
+  const GridSection *parameters_section =
+      findSection(sections, GRID_PARAMETERS);
+  if (parameters_section == nullptr ||
+      parameters_section->size != sizeof(GridParameters)) {
+    return false;
+  }
+  GridParameters parameters;
+  std::memcpy(&parameters, parameters_section->data, sizeof(parameters));
+  const std::size_t num_radial_sections = parameters.num_sections[0];
+  const std::size_t num_polar_sections = parameters.num_sections[1];
+  const std::size_t num_azimuthal_sections = parameters.num_sections[2];
+  // Bounding the counts by the file size also bounds the table sizes below.
+  if (num_radial_sections == 0 || num_polar_sections == 0 ||
+      num_azimuthal_sections == 0 || num_radial_sections >= size_ ||
+      num_polar_sections >= size_ || num_azimuthal_sections >= size_) {
+    return false;
+  }
+  // The tables are read in place, and keep the contents of the file alive for
+  // as long as any grid shares them.
+  SphericalVoxelGridTables tables;
+  tables.storage = contents_;
+  if (!readTable(findSection(sections, DELTA_RADII_SQUARED),
+                 num_radial_sections + 1, tables.delta_radii_sq) ||
+      !readTable(findSection(sections, POLAR_TRIG_VALUES),
+                 num_polar_sections + 1, tables.polar_trig_values) ||
+      !readTable(findSection(sections, AZIMUTHAL_TRIG_VALUES),
+                 num_azimuthal_sections + 1, tables.azimuthal_trig_values) ||
+      !readTable(findSection(sections, P_MAX_POLAR), num_polar_sections + 1,
+                 tables.P_max_polar) ||
+      !readTable(findSection(sections, P_MAX_AZIMUTHAL),
+                 num_azimuthal_sections + 1, tables.P_max_azimuthal) ||
+      !readTable(findSection(sections, CENTER_TO_POLAR_BOUNDS),
+                 num_polar_sections + 1,
+                 tables.center_to_polar_bound_vectors) ||
+      !readTable(findSection(sections, CENTER_TO_AZIMUTHAL_BOUNDS),
+                 num_azimuthal_sections + 1,
+                 tables.center_to_azimuthal_bound_vectors)) {
+    return false;
+  }
+  grid_.reset(new SphericalVoxelGrid(
+      {.radial = parameters.min_bound[0],
+       .polar = parameters.min_bound[1],
+       .azimuthal = parameters.min_bound[2]},
+      {.radial = parameters.max_bound[0],
+       .polar = parameters.max_bound[1],
+       .azimuthal = parameters.max_bound[2]},
+      num_radial_sections, num_polar_sections, num_azimuthal_sections,
+      BoundVec3(parameters.sphere_center[0], parameters.sphere_center[1],
+                parameters.sphere_center[2]),
+      std::make_shared<const SphericalVoxelGridTables>(std::move(tables))));
+  for (GridSection &section : sections) {
+    if (!isReserved(section.name)) sections_.push_back(std::move(section));
+  }
+  return true;
+}
+
+void MappedGridFile::release() noexcept {
+  contents_.reset();
+  data_ = nullptr;
+  size_ = 0;
+  grid_.reset();
+  sections_.clear();
+}
+
+}  // namespace svr
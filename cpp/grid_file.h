@@ -0,0 +1,110 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_GRIDFILE_H
+#define SPHERICAL_VOLUME_RENDERING_GRIDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "spherical_voxel_grid.h"
+
+namespace svr {
+
+// A named block of bytes stored with a grid in a grid file, e.g. the values of
+// a field or an acceleration structure computed over the grid.
+struct GridSection {
+  std::string name;
+  const void *data;
+  std::size_t size;
+};
+
+// Writes the grid, with its precomputed tables, and the given sections to a
+// binary grid file at 'path'. Each section begins at a multiple of 64 bytes
+// from the start of the file, so arrays of any fundamental type may be read
+// in place once the file is mapped. The file is written to a temporary file
+// alongside 'path', unique to the writer, and then renamed over 'path'. A
+// process that maps the previous file keeps a consistent view, and of
+// concurrent writers of the same path, the last to finish wins. The file is
+// in the byte order of the writer. Returns false if the section names are not
+// unique, or if the file cannot be written.
+bool writeGridFile(
+    const std::string &path, const SphericalVoxelGrid &grid,
+    const std::vector<GridSection> &sections = std::vector<GridSection>())
+    noexcept;
+
+// A grid file mapped read-only into memory. The tables of the grid and the
+// sections are read in place from the mapping rather than computed or copied,
+// so their pages are loaded on first access and shared with every other
+// process that maps the same file. Where mmap() is unavailable, the file is
+// read into memory instead. A file that cannot be read, or that is not a grid
+// file of this version and byte order, is not valid(). Sections remain valid
+// for the lifetime of the mapping; the grid, and copies of it, keep the
+// mapping alive for as long as they share its tables.
+class MappedGridFile {
+ public:
+  explicit MappedGridFile(const std::string &path) noexcept;
+
+  MappedGridFile(MappedGridFile &&other) noexcept;
+
+  MappedGridFile &operator=(MappedGridFile &&other) noexcept;
+
+  MappedGridFile(const MappedGridFile &) = delete;
+
+  MappedGridFile &operator=(const MappedGridFile &) = delete;
+
+  ~MappedGridFile() noexcept;
+
+  inline bool valid() const noexcept { return this->grid_ != nullptr; }
+
+  // The grid stored in the file, which is only defined if valid(). Copies of
+  // the grid share its tables, and may outlive the file.
+  inline const SphericalVoxelGrid &grid() const noexcept {
+    return *this->grid_;
+  }
+
+  // The sections stored with the grid, in the order written.
+  inline const std::vector<GridSection> &sections() const noexcept {
+    return this->sections_;
+  }
+
+  // Returns the section with the given name, or nullptr if there is none.
+  const GridSection *section(const std::string &name) const noexcept;
+
+  // Returns the data of the section with the given name as an array of T, and
+  // stores its length in 'count'. Returns nullptr if there is no such section,
+  // or if its size is not a multiple of sizeof(T).
+  template <typename T>
+  inline const T *sectionArray(const std::string &name,
+                               std::size_t &count) const noexcept {
+    count = 0;
+    const GridSection *found = this->section(name);
+    if (found == nullptr || found->size % sizeof(T) != 0) return nullptr;
+    count = found->size / sizeof(T);
+    return static_cast<const T *>(found->data);
+  }
+
+ private:
+  // Parses the header, the grid, and the sections of the file. Returns false
+  // if the file is not a valid grid file.
+  bool parse() noexcept;
+
+  // Releases this file's reference to the mapping or buffer of the file.
+  void release() noexcept;
+
+  // The contents of the file: the mapping, or a buffer of 64-bit words into
+  // which the file is read, so that the sections are aligned for any
+  // fundamental type. The tables of grid_ share ownership of the contents.
+  std::shared_ptr<const void> contents_;
+  const unsigned char *data_;
+  std::size_t size_;
+
+  std::unique_ptr<SphericalVoxelGrid> grid_;
+
+  // The sections other than those of the grid, which point into data_.
+  std::vector<GridSection> sections_;
+};
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_GRIDFILE_H
@@ -0,0 +1,202 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_HUGEPAGEALLOCATOR_H
+#define SPHERICAL_VOLUME_RENDERING_HUGEPAGEALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace svr {
+
+// The pages with which a HugePageAllocator backs its allocations.
+enum HugePagePolicy {
+  // Allocations are made with operator new, i.e. with base pages.
+  BASE_PAGES = 0,
+
+  // Allocations are mapped at a huge page boundary and advised with
+  // MADV_HUGEPAGE, so the kernel backs them with transparent huge pages when
+  // they are enabled as "always" or "madvise".
+  TRANSPARENT_HUGE_PAGES = 1,
+
+  // Allocations are mapped from the reserved huge page pool with MAP_HUGETLB.
+  // If the pool has too few free pages, the allocation falls back to
+  // TRANSPARENT_HUGE_PAGES.
+  EXPLICIT_HUGE_PAGES = 2
+};
+
+// The log2 and size of the huge pages requested, i.e. the PMD-sized pages of
+// x86-64, and of AArch64 with 4 KiB base pages. AArch64 kernels with 64 KiB
+// base pages default to 512 MiB huge pages instead, but provide 2 MiB pages
+// from contiguous base pages when requested by size.
+constexpr int HUGE_PAGE_SHIFT = 21;
+constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{1} << HUGE_PAGE_SHIFT;
+
+namespace internal {
+
+#ifdef MAP_HUGETLB
+// The flags with which MAP_HUGETLB requests pages of HUGE_PAGE_SIZE, rather
+// than of the kernel's default huge page size. Where the size may not be
+// requested, the default is used.
+#if defined(MAP_HUGE_2MB)
+constexpr int MAP_HUGETLB_FLAGS = MAP_HUGETLB | MAP_HUGE_2MB;
+#elif defined(MAP_HUGE_SHIFT)
+constexpr int MAP_HUGETLB_FLAGS =
+    MAP_HUGETLB | (HUGE_PAGE_SHIFT << MAP_HUGE_SHIFT);
+#else
+constexpr int MAP_HUGETLB_FLAGS = MAP_HUGETLB;
+#endif
+#endif
+
+// Maps 'size' bytes, a multiple of HUGE_PAGE_SIZE, aligned to HUGE_PAGE_SIZE.
+// Returns nullptr on failure.
+inline void *mapHugePages(std::size_t size, HugePagePolicy policy) noexcept {
+#ifdef __linux__
+#ifdef MAP_HUGETLB
+  if (policy == EXPLICIT_HUGE_PAGES) {
+    void *address =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB_FLAGS, -1, 0);
+    if (address != MAP_FAILED) return address;
+  }
+#endif
+  // Over-map by a huge page, and unmap the excess on either side of the
+  // first huge page boundary.
+  void *mapping = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) return nullptr;
+  const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(mapping);
+  const std::uintptr_t aligned =
+      (begin + HUGE_PAGE_SIZE - 1) & ~(std::uintptr_t{HUGE_PAGE_SIZE} - 1);
+  if (aligned != begin) munmap(mapping, aligned - begin);
+  const std::size_t tail = HUGE_PAGE_SIZE - (aligned - begin);
+  if (tail != 0) munmap(reinterpret_cast<void *>(aligned + size), tail);
+  void *address = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+  // The advice is only a hint, so a failure leaves base pages.
+  madvise(address, size, MADV_HUGEPAGE);
+#endif
+  return address;
+#else
+  (void)size;
+  (void)policy;
+  return nullptr;
+#endif
+}
+
+}  // namespace internal
+
+// An allocator for the value containers of large fields, e.g.
+// std::vector<double, HugePageAllocator<double>>. Rays stride across shells,
+// so the values read along a ray span many more base pages than the TLB
+// covers; with 2 MiB pages, a 256^3 field of doubles spans 64 pages rather
+// than 32768. The policy is chosen at runtime per allocator. Allocations
+// smaller than min_huge_page_bytes, and any allocation on platforms without
+// mmap, use operator new. Containers with allocators of different policies
+// may not exchange their storage.
+template <typename T>
+class HugePageAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = HugePageAllocator<U>;
+  };
+
+  explicit HugePageAllocator(
+      HugePagePolicy policy = TRANSPARENT_HUGE_PAGES,
+      std::size_t min_huge_page_bytes = HUGE_PAGE_SIZE) noexcept
+      : policy_(policy), min_huge_page_bytes_(min_huge_page_bytes) {}
+
+  template <typename U>
+  HugePageAllocator(const HugePageAllocator<U> &other) noexcept
+      : policy_(other.policy()),
+        min_huge_page_bytes_(other.minHugePageBytes()) {}
+
+  T *allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+    if (this->usesHugePages(n)) {
+      void *address = internal::mapHugePages(mappedSize(n), policy_);
+      if (address == nullptr) throw std::bad_alloc();
+      return static_cast<T *>(address);
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *pointer, std::size_t n) noexcept {
+#ifdef __linux__
+    if (this->usesHugePages(n)) {
+      munmap(pointer, mappedSize(n));
+      return;
+    }
+#endif
+    ::operator delete(pointer);
+  }
+
+  inline HugePagePolicy policy() const noexcept { return this->policy_; }
+
+  inline std::size_t minHugePageBytes() const noexcept {
+    return this->min_huge_page_bytes_;
+  }
+
+  // Whether an allocation of n values is mapped for huge pages.
+  inline bool usesHugePages(std::size_t n) const noexcept {
+#ifdef __linux__
+    return policy_ != BASE_PAGES && n != 0 &&
+           n * sizeof(T) >= min_huge_page_bytes_;
+#else
+    (void)n;
+    return false;
+#endif
+  }
+
+ private:
+  // The bytes mapped for n values, rounded up to whole huge pages.
+  static inline std::size_t mappedSize(std::size_t n) noexcept {
+    return (n * sizeof(T) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  }
+
+  HugePagePolicy policy_;
+  std::size_t min_huge_page_bytes_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const HugePageAllocator<T> &a,
+                       const HugePageAllocator<U> &b) noexcept {
+  return a.policy() == b.policy() &&
+         a.minHugePageBytes() == b.minHugePageBytes();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const HugePageAllocator<T> &a,
+                       const HugePageAllocator<U> &b) noexcept {
+  return !(a == b);
+}
+
+template <typename T>
+using HugePageVector = std::vector<T, HugePageAllocator<T>>;
+
+// Copies the values into a vector allocated with the given policy, e.g. for
+// the values of a BasicSphericalVoxelField<HugePageVector<double>>.
+template <typename T>
+HugePageVector<T> toHugePageVector(
+    const std::vector<T> &values,
+    HugePagePolicy policy = TRANSPARENT_HUGE_PAGES) {
+  return HugePageVector<T>(values.begin(), values.end(),
+                           HugePageAllocator<T>(policy));
+}
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_HUGEPAGEALLOCATOR_H
@@ -0,0 +1,129 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_PARALLELUTIL_H
+#define SPHERICAL_VOLUME_RENDERING_PARALLELUTIL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace svr {
+
+// Calls f(i) for each i within [0, num_items) with the given number of
+// threads. If num_threads is 0, the number of hardware threads is used.
+// Thread t handles the items t, t + num_threads, t + 2 * num_threads, ...,
+// so neighboring items are spread across threads. If a thread cannot be
+// created, its items are handled by the calling thread.
+template <typename F>
+inline void parallelFor(std::size_t num_items, std::size_t num_threads,
+                        const F &f) noexcept {
+  if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+  num_threads = std::min(std::max(num_threads, std::size_t{1}), num_items);
+  const auto handle_items = [&](std::size_t first_item) {
+    for (std::size_t i = first_item; i < num_items; i += num_threads) f(i);
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (std::size_t t = 1; t < num_threads; ++t) {
+    try {
+      threads.emplace_back(handle_items, t);
+    } catch (const std::system_error &) {
+      handle_items(t);
+    }
+  }
+  handle_items(0);
+  for (std::thread &thread : threads) thread.join();
+}
+
+// A bounded lock-free queue from a single producer thread to a single
+// consumer thread. Items are pushed and popped in batches, so the indices
+// shared between the threads are synchronized once per batch rather than per
+// item. The capacity is rounded up to a power of two.
+template <typename T>
+class SPSCRingBuffer {
+ public:
+  explicit SPSCRingBuffer(std::size_t capacity) noexcept
+      : slots_(roundUpToPowerOfTwo(std::max(capacity, std::size_t{1}))),
+        mask_(slots_.size() - 1) {}
+
+  inline std::size_t capacity() const noexcept { return this->slots_.size(); }
+
+  // Pushes up to n items, as many as there is room for, and returns the
+  // number pushed. Only called by the producer.
+  std::size_t tryPush(const T *items, std::size_t n) noexcept {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ + n > slots_.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    n = std::min(n, slots_.size() - (tail - cached_head_));
+    for (std::size_t i = 0; i < n; ++i) slots_[(tail + i) & mask_] = items[i];
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // Pushes all n items, yielding while the buffer is full, so a producer
+  // that outpaces its consumer is held back. Only called by the producer.
+  void push(const T *items, std::size_t n) noexcept {
+    for (;;) {
+      const std::size_t pushed = this->tryPush(items, n);
+      items += pushed;
+      n -= pushed;
+      if (n == 0) return;
+      std::this_thread::yield();
+    }
+  }
+
+  // Pops up to max_items items into 'items' and returns the number popped.
+  // Only called by the consumer.
+  std::size_t tryPop(T *items, std::size_t max_items) noexcept {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < max_items) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    const std::size_t n = std::min(max_items, cached_tail_ - head);
+    for (std::size_t i = 0; i < n; ++i) items[i] = slots_[(head + i) & mask_];
+    head_.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  // Marks that the producer pushes no more items. Only called by the
+  // producer.
+  inline void close() noexcept {
+    this->closed_.store(true, std::memory_order_release);
+  }
+
+  // Whether the producer has closed the buffer and every item was popped.
+  // Only called by the consumer.
+  inline bool drained() const noexcept {
+    return closed_.load(std::memory_order_acquire) &&
+           head_.load(std::memory_order_relaxed) ==
+               tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static std::size_t roundUpToPowerOfTwo(std::size_t n) noexcept {
+    std::size_t power = 1;
+    while (power < n) power <<= 1;
+    return power;
+  }
+
+  std::vector<T> slots_;
+  const std::size_t mask_;
+
+  // The number of items popped, and the consumer's copy of tail_. The
+  // padding keeps these on a separate cache line from the producer's indices.
+  char consumer_padding_[64];
+  std::atomic<std::size_t> head_{0};
+  std::size_t cached_tail_ = 0;
+  char producer_padding_[64];
+
+  // The number of items pushed, and the producer's copy of head_.
+  std::atomic<std::size_t> tail_{0};
+  std::size_t cached_head_ = 0;
+  std::atomic<bool> closed_{false};
+};
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_PARALLELUTIL_H
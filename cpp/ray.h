@@ -6,7 +6,7 @@
 // Encapsulates the functionality of a ray. This consists of two components, the
 // origin of the ray, and the unit direction of the ray. To avoid checking for a
 // non-zero direction upon each function call, these parameters are initialized
-// upon construction.
+// upon construction. A ray cannot be mutated, though it may be reassigned.
 struct Ray final {
   inline Ray(const BoundVec3 &origin, const UnitVec3 &direction)
       : origin_(origin),
@@ -56,16 +56,16 @@ struct Ray final {
 
  private:
   // The origin of the ray.
-  const BoundVec3 origin_;
+  BoundVec3 origin_;
 
   // The direction of the ray.
-  const UnitVec3 direction_;
+  UnitVec3 direction_;
 
   // The inverse direction of the ray.
-  const FreeVec3 inverse_direction_;
+  FreeVec3 inverse_direction_;
 
   // Index of a non-zero direction.
-  const enum DirectionIndex NZD_index_;
+  DirectionIndex NZD_index_;
 };
 
 #endif  // SPHERICAL_VOLUME_RENDERING_RAY_H
@@ -0,0 +1,73 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_RAY_BATCH_H
+#define SPHERICAL_VOLUME_RENDERING_RAY_BATCH_H
+
+#include <vector>
+
+#include "ray.h"
+#include "vec3.h"
+
+// Encapsulates a batch of rays in structure-of-arrays form. Unlike Ray, the
+// direction of each ray is stored as given; it is only normalized, and its
+// inverse calculated, when the Ray itself is constructed with ray(i). This
+// allows batch pre-passes to operate over contiguous coordinate arrays.
+struct RayBatch final {
+  inline void reserve(std::size_t num_rays) {
+    origin_x_.reserve(num_rays);
+    origin_y_.reserve(num_rays);
+    origin_z_.reserve(num_rays);
+    direction_x_.reserve(num_rays);
+    direction_y_.reserve(num_rays);
+    direction_z_.reserve(num_rays);
+  }
+
+  inline void push_back(const BoundVec3 &origin, const FreeVec3 &direction) {
+    origin_x_.push_back(origin.x());
+    origin_y_.push_back(origin.y());
+    origin_z_.push_back(origin.z());
+    direction_x_.push_back(direction.x());
+    direction_y_.push_back(direction.y());
+    direction_z_.push_back(direction.z());
+  }
+
+  inline std::size_t size() const noexcept { return this->origin_x_.size(); }
+
+  inline BoundVec3 origin(std::size_t i) const noexcept {
+    return BoundVec3(origin_x_[i], origin_y_[i], origin_z_[i]);
+  }
+
+  inline FreeVec3 direction(std::size_t i) const noexcept {
+    return FreeVec3(direction_x_[i], direction_y_[i], direction_z_[i]);
+  }
+
+  // Constructs the i-th ray of the batch.
+  inline Ray ray(std::size_t i) const noexcept {
+    return Ray(this->origin(i), UnitVec3(this->direction(i)));
+  }
+
+  inline const double *originX() const noexcept { return origin_x_.data(); }
+
+  inline const double *originY() const noexcept { return origin_y_.data(); }
+
+  inline const double *originZ() const noexcept { return origin_z_.data(); }
+
+  inline const double *directionX() const noexcept {
+    return direction_x_.data();
+  }
+
+  inline const double *directionY() const noexcept {
+    return direction_y_.data();
+  }
+
+  inline const double *directionZ() const noexcept {
+    return direction_z_.data();
+  }
+
+ private:
+  // The origin of each ray.
+  std::vector<double> origin_x_, origin_y_, origin_z_;
+
+  // The direction of each ray. These are not necessarily unit length.
+  std::vector<double> direction_x_, direction_y_, direction_z_;
+};
+
+#endif  // SPHERICAL_VOLUME_RENDERING_RAY_BATCH_H
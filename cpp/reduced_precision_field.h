@@ -0,0 +1,212 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_REDUCEDPRECISIONFIELD_H
+#define SPHERICAL_VOLUME_RENDERING_REDUCEDPRECISIONFIELD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+#include "spherical_voxel_field.h"
+
+// Value containers of reduced precision for BasicSphericalVoxelField. A
+// field of 512^3 doubles takes 1 GiB; the containers below take a quarter
+// or an eighth of that, so more of the field stays in cache while sampling.
+
+namespace svr {
+
+// Converts a float to an IEEE 754 half-precision float, rounding to the
+// nearest even. Values beyond the half range become infinity.
+inline std::uint16_t floatToHalf(float value) noexcept {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const std::uint32_t sign = (bits >> 16) & 0x8000u;
+  const std::uint32_t magnitude = bits & 0x7FFFFFFFu;
+  if (magnitude > 0x7F800000u) {
+    return static_cast<std::uint16_t>(sign | 0x7E00u);  // NaN.
+  }
+  if (magnitude >= 0x47800000u) {
+    return static_cast<std::uint16_t>(sign | 0x7C00u);  // Infinity.
+  }
+  std::uint32_t half, remainder, halfway;
+  if (magnitude >= 0x38800000u) {
+    // Normal, with the exponent rebiased from 127 to 15.
+    half = (magnitude - 0x38000000u) >> 13;
+    remainder = magnitude & 0x1FFFu;
+    halfway = 0x1000u;
+  } else {
+    // Subnormal, i.e. a multiple of 2^-24.
+    const std::uint32_t exponent = magnitude >> 23;
+    if (exponent < 102) return static_cast<std::uint16_t>(sign);
+    const std::uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+    const std::uint32_t shift = 126 - exponent;
+    half = mantissa >> shift;
+    remainder = mantissa & ((1u << shift) - 1);
+    halfway = 1u << (shift - 1);
+  }
+  // A carry out of the mantissa correctly increments the exponent.
+  if (remainder > halfway || (remainder == halfway && (half & 1u))) ++half;
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+// Converts an IEEE 754 half-precision float to a float, which is exact.
+inline float halfToFloat(std::uint16_t half) noexcept {
+  const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+  const std::uint32_t exponent = (half >> 10) & 0x1Fu;
+  const std::uint32_t mantissa = half & 0x3FFu;
+  if (exponent == 0) {
+    // Zero or subnormal, i.e. a multiple of 2^-24.
+    const float magnitude =
+        static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+    return sign ? -magnitude : magnitude;
+  }
+  const std::uint32_t bits =
+      sign | (exponent == 0x1Fu ? 0x7F800000u : (exponent + 112) << 23) |
+      (mantissa << 13);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Converts a float to a bfloat16, i.e. the upper half of the float, rounding
+// to the nearest even.
+inline std::uint16_t floatToBFloat16(float value) noexcept {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+    return static_cast<std::uint16_t>((bits >> 16) | 0x40u);  // Quiet NaN.
+  }
+  return static_cast<std::uint16_t>(
+      (bits + 0x7FFFu + ((bits >> 16) & 1u)) >> 16);
+}
+
+// Converts a bfloat16 to a float, which is exact.
+inline float bfloat16ToFloat(std::uint16_t bfloat16) noexcept {
+  const std::uint32_t bits = static_cast<std::uint32_t>(bfloat16) << 16;
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Values stored as IEEE 754 half-precision floats, with 11 significant bits
+// and a range of about [-65504, 65504]. Values of larger magnitude become
+// infinity. Where F16C is available, four values are decoded at once.
+class HalfVector {
+ public:
+  explicit HalfVector(const std::vector<double> &values) noexcept
+      : halves_(values.size()) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      halves_[i] = floatToHalf(static_cast<float>(values[i]));
+    }
+  }
+
+  inline double operator[](std::size_t index) const noexcept {
+    return halfToFloat(this->halves_[index]);
+  }
+
+  inline std::size_t size() const noexcept { return this->halves_.size(); }
+
+  inline const std::vector<std::uint16_t> &halves() const noexcept {
+    return this->halves_;
+  }
+
+ private:
+  std::vector<std::uint16_t> halves_;
+};
+
+inline void gatherValues(const HalfVector &container,
+                         const std::size_t *indices, double *values) noexcept {
+  const std::uint16_t *halves = container.halves().data();
+#ifdef __F16C__
+  const __m128i packed = _mm_setr_epi16(
+      static_cast<short>(halves[indices[0]]),
+      static_cast<short>(halves[indices[1]]),
+      static_cast<short>(halves[indices[2]]),
+      static_cast<short>(halves[indices[3]]), 0, 0, 0, 0);
+  _mm256_storeu_pd(values, _mm256_cvtps_pd(_mm_cvtph_ps(packed)));
+#else
+  for (std::size_t i = 0; i < 4; ++i) {
+    values[i] = halfToFloat(halves[indices[i]]);
+  }
+#endif
+}
+
+// Values stored as bfloat16, with 8 significant bits and the range of a
+// float. Decoding is a shift, which the generic gatherValues() compiles to
+// without an overload.
+class BFloat16Vector {
+ public:
+  explicit BFloat16Vector(const std::vector<double> &values) noexcept
+      : bfloat16s_(values.size()) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      bfloat16s_[i] = floatToBFloat16(static_cast<float>(values[i]));
+    }
+  }
+
+  inline double operator[](std::size_t index) const noexcept {
+    return bfloat16ToFloat(this->bfloat16s_[index]);
+  }
+
+  inline std::size_t size() const noexcept { return this->bfloat16s_.size(); }
+
+ private:
+  std::vector<std::uint16_t> bfloat16s_;
+};
+
+// Values quantized to 8 bits within bricks of BRICK_SIZE consecutive values,
+// i.e. runs along the azimuthal voxels of a field. Each brick is quantized
+// over its own range, so the error of a value is at most 1/510 of the range
+// of its brick. The values must be finite.
+class QuantizedVector {
+ public:
+  static constexpr std::size_t BRICK_SIZE = 64;
+
+  explicit QuantizedVector(const std::vector<double> &values) noexcept
+      : codes_(values.size()),
+        bricks_((values.size() + BRICK_SIZE - 1) / BRICK_SIZE) {
+    for (std::size_t b = 0; b < bricks_.size(); ++b) {
+      const auto first = values.begin() + b * BRICK_SIZE;
+      const auto last = values.begin() + std::min(values.size(),
+                                                  (b + 1) * BRICK_SIZE);
+      const auto min_max = std::minmax_element(first, last);
+      const double min_value = *min_max.first;
+      const double step = (*min_max.second - min_value) / 255.0;
+      bricks_[b] = {.min_value = min_value, .step = step};
+      const double inverse_step = step > 0.0 ? 1.0 / step : 0.0;
+      for (auto it = first; it != last; ++it) {
+        codes_[it - values.begin()] = static_cast<std::uint8_t>(
+            std::lround((*it - min_value) * inverse_step));
+      }
+    }
+  }
+
+  inline double operator[](std::size_t index) const noexcept {
+    const Brick &brick = this->bricks_[index / BRICK_SIZE];
+    return brick.min_value + brick.step * this->codes_[index];
+  }
+
+  inline std::size_t size() const noexcept { return this->codes_.size(); }
+
+ private:
+  // The range of a brick, where code c decodes to min_value + c * step.
+  struct Brick {
+    double min_value;
+    double step;
+  };
+
+  std::vector<std::uint8_t> codes_;
+  std::vector<Brick> bricks_;
+};
+
+using HalfSphericalVoxelField = BasicSphericalVoxelField<HalfVector>;
+using BFloat16SphericalVoxelField = BasicSphericalVoxelField<BFloat16Vector>;
+using QuantizedSphericalVoxelField = BasicSphericalVoxelField<QuantizedVector>;
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_REDUCEDPRECISIONFIELD_H
@@ -0,0 +1,170 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_SPARSEFIELD_H
+#define SPHERICAL_VOLUME_RENDERING_SPARSEFIELD_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "spherical_voxel_field.h"
+
+namespace svr {
+
+// A sparse value container for BasicSphericalVoxelField, for fields whose
+// values are mostly a single background value, e.g. jets or thin shells. The
+// container is divided into rows of row_size consecutive values, i.e. the
+// azimuthal voxels of a single radial and polar voxel when row_size is
+// numAzimuthalSections(). Each row stores its runs of non-background values,
+// so a lookup searches only the runs of its row. The stored values are kept
+// in the layout order of the field, from the outermost shell inward, which
+// is the order in which rays entering the sphere reach them.
+class SparseVector {
+ public:
+  // Stores the given values, omitting those equal to 'background'.
+  SparseVector(const std::vector<double> &values, std::size_t row_size,
+               double background = 0.0) noexcept
+      : SparseVector(values.size(), row_size,
+                     nonBackgroundEntries(values, background), background) {}
+
+  // Stores the given (index, value) entries of a container of 'size' values,
+  // whose remaining values are 'background'. The entries may be in any order,
+  // but the indices must be unique and less than size.
+  SparseVector(std::size_t size, std::size_t row_size,
+               std::vector<std::pair<std::size_t, double>> entries,
+               double background = 0.0) noexcept
+      : size_(size),
+        row_size_(std::max(row_size, std::size_t{1})),
+        background_(background),
+        row_runs_((size + row_size_ - 1) / row_size_ + 1, 0) {
+    std::sort(entries.begin(), entries.end());
+    values_.reserve(entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      const std::size_t index = entries[i].first;
+      const bool continues_run = i != 0 && entries[i - 1].first + 1 == index &&
+                                 index % row_size_ != 0;
+      if (!continues_run) {
+        runs_.push_back({.begin = index, .value_offset = values_.size()});
+        ++row_runs_[index / row_size_ + 1];
+      }
+      values_.push_back(entries[i].second);
+    }
+    // The sentinel run bounds the length of the last run.
+    runs_.push_back({.begin = size, .value_offset = values_.size()});
+    for (std::size_t row = 1; row < row_runs_.size(); ++row) {
+      row_runs_[row] += row_runs_[row - 1];
+    }
+  }
+
+  inline double operator[](std::size_t index) const noexcept {
+    const std::size_t run = this->findRun(index);
+    if (run == runs_.size()) return this->background_;
+    return this->valueWithinRun(run, index);
+  }
+
+  // Similar to operator[], but first searches the run of the previous lookup
+  // and the run after it, given in 'hint'. Consecutive voxels of a traversal
+  // usually lie within the same run or row, so looking up the voxels of a
+  // traversal in order with the same hint, initially 0, avoids most
+  // searches. The hint is updated to the run of the index.
+  inline double value(std::size_t index, std::size_t &hint) const noexcept {
+    for (std::size_t run = hint; run < hint + 2 && run + 1 < runs_.size();
+         ++run) {
+      if (index >= runs_[run].begin && index < runs_[run + 1].begin &&
+          index / row_size_ == runs_[run].begin / row_size_) {
+        hint = run;
+        return this->valueWithinRun(run, index);
+      }
+    }
+    const std::size_t run = this->findRun(index);
+    if (run == runs_.size()) return this->background_;
+    hint = run;
+    return this->valueWithinRun(run, index);
+  }
+
+  inline std::size_t size() const noexcept { return this->size_; }
+
+  inline double background() const noexcept { return this->background_; }
+
+  // The number of values that differ from the background.
+  inline std::size_t numStoredValues() const noexcept {
+    return this->values_.size();
+  }
+
+  // The number of bytes of the stored values and their runs.
+  inline std::size_t sizeInBytes() const noexcept {
+    return values_.size() * sizeof(double) + runs_.size() * sizeof(Run) +
+           row_runs_.size() * sizeof(std::size_t);
+  }
+
+  // Calls f(index, value) for each stored value, in increasing index order.
+  template <typename F>
+  inline void forEachValue(const F &f) const {
+    for (std::size_t run = 0; run + 1 < runs_.size(); ++run) {
+      const std::size_t length =
+          runs_[run + 1].value_offset - runs_[run].value_offset;
+      for (std::size_t i = 0; i < length; ++i) {
+        f(runs_[run].begin + i, values_[runs_[run].value_offset + i]);
+      }
+    }
+  }
+
+ private:
+  // A run of consecutive stored values within a row. The run ends at the end
+  // of its values, i.e. the value_offset of the next run.
+  struct Run {
+    std::size_t begin;
+    std::size_t value_offset;
+  };
+
+  // Returns the entries of the values that differ from the background.
+  static std::vector<std::pair<std::size_t, double>> nonBackgroundEntries(
+      const std::vector<double> &values, double background) noexcept {
+    std::vector<std::pair<std::size_t, double>> entries;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      if (values[i] != background) entries.emplace_back(i, values[i]);
+    }
+    return entries;
+  }
+
+  // Returns the last run of the row of the index that begins at or before the
+  // index, or runs_.size() if there is none.
+  inline std::size_t findRun(std::size_t index) const noexcept {
+    const std::size_t row = index / row_size_;
+    const auto first = runs_.begin() + row_runs_[row];
+    const auto last = runs_.begin() + row_runs_[row + 1];
+    const auto next = std::upper_bound(
+        first, last, index,
+        [](std::size_t i, const Run &run) { return i < run.begin; });
+    if (next == first) return runs_.size();
+    return static_cast<std::size_t>(next - runs_.begin()) - 1;
+  }
+
+  // Returns the value at the index if it lies within the given run, and
+  // otherwise the background.
+  inline double valueWithinRun(std::size_t run,
+                               std::size_t index) const noexcept {
+    const std::size_t offset = index - runs_[run].begin;
+    const std::size_t length =
+        runs_[run + 1].value_offset - runs_[run].value_offset;
+    return offset < length ? values_[runs_[run].value_offset + offset]
+                           : this->background_;
+  }
+
+  std::size_t size_, row_size_;
+  double background_;
+
+  // The runs of each row are runs_[row_runs_[row], row_runs_[row + 1]).
+  std::vector<std::size_t> row_runs_;
+
+  // The runs in increasing index order, followed by a sentinel run.
+  std::vector<Run> runs_;
+
+  // The stored values of all runs.
+  std::vector<double> values_;
+};
+
+using SparseSphericalVoxelField = BasicSphericalVoxelField<SparseVector>;
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_SPARSEFIELD_H
@@ -2,7 +2,10 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <limits>
+#include <numeric>
+#include <utility>
 #include <vector>
 
 #include "floating_point_comparison_util.h"
@@ -12,18 +15,6 @@ namespace svr {
 namespace {
 constexpr double DOUBLE_MAX = std::numeric_limits<double>::max();
 
-// The type corresponding to the voxel(s) with the minimum tMax value for a
-// given traversal.
-enum VoxelIntersectionType {
-  Radial = 1,
-  Polar = 2,
-  Azimuthal = 3,
-  RadialPolar = 4,
-  RadialAzimuthal = 5,
-  PolarAzimuthal = 6,
-  RadialPolarAzimuthal = 7
-};
-
 // The parameters returned by radialHit().
 struct HitParameters {
   // The time at which a hit occurs for the ray at the next point of
@@ -87,21 +78,33 @@ struct RaySegment {
 // boundary. This is similar for azimuthal boundaries. Since both cases use
 // points in a plane (XY for polar, XZ for azimuthal), this can be generalized
 // to a single function.
+inline bool liesWithinAngularVoxel(const LineSegment &lower_boundary,
+                                   const LineSegment &upper_boundary,
+                                   const double p1, double p2) noexcept {
+  const double X_diff = lower_boundary.P1 - upper_boundary.P1;
+  const double Y_diff = lower_boundary.P2 - upper_boundary.P2;
+  const double X_p1_diff = lower_boundary.P1 - p1;
+  const double X_p2_diff = lower_boundary.P2 - p2;
+  const double Y_p1_diff = upper_boundary.P1 - p1;
+  const double Y_p2_diff = upper_boundary.P2 - p2;
+  const double d1d2 = (X_p1_diff * X_p1_diff) + (X_p2_diff * X_p2_diff) +
+                      (Y_p1_diff * Y_p1_diff) + (Y_p2_diff * Y_p2_diff);
+  const double d3 = (X_diff * X_diff) + (Y_diff * Y_diff);
+  return d1d2 < d3 || svr::isEqual(d1d2, d3);
+}
+
+inline bool liesWithinAngularVoxel(TableView<LineSegment> angular_max,
+                                   std::size_t i, const double p1,
+                                   double p2) noexcept {
+  return liesWithinAngularVoxel(angular_max[i], angular_max[i + 1], p1, p2);
+}
+
+// Returns the first angular voxel ID for which the point lies within the
+// voxel, or angular_max.size() + 1 if there is no such voxel.
 inline int calculateAngularVoxelIDFromPoints(
-    const std::vector<LineSegment> &angular_max, const double p1,
-    double p2) noexcept {
-  std::size_t i = 0;
-  for (std::size_t j = 1; j < angular_max.size(); ++i, ++j) {
-    const double X_diff = angular_max[i].P1 - angular_max[j].P1;
-    const double Y_diff = angular_max[i].P2 - angular_max[j].P2;
-    const double X_p1_diff = angular_max[i].P1 - p1;
-    const double X_p2_diff = angular_max[i].P2 - p2;
-    const double Y_p1_diff = angular_max[j].P1 - p1;
-    const double Y_p2_diff = angular_max[j].P2 - p2;
-    const double d1d2 = (X_p1_diff * X_p1_diff) + (X_p2_diff * X_p2_diff) +
-                        (Y_p1_diff * Y_p1_diff) + (Y_p2_diff * Y_p2_diff);
-    const double d3 = (X_diff * X_diff) + (Y_diff * Y_diff);
-    if (d1d2 < d3 || svr::isEqual(d1d2, d3)) return i;
+    TableView<LineSegment> angular_max, const double p1, double p2) noexcept {
+  for (std::size_t i = 0; i + 1 < angular_max.size(); ++i) {
+    if (liesWithinAngularVoxel(angular_max, i, p1, p2)) return i;
   }
   return angular_max.size() + 1;
 }
@@ -135,7 +138,7 @@ inline bool inBoundsPolar(const SphericalVoxelGrid &grid, const int step,
 inline int initializeAngularVoxelID(const SphericalVoxelGrid &grid,
                                     std::size_t number_of_sections,
                                     const FreeVec3 &ray_sphere,
-                                    const std::vector<LineSegment> &angular_max,
+                                    TableView<LineSegment> angular_max,
                                     double ray_sphere_2, double grid_sphere_2,
                                     double entry_radius) noexcept {
   if (number_of_sections == 1) return 0;
@@ -148,6 +151,127 @@ inline int initializeAngularVoxelID(const SphericalVoxelGrid &grid,
   return calculateAngularVoxelIDFromPoints(angular_max, p1, p2);
 }
 
+// Resolves an angular voxel ID located with initializeAngularVoxelID() at a
+// point that lies on a voxel boundary. Such a point lies within both adjacent
+// voxels, and the lower voxel ID is returned. Here, the ID is instead
+// resolved with the direction of the ray: it is the voxel which the ray has
+// entered by time t, where a boundary crossed at a time equal to t is
+// considered entered. This is consistent with angularHit(), which ignores
+// boundary crossings at a time equal to t. The boundary normals are given by
+// the trigonometric values (-sine, cosine) in the plane of the voxels.
+inline int resolveAngularVoxelID(
+    const SphericalVoxelGrid &grid, std::size_t number_of_sections,
+    TableView<LineSegment> angular_max,
+    TableView<TrigonometricValues> trig_values,
+    const FreeVec3 &ray_sphere, double ray_sphere_2, double grid_sphere_2,
+    double direction_1, double direction_2, double t,
+    int voxel_id) noexcept {
+  const std::size_t id = static_cast<std::size_t>(voxel_id);
+  if (number_of_sections == 1 || id >= number_of_sections) return voxel_id;
+  const double SED =
+      ray_sphere.x() * ray_sphere.x() + ray_sphere_2 * ray_sphere_2;
+  if (SED == 0.0) return voxel_id;
+  const double r = grid.sphereMaxRadius() / std::sqrt(SED);
+  const double p1 = grid.sphereCenter().x() - ray_sphere.x() * r;
+  const double p2 = grid_sphere_2 - ray_sphere_2 * r;
+  // Returns true if the ray has crossed the given boundary by time t in the
+  // direction of increasing (or otherwise decreasing) voxel IDs.
+  const auto has_crossed = [&](std::size_t boundary, bool increasing) -> bool {
+    const double normal_1 = -trig_values[boundary].sine;
+    const double normal_2 = trig_values[boundary].cosine;
+    const double direction_dot_normal =
+        direction_1 * normal_1 + direction_2 * normal_2;
+    if (increasing ? direction_dot_normal <= 0.0
+                   : direction_dot_normal >= 0.0) {
+      return false;
+    }
+    const double t_crossing =
+        t + (ray_sphere.x() * normal_1 + ray_sphere_2 * normal_2) /
+                direction_dot_normal;
+    return t_crossing < t || svr::isEqual(t_crossing, t);
+  };
+  if (id + 1 < number_of_sections &&
+      liesWithinAngularVoxel(angular_max, id + 1, p1, p2) &&
+      has_crossed(id + 1, /*increasing=*/true)) {
+    return voxel_id + 1;
+  }
+  if (id == 0 &&
+      liesWithinAngularVoxel(angular_max, number_of_sections - 1, p1, p2) &&
+      has_crossed(0, /*increasing=*/false)) {
+    return number_of_sections - 1;
+  }
+  return voxel_id;
+}
+
+// Returns the radial voxel ID of a point with the given squared euclidean
+// distance from the sphere center, or 0 if the point lies outside the sphere.
+// As in the initialization of a traversal with a ray origin inside the sphere,
+// this is the number of radial boundary spheres whose squared radius exceeds
+// the distance. The ID is corrected from 'estimate', an approximate ID within
+// [0, numRadialSections()] computed from the radius of the point.
+inline int locateRadialVoxelID(const SphericalVoxelGrid &grid,
+                               double SED_from_center,
+                               double estimate) noexcept {
+  const std::size_t num_radial_sections = grid.numRadialSections();
+  std::size_t radial_voxel = static_cast<std::size_t>(estimate);
+  while (radial_voxel < num_radial_sections &&
+         SED_from_center < grid.deltaRadiiSquared(radial_voxel)) {
+    ++radial_voxel;
+  }
+  while (radial_voxel > 0 &&
+         !(SED_from_center < grid.deltaRadiiSquared(radial_voxel - 1))) {
+    --radial_voxel;
+  }
+  return radial_voxel;
+}
+
+// Returns the angular voxel ID of a point, where (d_1, d_2) is the point minus
+// the sphere center (center_1, center_2) in the plane of the voxels, and
+// radius is the outer radius of the point's radial voxel. The result is
+// identical to that of initializeAngularVoxelID() for a ray origin at the
+// point: the voxel boundary segments at the given radius are calculated as in
+// initializeVoxelBoundarySegments(), and the lowest voxel ID whose segments
+// hold the projected point is returned, or number_of_sections + 2 if there is
+// none. Rather than checking every voxel, the angle of the point is used to
+// find a candidate voxel. Voxel 0, which shares a boundary with the last voxel,
+// and then the candidate and its neighbors are checked in increasing order of
+// voxel ID. The remaining voxels are only checked if none of these hold.
+inline int locateAngularVoxelID(
+    TableView<TrigonometricValues> trig_values,
+    std::size_t number_of_sections, double min_bound, double delta,
+    double radius, double center_1, double center_2, double d_1,
+    double d_2) noexcept {
+  if (number_of_sections == 1) return 0;
+  const double SED = d_1 * d_1 + d_2 * d_2;
+  if (SED == 0.0) return 0;
+  const double r = radius / std::sqrt(SED);
+  const double p1 = center_1 + d_1 * r;
+  const double p2 = center_2 + d_2 * r;
+  const auto boundary = [&](std::size_t i) -> LineSegment {
+    return {.P1 = radius * trig_values[i].cosine + center_1,
+            .P2 = radius * trig_values[i].sine + center_2};
+  };
+  const auto lies_within = [&](std::size_t i) -> bool {
+    return liesWithinAngularVoxel(boundary(i), boundary(i + 1), p1, p2);
+  };
+  if (lies_within(0)) return 0;
+
+  double angle = std::atan2(d_2, d_1);
+  if (angle < 0.0) angle += TAU;
+  const double num_sections = static_cast<double>(number_of_sections);
+  const std::size_t candidate = static_cast<std::size_t>(
+      std::min(std::max((angle - min_bound) / delta, 0.0), num_sections - 1.0));
+  const std::size_t last = std::min(candidate + 1, number_of_sections - 1);
+  for (std::size_t i = std::max(candidate, std::size_t{2}) - 1; i <= last;
+       ++i) {
+    if (lies_within(i)) return i;
+  }
+  for (std::size_t i = 1; i < number_of_sections; ++i) {
+    if (lies_within(i)) return i;
+  }
+  return number_of_sections + 2;
+}
+
 // Determines whether a radial hit occurs for the given ray. A radial hit is
 // considered an intersection with the ray and a radial section. To determine
 // line-sphere intersection, this follows closely the mathematics presented in:
@@ -211,7 +335,7 @@ HitParameters angularHit(
     double perp_vw_min, double perp_vw_max, const RaySegment &ray_segment,
     const std::array<double, 2> &collinear_times, double t, double max_t,
     double ray_direction_2, double sphere_center_2,
-    const std::vector<svr::LineSegment> &P_max, int current_voxel) noexcept {
+    TableView<svr::LineSegment> P_max, int current_voxel) noexcept {
   const bool is_parallel_min = svr::isEqual(perp_uv_min, 0.0);
   const bool is_collinear_min = is_parallel_min &&
                                 svr::isEqual(perp_uw_min, 0.0) &&
@@ -362,6 +486,14 @@ inline HitParameters azimuthalHit(const Ray &ray,
                     current_azimuthal_voxel);
 }
 
+// Returns the angular voxel ID after taking the given step from voxel_id. A
+// step past either end of the angular voxels wraps around the circle.
+inline int stepAngularVoxelID(int voxel_id, int step,
+                              std::size_t number_of_sections) noexcept {
+  const int num_sections = static_cast<int>(number_of_sections);
+  return ((voxel_id + step) % num_sections + num_sections) % num_sections;
+}
+
 // Calculates the voxel(s) with the minimal tMax for the next intersection.
 // Since t is being updated with each interval of the algorithm, this must check
 // the following cases:
@@ -409,8 +541,9 @@ inline void initializeVoxelBoundarySegments(
     std::vector<svr::LineSegment> &P_azimuthal, bool ray_origin_is_outside_grid,
     const svr::SphericalVoxelGrid &grid, double current_radius) noexcept {
   if (ray_origin_is_outside_grid) {
-    P_polar = grid.pMaxPolar();
-    P_azimuthal = grid.pMaxAzimuthal();
+    P_polar.assign(grid.pMaxPolar().cbegin(), grid.pMaxPolar().cend());
+    P_azimuthal.assign(grid.pMaxAzimuthal().cbegin(),
+                       grid.pMaxAzimuthal().cend());
     return;
   }
   std::transform(
@@ -429,194 +562,817 @@ inline void initializeVoxelBoundarySegments(
       });
 }
 
-}  // namespace
+// The number of rays traversed concurrently by
+// walkSphericalVolumeInterleaved().
+constexpr std::size_t NUM_INTERLEAVED_RAYS = 4;
 
-std::vector<svr::SphericalVoxel> walkSphericalVolume(
-    const Ray &ray, const svr::SphericalVoxelGrid &grid,
-    double max_t) noexcept {
-  if (max_t <= 0.0) return {};
-  const FreeVec3 rsv =
-      grid.sphereCenter() - ray.pointAtParameter(0.0);  // Ray Sphere Vector.
-  const double SED_from_center = rsv.squared_length();
-  int radial_entrance_voxel = 0;
-  while (SED_from_center < grid.deltaRadiiSquared(radial_entrance_voxel)) {
-    ++radial_entrance_voxel;
+// The mirror symmetries of an orthographic image with respect to the planes
+// through the sphere center.
+struct ImageMirrors {
+  // Mirror across the XZ plane, i.e. y -> -y.
+  bool xz;
+
+  // Mirror across the YZ plane, i.e. x -> -x.
+  bool yz;
+};
+
+// Determines which mirrors map the rays of the image onto rays of the same
+// image, and the voxels of the grid onto voxels of the same grid. Since a
+// mirrored ray must be traversed identically to its mirror ray, exact
+// equality is used rather than Knuth's algorithm.
+inline ImageMirrors imageMirrors(const OrthographicImage &image,
+                                 const svr::SphericalVoxelGrid &grid) noexcept {
+  const bool spans_entire_sphere =
+      grid.sphereMinBoundPolar() == 0.0 &&
+      svr::isEqual(grid.sphereMaxBoundPolar(), TAU) &&
+      grid.sphereMinBoundAzi() == 0.0 &&
+      svr::isEqual(grid.sphereMaxBoundAzi(), TAU);
+  if (!spans_entire_sphere) return {.xz = false, .yz = false};
+  const BoundVec3 &center = grid.sphereCenter();
+  const bool xz = image.direction.y() == 0.0 && image.horizontal.y() == 0.0 &&
+                  image.vertical.x() == 0.0 && image.vertical.z() == 0.0 &&
+                  image.image_center.y() == center.y();
+  const bool yz = grid.numPolarSections() % 2 == 0 &&
+                  grid.numAzimuthalSections() % 2 == 0 &&
+                  image.direction.x() == 0.0 && image.vertical.x() == 0.0 &&
+                  image.horizontal.y() == 0.0 && image.horizontal.z() == 0.0 &&
+                  image.image_center.x() == center.x();
+  return {.xz = xz, .yz = yz};
+}
+
+// Returns the voxels traversed by the mirror of a ray given the voxels
+// traversed by the ray itself. The radial voxels and traversal times are
+// unchanged. Mirroring across the XZ plane maps the polar angle theta to
+// 2pi - theta. Mirroring across the YZ plane maps the polar angle theta to
+// pi - theta, and similarly the azimuthal angle phi to pi - phi.
+inline std::vector<svr::SphericalVoxel> mirrorVoxels(
+    const std::vector<svr::SphericalVoxel> &voxels,
+    const svr::SphericalVoxelGrid &grid, bool across_xz,
+    bool across_yz) noexcept {
+  const int num_polar_sections = grid.numPolarSections();
+  const int num_azimuthal_sections = grid.numAzimuthalSections();
+  std::vector<svr::SphericalVoxel> mirrored_voxels(voxels);
+  for (auto &voxel : mirrored_voxels) {
+    if (across_xz) voxel.polar = num_polar_sections - 1 - voxel.polar;
+    if (across_yz) {
+      voxel.polar = (num_polar_sections * 3 / 2 - 1 - voxel.polar) %
+                    num_polar_sections;
+      voxel.azimuthal =
+          (num_azimuthal_sections * 3 / 2 - 1 - voxel.azimuthal) %
+          num_azimuthal_sections;
+    }
   }
-  const bool ray_origin_is_outside_grid = (radial_entrance_voxel == 0);
+  return mirrored_voxels;
+}
 
-  const std::size_t vector_index =
-      radial_entrance_voxel - !ray_origin_is_outside_grid;
-  const double entry_radius_squared = grid.deltaRadiiSquared(vector_index);
-  const double entry_radius =
-      grid.deltaRadius() *
-      static_cast<double>(grid.numRadialSections() - vector_index);
-  const double rsvd = rsv.dot(rsv);
-  const double v = rsv.dot(ray.direction().to_free());
-  const double rsvd_minus_v_squared = rsvd - v * v;
+// Returns true if the point at 'offset' from the sphere center lies on a polar
+// or azimuthal voxel boundary plane through the sphere center, where the grid
+// spans the entire sphere. A point on the Z (or Y) axis through the sphere
+// center lies on every polar (or azimuthal) boundary plane. Points within a
+// small angle of a plane are considered to lie on it.
+inline bool liesOnAngularBoundary(
+    const FreeVec3 &offset, const svr::SphericalVoxelGrid &grid) noexcept {
+  const auto lies_on_boundary = [](double d_1, double d_2, double delta) {
+    const double angle = std::atan2(d_2, d_1);
+    return std::abs(angle - delta * std::round(angle / delta)) <=
+           svr::REL_EPSILON;
+  };
+  return lies_on_boundary(offset.x(), offset.y(), grid.deltaTheta()) ||
+         lies_on_boundary(offset.x(), offset.z(), grid.deltaPhi());
+}
+
+// Returns true if a point at the given distance from the sphere center lies on
+// a radial voxel boundary sphere, within a small relative distance.
+inline bool liesOnRadialBoundary(double distance,
+                                 const svr::SphericalVoxelGrid &grid) noexcept {
+  const double boundary = std::round(
+      (grid.sphereMaxRadius() - distance) / grid.deltaRadius());
+  return std::abs(grid.sphereMaxRadius() - boundary * grid.deltaRadius() -
+                  distance) <= svr::REL_EPSILON * grid.sphereMaxRadius();
+}
 
-  if (entry_radius_squared <= rsvd_minus_v_squared) return {};
-  const double d = std::sqrt(entry_radius_squared - rsvd_minus_v_squared);
-  const double t_ray_exit = ray.timeOfIntersectionAt(v + d);
-  if (t_ray_exit < 0.0) return {};
-  const double t_ray_entrance = ray.timeOfIntersectionAt(v - d);
-  int current_radial_voxel = radial_entrance_voxel + ray_origin_is_outside_grid;
+// Returns true if the traversal of the ray with max_t meets a voxel boundary
+// in a tie: it begins or ends on a voxel boundary, or the ray is tangent to a
+// radial voxel boundary sphere. This holds for every ray that lies on an
+// angular boundary plane through the sphere center. The traversal resolves a
+// tie by the lower voxel ID, or by the order in which it evaluates the
+// boundaries, so the voxels of the mirror of such a ray may differ from the
+// mirrored voxels of the ray. The begin and end times are those of
+// TraversalCursor::initialize().
+inline bool hasVoxelBoundaryTie(const Ray &ray,
+                                const svr::SphericalVoxelGrid &grid,
+                                double max_t) noexcept {
+  if (max_t <= 0.0) return false;
+  const FreeVec3 origin_offset = ray.origin() - grid.sphereCenter();
+  const FreeVec3 &direction = ray.direction().to_free();
+  const double v = -origin_offset.dot(direction);
+  const double origin_distance_sq = origin_offset.squared_length();
+  const double closest_distance_sq = origin_distance_sq - v * v;
+  if (liesOnRadialBoundary(std::sqrt(std::max(closest_distance_sq, 0.0)),
+                           grid)) {
+    return true;
+  }
+  const double max_radius_sq = grid.deltaRadiiSquared(0);
+  if (max_radius_sq <= closest_distance_sq) return false;
+  const double d = std::sqrt(max_radius_sq - closest_distance_sq);
+  const double t_exit = v + d;
+  if (t_exit < 0.0) return false;
+  const bool origin_is_outside_grid = !(origin_distance_sq < max_radius_sq);
+  const double t_begin = origin_is_outside_grid ? v - d : 0.0;
+  const FreeVec3 begin_offset = origin_offset + direction * t_begin;
+  if (liesOnAngularBoundary(begin_offset, grid) ||
+      (!origin_is_outside_grid &&
+       liesOnRadialBoundary(std::sqrt(origin_distance_sq), grid))) {
+    return true;
+  }
+  // The traversal ends where the ray exits the sphere, or otherwise within it
+  // at max_t.
+  const double t_end =
+      std::min(t_begin + max_t * grid.sphereMaxDiameter(), t_exit);
+  const FreeVec3 end_offset = origin_offset + direction * t_end;
+  return liesOnAngularBoundary(end_offset, grid) ||
+         (t_end < t_exit && liesOnRadialBoundary(end_offset.length(), grid));
+}
 
-  std::vector<svr::LineSegment> P_polar(grid.numPolarSections() + 1);
-  std::vector<svr::LineSegment> P_azimuthal(grid.numAzimuthalSections() + 1);
-  initializeVoxelBoundarySegments(
-      P_polar, P_azimuthal, ray_origin_is_outside_grid, grid, entry_radius);
+// Spreads the lower 21 bits of x such that two zero bits lie between each
+// bit. Interleaving three such values produces a 3-dimensional Morton code.
+inline std::uint64_t spreadBitsByTwo(std::uint64_t x) noexcept {
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8) & 0x100f00f00f00f00f;
+  x = (x | x << 4) & 0x10c30c30c30c30c3;
+  x = (x | x << 2) & 0x1249249249249249;
+  return x;
+}
 
-  const FreeVec3 ray_sphere =
-      ray_origin_is_outside_grid
-          ? grid.sphereCenter() - ray.pointAtParameter(t_ray_entrance)
-          : SED_from_center == 0.0 ? rsv - ray.direction().to_free() : rsv;
+inline std::uint64_t mortonCode(std::uint64_t x, std::uint64_t y,
+                                std::uint64_t z) noexcept {
+  return spreadBitsByTwo(x) | spreadBitsByTwo(y) << 1 |
+         spreadBitsByTwo(z) << 2;
+}
 
-  int current_polar_voxel = initializeAngularVoxelID(
-      grid, grid.numPolarSections(), ray_sphere, P_polar, ray_sphere.y(),
-      grid.sphereCenter().y(), entry_radius);
-  if (static_cast<std::size_t>(current_polar_voxel) >=
-      grid.numPolarSections()) {
-    return {};
+// Quantizes value within [min_value, min_value + extent] to an integer within
+// [0, num_levels - 1]. inv_extent is 1 / extent, or 0 if the extent is empty.
+inline std::uint64_t quantize(double value, double min_value,
+                              double inv_extent,
+                              std::uint64_t num_levels) noexcept {
+  const double level = (value - min_value) * inv_extent * num_levels;
+  return std::min(static_cast<std::uint64_t>(std::max(level, 0.0)),
+                  num_levels - 1);
+}
+
+// Returns 1 / (max_value - min_value), or 0 if the values are equal.
+inline double inverseExtent(double min_value, double max_value) noexcept {
+  const double extent = max_value - min_value;
+  return extent > 0.0 ? 1.0 / extent : 0.0;
+}
+
+// An axis-aligned bounding box.
+struct BoundingBox {
+  BoundVec3 min;
+  BoundVec3 max;
+};
+
+// The extent of a circular sector along the two axes of its plane, relative to
+// the center of its circle.
+struct SectorExtent {
+  double min_1, max_1;
+  double min_2, max_2;
+};
+
+// Returns the extent of the circular sector with the given radius spanning
+// [min_angle, max_angle]. The sector contains the center of its circle, its
+// two boundary points on the circle, and the points on each axis of the plane
+// whose angle lies within the sector.
+inline SectorExtent circularSectorExtent(double radius, double min_angle,
+                                         double max_angle) noexcept {
+  SectorExtent extent = {
+      .min_1 = 0.0, .max_1 = 0.0, .min_2 = 0.0, .max_2 = 0.0};
+  const auto include = [&extent](double p1, double p2) {
+    extent.min_1 = std::min(extent.min_1, p1);
+    extent.max_1 = std::max(extent.max_1, p1);
+    extent.min_2 = std::min(extent.min_2, p2);
+    extent.max_2 = std::max(extent.max_2, p2);
+  };
+  include(radius * std::cos(min_angle), radius * std::sin(min_angle));
+  include(radius * std::cos(max_angle), radius * std::sin(max_angle));
+  const std::array<std::array<double, 2>, 4> axis_points = {
+      {{{radius, 0.0}}, {{0.0, radius}}, {{-radius, 0.0}}, {{0.0, -radius}}}};
+  for (std::size_t k = 0; k < 8; ++k) {
+    const double axis_angle = k * M_PI / 2.0;
+    if (axis_angle >= min_angle && axis_angle <= max_angle) {
+      include(axis_points[k % 4][0], axis_points[k % 4][1]);
+    }
   }
+  return extent;
+}
 
-  int current_azimuthal_voxel = initializeAngularVoxelID(
-      grid, grid.numAzimuthalSections(), ray_sphere, P_azimuthal,
-      ray_sphere.z(), grid.sphereCenter().z(), entry_radius);
-  if (static_cast<std::size_t>(current_azimuthal_voxel) >=
-      grid.numAzimuthalSections()) {
-    return {};
+// Returns the bounding box of the sectored sphere. Polar sections bound X and
+// Y, while azimuthal sections bound X and Z.
+inline BoundingBox sectorBoundingBox(
+    const svr::SphericalVoxelGrid &grid) noexcept {
+  const SectorExtent polar =
+      circularSectorExtent(grid.sphereMaxRadius(), grid.sphereMinBoundPolar(),
+                           grid.sphereMaxBoundPolar());
+  const SectorExtent azimuthal =
+      circularSectorExtent(grid.sphereMaxRadius(), grid.sphereMinBoundAzi(),
+                           grid.sphereMaxBoundAzi());
+  const BoundVec3 &center = grid.sphereCenter();
+  return {.min = BoundVec3(center.x() + std::max(polar.min_1, azimuthal.min_1),
+                           center.y() + polar.min_2,
+                           center.z() + azimuthal.min_2),
+          .max = BoundVec3(center.x() + std::min(polar.max_1, azimuthal.max_1),
+                           center.y() + polar.max_2,
+                           center.z() + azimuthal.max_2)};
+}
+
+// The times at which a ray enters and exits the slab between two planes
+// orthogonal to one axis.
+struct SlabTimes {
+  double enter;
+  double exit;
+};
+
+// Returns the slab times for the ray with the given origin and direction along
+// one axis. If the ray is parallel to the slab, it either always or never
+// lies within it.
+inline SlabTimes slabTimes(double origin, double direction, double min_bound,
+                           double max_bound) noexcept {
+  if (direction == 0.0) {
+    const bool is_within = origin >= min_bound && origin <= max_bound;
+    return {.enter = is_within ? -DOUBLE_MAX : DOUBLE_MAX,
+            .exit = is_within ? DOUBLE_MAX : -DOUBLE_MAX};
   }
+  const double inv_direction = 1.0 / direction;
+  const double t1 = (min_bound - origin) * inv_direction;
+  const double t2 = (max_bound - origin) * inv_direction;
+  return {.enter = std::min(t1, t2), .exit = std::max(t1, t2)};
+}
 
+// Returns the remaining voxels of the cursor.
+std::vector<svr::SphericalVoxel> traverseToCompletion(
+    TraversalCursor &cursor, const svr::SphericalVoxelGrid &grid) noexcept {
   std::vector<svr::SphericalVoxel> voxels;
+  svr::SphericalVoxel voxel;
+  if (!cursor.next(voxel)) return voxels;
   voxels.reserve(grid.numRadialSections() + grid.numPolarSections() +
                  grid.numAzimuthalSections());
-  voxels.push_back({.radial = current_radial_voxel,
-                    .polar = current_polar_voxel,
-                    .azimuthal = current_azimuthal_voxel});
-
-  double t = t_ray_entrance * ray_origin_is_outside_grid;
-  const double unitized_ray_time = max_t * grid.sphereMaxDiameter() +
-                                   t_ray_entrance * ray_origin_is_outside_grid;
-  max_t = ray_origin_is_outside_grid ? std::min(t_ray_exit, unitized_ray_time)
-                                     : unitized_ray_time;
-
-  // Initialize the time in case of collinear min or collinear max for angular
-  // plane hits. In the case where the hit is not collinear, a time of 0.0 is
-  // inputted.
-  const std::array<double, 2> collinear_times = {
-      0.0, ray.timeOfIntersectionAt(grid.sphereCenter())};
-
-  RaySegment ray_segment(max_t, ray);
-  bool radial_step_has_transitioned = false;
+  do {
+    voxels.push_back(voxel);
+  } while (cursor.next(voxel));
+  return voxels;
+}
+
+}  // namespace
+
+TraversalCursor::TraversalCursor(const Ray &ray,
+                                 const svr::SphericalVoxelGrid &grid,
+                                 double max_t) noexcept
+    : ray_(ray),
+      grid_(&grid),
+      is_windowed_(false),
+      is_reversed_(false),
+      t_reversal_(0.0) {
+  has_next_ = this->initialize(max_t);
+}
+
+TraversalCursor::TraversalCursor(const Ray &ray,
+                                 const svr::SphericalVoxelGrid &grid,
+                                 double t_begin, double t_end,
+                                 TraversalDirection direction) noexcept
+    : ray_(ray),
+      grid_(&grid),
+      is_windowed_(true),
+      is_reversed_(direction == BACK_TO_FRONT),
+      t_reversal_(0.0) {
+  has_next_ = is_reversed_ ? this->initializeReversedWindow(t_begin, t_end)
+                           : this->initializeWindow(t_begin, t_end);
+}
+
+bool TraversalCursor::next(svr::SphericalVoxel &voxel) noexcept {
+  if (!has_next_) return false;
+  voxel = voxel_;
+  if (this->step()) {
+    voxel.exit_t = voxel_.enter_t;
+  } else {
+    voxel.exit_t = is_windowed_ ? t_exit_ : t_ray_exit_;
+    has_next_ = false;
+  }
+  if (is_reversed_) {
+    const double enter_t = voxel.enter_t;
+    voxel.enter_t = t_reversal_ - voxel.exit_t;
+    voxel.exit_t = t_reversal_ - enter_t;
+  }
+  return true;
+}
+
+bool TraversalCursor::next(svr::SphericalVoxel &voxel,
+                           VoxelCrossing &crossing) noexcept {
+  if (!has_next_) return false;
+  crossing = this->crossing();
+  return this->next(voxel);
+}
+
+VoxelCrossing TraversalCursor::crossing() const noexcept {
+  const svr::SphericalVoxelGrid &grid = *grid_;
+  const bool crosses_radial =
+      crossing_type_ == Radial || crossing_type_ == RadialPolar ||
+      crossing_type_ == RadialAzimuthal ||
+      crossing_type_ == RadialPolarAzimuthal;
+  const bool crosses_polar =
+      crossing_type_ == Polar || crossing_type_ == RadialPolar ||
+      crossing_type_ == PolarAzimuthal ||
+      crossing_type_ == RadialPolarAzimuthal;
+  const bool crosses_azimuthal =
+      crossing_type_ == Azimuthal || crossing_type_ == RadialAzimuthal ||
+      crossing_type_ == PolarAzimuthal ||
+      crossing_type_ == RadialPolarAzimuthal;
+  const FreeVec3 &direction = ray_.direction().to_free();
+  FreeVec3 normal(0.0, 0.0, 0.0);
+  // Adds the given unit normal, oriented against the direction of traversal.
+  const auto add_normal = [&](const FreeVec3 &boundary_normal) {
+    normal += boundary_normal.dot(direction) > 0.0 ? -boundary_normal
+                                                   : boundary_normal;
+  };
+  if (crosses_radial) {
+    const FreeVec3 center_to_point =
+        ray_.pointAtParameter(crossing_t_) - grid.sphereCenter();
+    add_normal(center_to_point / center_to_point.length());
+  }
+  if (crosses_polar) {
+    const TrigonometricValues &trig_values =
+        grid.polarTrigValues()[crossing_polar_boundary_];
+    add_normal(FreeVec3(-trig_values.sine, trig_values.cosine, 0.0));
+  }
+  if (crosses_azimuthal) {
+    const TrigonometricValues &trig_values =
+        grid.azimuthalTrigValues()[crossing_azimuthal_boundary_];
+    add_normal(FreeVec3(-trig_values.sine, 0.0, trig_values.cosine));
+  }
+  const double length = normal.length();
+  if (length > 0.0) normal /= length;
+  return {.type = crossing_type_, .normal = normal};
+}
+
+bool TraversalCursor::step() noexcept {
+  const svr::SphericalVoxelGrid &grid = *grid_;
+  RaySegment ray_segment(max_t_, ray_);
   while (true) {
-    const auto radial =
-        radialHit(ray, grid, radial_step_has_transitioned, current_radial_voxel,
-                  v, rsvd_minus_v_squared, t, max_t);
-    ray_segment.updateAtTime(t, ray);
-    const auto polar = polarHit(ray, grid, ray_segment, collinear_times,
-                                current_polar_voxel, t, max_t);
-    const auto azimuthal = azimuthalHit(ray, grid, ray_segment, collinear_times,
-                                        current_azimuthal_voxel, t, max_t);
-
-    if (current_radial_voxel + radial.tStep == 0 ||
+    const auto radial = radialHit(
+        ray_, grid, radial_step_has_transitioned_, current_radial_voxel_, v_,
+        rsvd_minus_v_squared_, t_, max_t_);
+    ray_segment.updateAtTime(t_, ray_);
+    const auto polar = polarHit(ray_, grid, ray_segment, collinear_times_,
+                                current_polar_voxel_, t_, max_t_);
+    const auto azimuthal =
+        azimuthalHit(ray_, grid, ray_segment, collinear_times_,
+                     current_azimuthal_voxel_, t_, max_t_);
+
+    if (current_radial_voxel_ + radial.tStep == 0) {
+      return this->end(radial.tMax);
+    }
+    // In a windowed traversal, a crossing at a time equal to max_t is left
+    // to a traversal that begins at max_t, which considers such a crossing
+    // already made.
+    if ((is_windowed_ &&
+         svr::isEqual(std::min(std::min(radial.tMax, polar.tMax),
+                               azimuthal.tMax),
+                      max_t_)) ||
         (radial.tMax == DOUBLE_MAX && polar.tMax == DOUBLE_MAX &&
          azimuthal.tMax == DOUBLE_MAX)) {
-      voxels.back().exit_t = t_ray_exit;
-      return voxels;
+      return this->end(max_t_);
     }
     const auto voxel_intersection =
         minimumIntersection(radial, polar, azimuthal);
     switch (voxel_intersection) {
       case Radial: {
-        t = radial.tMax;
-        current_radial_voxel += radial.tStep;
+        t_ = radial.tMax;
+        current_radial_voxel_ += radial.tStep;
         break;
       }
       case Polar: {
-        t = polar.tMax;
-        if (!inBoundsPolar(grid, polar.tStep, current_polar_voxel)) {
-          voxels.back().exit_t = t_ray_exit;
-          return voxels;
+        t_ = polar.tMax;
+        if (!inBoundsPolar(grid, polar.tStep, current_polar_voxel_)) {
+          return this->end(t_);
         }
-        current_polar_voxel =
-            (current_polar_voxel + polar.tStep) % grid.numPolarSections();
+        current_polar_voxel_ = stepAngularVoxelID(
+            current_polar_voxel_, polar.tStep, grid.numPolarSections());
         break;
       }
       case Azimuthal: {
         if (!inBoundsAzimuthal(grid, azimuthal.tStep,
-                               current_azimuthal_voxel)) {
-          voxels.back().exit_t = t_ray_exit;
-          return voxels;
+                               current_azimuthal_voxel_)) {
+          return this->end(azimuthal.tMax);
         }
-        t = azimuthal.tMax;
-        current_azimuthal_voxel = (current_azimuthal_voxel + azimuthal.tStep) %
-                                  grid.numAzimuthalSections();
+        t_ = azimuthal.tMax;
+        current_azimuthal_voxel_ =
+            stepAngularVoxelID(current_azimuthal_voxel_, azimuthal.tStep,
+                               grid.numAzimuthalSections());
         break;
       }
       case RadialPolar: {
-        t = radial.tMax;
-        if (!inBoundsPolar(grid, polar.tStep, current_polar_voxel)) {
-          voxels.back().exit_t = t_ray_exit;
-          return voxels;
+        t_ = radial.tMax;
+        if (!inBoundsPolar(grid, polar.tStep, current_polar_voxel_)) {
+          return this->end(t_);
         }
-        current_radial_voxel += radial.tStep;
-        current_polar_voxel =
-            (current_polar_voxel + polar.tStep) % grid.numPolarSections();
+        current_radial_voxel_ += radial.tStep;
+        current_polar_voxel_ = stepAngularVoxelID(
+            current_polar_voxel_, polar.tStep, grid.numPolarSections());
         break;
       }
       case RadialAzimuthal: {
-        t = radial.tMax;
+        t_ = radial.tMax;
         if (!inBoundsAzimuthal(grid, azimuthal.tStep,
-                               current_azimuthal_voxel)) {
-          voxels.back().exit_t = t_ray_exit;
-          return voxels;
+                               current_azimuthal_voxel_)) {
+          return this->end(t_);
         }
-        current_radial_voxel += radial.tStep;
-        current_azimuthal_voxel = (current_azimuthal_voxel + azimuthal.tStep) %
-                                  grid.numAzimuthalSections();
+        current_radial_voxel_ += radial.tStep;
+        current_azimuthal_voxel_ =
+            stepAngularVoxelID(current_azimuthal_voxel_, azimuthal.tStep,
+                               grid.numAzimuthalSections());
         break;
       }
       case PolarAzimuthal: {
-        t = polar.tMax;
+        t_ = polar.tMax;
         if (!inBoundsAzimuthal(grid, azimuthal.tStep,
-                               current_azimuthal_voxel) ||
-            !(inBoundsPolar(grid, polar.tStep, current_polar_voxel))) {
-          voxels.back().exit_t = t_ray_exit;
-          return voxels;
+                               current_azimuthal_voxel_) ||
+            !(inBoundsPolar(grid, polar.tStep, current_polar_voxel_))) {
+          return this->end(t_);
         }
-        current_polar_voxel =
-            (current_polar_voxel + polar.tStep) % grid.numPolarSections();
-        current_azimuthal_voxel = (current_azimuthal_voxel + azimuthal.tStep) %
-                                  grid.numAzimuthalSections();
+        current_polar_voxel_ = stepAngularVoxelID(
+            current_polar_voxel_, polar.tStep, grid.numPolarSections());
+        current_azimuthal_voxel_ =
+            stepAngularVoxelID(current_azimuthal_voxel_, azimuthal.tStep,
+                               grid.numAzimuthalSections());
         break;
       }
       case RadialPolarAzimuthal: {
-        t = radial.tMax;
+        t_ = radial.tMax;
         if (!inBoundsAzimuthal(grid, azimuthal.tStep,
-                               current_azimuthal_voxel) ||
-            !(inBoundsPolar(grid, polar.tStep, current_polar_voxel))) {
-          voxels.back().exit_t = t_ray_exit;
-          return voxels;
+                               current_azimuthal_voxel_) ||
+            !(inBoundsPolar(grid, polar.tStep, current_polar_voxel_))) {
+          return this->end(t_);
         }
-        current_radial_voxel += radial.tStep;
-        current_polar_voxel =
-            (current_polar_voxel + polar.tStep) % grid.numPolarSections();
-        current_azimuthal_voxel = (current_azimuthal_voxel + azimuthal.tStep) %
-                                  grid.numAzimuthalSections();
+        current_radial_voxel_ += radial.tStep;
+        current_polar_voxel_ = stepAngularVoxelID(
+            current_polar_voxel_, polar.tStep, grid.numPolarSections());
+        current_azimuthal_voxel_ =
+            stepAngularVoxelID(current_azimuthal_voxel_, azimuthal.tStep,
+                               grid.numAzimuthalSections());
         break;
       }
+      case NoIntersection: {
+        // Not returned by minimumIntersection().
+        return this->end(t_);
+      }
     }
-    if (voxels.back().radial == current_radial_voxel &&
-        voxels.back().polar == current_polar_voxel &&
-        voxels.back().azimuthal == current_azimuthal_voxel) {
+    if (voxel_.radial == current_radial_voxel_ &&
+        voxel_.polar == current_polar_voxel_ &&
+        voxel_.azimuthal == current_azimuthal_voxel_) {
       continue;
     }
-    voxels.back().exit_t = t;
-    voxels.push_back({.radial = current_radial_voxel,
-                      .polar = current_polar_voxel,
-                      .azimuthal = current_azimuthal_voxel,
-                      .enter_t = t});
+    voxel_ = {.radial = current_radial_voxel_,
+              .polar = current_polar_voxel_,
+              .azimuthal = current_azimuthal_voxel_,
+              .enter_t = t_,
+              .exit_t = 0.0};
+    // The boundary crossed when stepping to a greater voxel ID is the lower
+    // boundary of the entered voxel, and otherwise its upper boundary. When
+    // the ray passes through the center axis, the step spans several voxels,
+    // so the boundary is not one of the previous voxel.
+    crossing_type_ = voxel_intersection;
+    crossing_t_ = t_;
+    crossing_polar_boundary_ = current_polar_voxel_ + (polar.tStep < 0);
+    crossing_azimuthal_boundary_ =
+        current_azimuthal_voxel_ + (azimuthal.tStep < 0);
+    return true;
+  }
+}
+
+bool TraversalCursor::initialize(double max_t) noexcept {
+  if (max_t <= 0.0) return false;
+  const svr::SphericalVoxelGrid &grid = *grid_;
+  const FreeVec3 rsv =
+      grid.sphereCenter() - ray_.pointAtParameter(0.0);  // Ray Sphere Vector.
+  const double SED_from_center = rsv.squared_length();
+  int radial_entrance_voxel = 0;
+  while (SED_from_center < grid.deltaRadiiSquared(radial_entrance_voxel)) {
+    ++radial_entrance_voxel;
+  }
+  const bool ray_origin_is_outside_grid = (radial_entrance_voxel == 0);
+
+  const std::size_t vector_index =
+      radial_entrance_voxel - !ray_origin_is_outside_grid;
+  const double entry_radius_squared = grid.deltaRadiiSquared(vector_index);
+  const double entry_radius =
+      grid.deltaRadius() *
+      static_cast<double>(grid.numRadialSections() - vector_index);
+  const double rsvd = rsv.dot(rsv);
+  v_ = rsv.dot(ray_.direction().to_free());
+  rsvd_minus_v_squared_ = rsvd - v_ * v_;
+
+  if (entry_radius_squared <= rsvd_minus_v_squared_) return false;
+  const double d = std::sqrt(entry_radius_squared - rsvd_minus_v_squared_);
+  t_ray_exit_ = ray_.timeOfIntersectionAt(v_ + d);
+  if (t_ray_exit_ < 0.0) return false;
+  const double t_ray_entrance = ray_.timeOfIntersectionAt(v_ - d);
+  current_radial_voxel_ = radial_entrance_voxel + ray_origin_is_outside_grid;
+
+  const FreeVec3 ray_sphere =
+      ray_origin_is_outside_grid
+          ? grid.sphereCenter() - ray_.pointAtParameter(t_ray_entrance)
+          : SED_from_center == 0.0 ? rsv - ray_.direction().to_free() : rsv;
+
+  // The voxel boundary segments at the entry radius are only calculated if
+  // the ray origin is within the grid. Otherwise, the entry radius is the
+  // maximum radius and the grid's segments are used.
+  std::vector<svr::LineSegment> P_polar, P_azimuthal;
+  if (!ray_origin_is_outside_grid) {
+    P_polar.resize(grid.numPolarSections() + 1);
+    P_azimuthal.resize(grid.numAzimuthalSections() + 1);
+    initializeVoxelBoundarySegments(P_polar, P_azimuthal,
+                                    ray_origin_is_outside_grid, grid,
+                                    entry_radius);
+  }
+  current_polar_voxel_ = initializeAngularVoxelID(
+      grid, grid.numPolarSections(), ray_sphere,
+      ray_origin_is_outside_grid ? grid.pMaxPolar()
+                                 : TableView<svr::LineSegment>(P_polar),
+      ray_sphere.y(), grid.sphereCenter().y(), entry_radius);
+  if (static_cast<std::size_t>(current_polar_voxel_) >=
+      grid.numPolarSections()) {
+    return false;
+  }
+  current_azimuthal_voxel_ = initializeAngularVoxelID(
+      grid, grid.numAzimuthalSections(), ray_sphere,
+      ray_origin_is_outside_grid ? grid.pMaxAzimuthal()
+                                 : TableView<svr::LineSegment>(P_azimuthal),
+      ray_sphere.z(), grid.sphereCenter().z(), entry_radius);
+  if (static_cast<std::size_t>(current_azimuthal_voxel_) >=
+      grid.numAzimuthalSections()) {
+    return false;
+  }
+  crossing_type_ = ray_origin_is_outside_grid ? Radial : NoIntersection;
+  crossing_t_ = t_ray_entrance;
+  voxel_ = {.radial = current_radial_voxel_,
+            .polar = current_polar_voxel_,
+            .azimuthal = current_azimuthal_voxel_,
+            .enter_t = 0.0,
+            .exit_t = 0.0};
+
+  t_ = t_ray_entrance * ray_origin_is_outside_grid;
+  const double unitized_ray_time =
+      max_t * grid.sphereMaxDiameter() +
+      t_ray_entrance * ray_origin_is_outside_grid;
+  max_t_ = ray_origin_is_outside_grid
+               ? std::min(t_ray_exit_, unitized_ray_time)
+               : unitized_ray_time;
+
+  // Initialize the time in case of collinear min or collinear max for
+  // angular plane hits. In the case where the hit is not collinear, a time
+  // of 0.0 is inputted.
+  collinear_times_ = {{0.0, ray_.timeOfIntersectionAt(grid.sphereCenter())}};
+  radial_step_has_transitioned_ = false;
+  return true;
+}
+
+bool TraversalCursor::initializeWindow(double t_begin,
+                                       double t_end) noexcept {
+  const svr::SphericalVoxelGrid &grid = *grid_;
+  const FreeVec3 rsv = grid.sphereCenter() - ray_.origin();
+  v_ = rsv.dot(ray_.direction().to_free());
+  rsvd_minus_v_squared_ = rsv.dot(rsv) - v_ * v_;
+  if (grid.deltaRadiiSquared(0) <= rsvd_minus_v_squared_) return false;
+  const double d =
+      std::sqrt(grid.deltaRadiiSquared(0) - rsvd_minus_v_squared_);
+  t_ray_exit_ = ray_.timeOfIntersectionAt(v_ + d);
+  const double t_ray_entrance = ray_.timeOfIntersectionAt(v_ - d);
+  t_ = std::max(std::max(t_begin, 0.0), t_ray_entrance);
+  max_t_ = std::min(t_end, t_ray_exit_);
+  if (t_ >= max_t_) return false;
+
+  const std::size_t num_radial_sections = grid.numRadialSections();
+  radial_step_has_transitioned_ = t_ >= v_;
+  // Returns true if the ray lies within the radial boundary sphere with the
+  // given index at time t_.
+  const auto is_within_sphere = [&](std::size_t index) -> bool {
+    const double r_squared = grid.deltaRadiiSquared(index);
+    if (r_squared <= rsvd_minus_v_squared_) return false;
+    const double d_index = std::sqrt(r_squared - rsvd_minus_v_squared_);
+    return radial_step_has_transitioned_
+               ? t_ < ray_.timeOfIntersectionAt(v_ + d_index)
+               : t_ >= ray_.timeOfIntersectionAt(v_ - d_index);
+  };
+  const double radius_estimate =
+      (std::sqrt(grid.deltaRadiiSquared(0)) -
+       (ray_.pointAtParameter(t_) - grid.sphereCenter()).length()) /
+      grid.deltaRadius();
+  std::size_t radial_voxel = static_cast<std::size_t>(std::min(
+      std::max(radius_estimate + 1.0, 1.0),
+      static_cast<double>(num_radial_sections)));
+  while (radial_voxel < num_radial_sections &&
+         is_within_sphere(radial_voxel)) {
+    ++radial_voxel;
+  }
+  while (radial_voxel > 1 && !is_within_sphere(radial_voxel - 1)) {
+    --radial_voxel;
+  }
+  current_radial_voxel_ = static_cast<int>(radial_voxel);
+
+  const FreeVec3 rsv_at_t = grid.sphereCenter() - ray_.pointAtParameter(t_);
+  const FreeVec3 ray_sphere = rsv_at_t.squared_length() == 0.0
+                                  ? rsv_at_t - ray_.direction().to_free()
+                                  : rsv_at_t;
+  const FreeVec3 &direction = ray_.direction().to_free();
+  current_polar_voxel_ = resolveAngularVoxelID(
+      grid, grid.numPolarSections(), grid.pMaxPolar(),
+      grid.polarTrigValues(), ray_sphere, ray_sphere.y(),
+      grid.sphereCenter().y(), direction.x(), direction.y(), t_,
+      initializeAngularVoxelID(grid, grid.numPolarSections(), ray_sphere,
+                               grid.pMaxPolar(), ray_sphere.y(),
+                               grid.sphereCenter().y(),
+                               grid.sphereMaxRadius()));
+  if (static_cast<std::size_t>(current_polar_voxel_) >=
+      grid.numPolarSections()) {
+    return false;
+  }
+  current_azimuthal_voxel_ = resolveAngularVoxelID(
+      grid, grid.numAzimuthalSections(), grid.pMaxAzimuthal(),
+      grid.azimuthalTrigValues(), ray_sphere, ray_sphere.z(),
+      grid.sphereCenter().z(), direction.x(), direction.z(), t_,
+      initializeAngularVoxelID(grid, grid.numAzimuthalSections(),
+                               ray_sphere, grid.pMaxAzimuthal(),
+                               ray_sphere.z(), grid.sphereCenter().z(),
+                               grid.sphereMaxRadius()));
+  if (static_cast<std::size_t>(current_azimuthal_voxel_) >=
+      grid.numAzimuthalSections()) {
+    return false;
+  }
+  crossing_type_ = svr::isEqual(t_, t_ray_entrance) ? Radial : NoIntersection;
+  crossing_t_ = t_;
+  voxel_ = {.radial = current_radial_voxel_,
+            .polar = current_polar_voxel_,
+            .azimuthal = current_azimuthal_voxel_,
+            .enter_t = t_,
+            .exit_t = 0.0};
+  collinear_times_ = {{0.0, ray_.timeOfIntersectionAt(grid.sphereCenter())}};
+  return true;
+}
+
+bool TraversalCursor::initializeReversedWindow(double t_begin,
+                                               double t_end) noexcept {
+  const svr::SphericalVoxelGrid &grid = *grid_;
+  const FreeVec3 rsv = grid.sphereCenter() - ray_.origin();
+  const double v = rsv.dot(ray_.direction().to_free());
+  const double rsvd_minus_v_squared = rsv.dot(rsv) - v * v;
+  if (grid.deltaRadiiSquared(0) <= rsvd_minus_v_squared) return false;
+  const double d = std::sqrt(grid.deltaRadiiSquared(0) - rsvd_minus_v_squared);
+  const double t_window_begin =
+      std::max(std::max(t_begin, 0.0), ray_.timeOfIntersectionAt(v - d));
+  const double t_window_end = std::min(t_end, ray_.timeOfIntersectionAt(v + d));
+  if (t_window_begin >= t_window_end) return false;
+  t_reversal_ = t_window_end;
+  ray_ = Ray(ray_.pointAtParameter(t_window_end),
+             UnitVec3(-ray_.direction().to_free()));
+  return this->initializeWindow(0.0, t_window_end - t_window_begin);
+}
+
+std::vector<svr::SphericalVoxel> walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid,
+    double max_t) noexcept {
+  TraversalCursor cursor(ray, grid, max_t);
+  return traverseToCompletion(cursor, grid);
+}
+
+TraversalArena::TraversalArena(std::size_t capacity) noexcept
+    : block_capacity_(std::max(capacity, std::size_t{1})),
+      capacity_(block_capacity_),
+      size_(0) {
+  blocks_.emplace_back(new svr::SphericalVoxel[block_capacity_]);
+  span_begin_ = top_ = blocks_.back().get();
+  block_end_ = top_ + block_capacity_;
+}
+
+void TraversalArena::reset() noexcept {
+  if (blocks_.size() > 1) {
+    blocks_.clear();
+    block_capacity_ = capacity_;
+    blocks_.emplace_back(new svr::SphericalVoxel[block_capacity_]);
+    block_end_ = blocks_.back().get() + block_capacity_;
   }
+  span_begin_ = top_ = blocks_.back().get();
+  size_ = 0;
+}
+
+void TraversalArena::grow() noexcept {
+  const std::size_t span_size = static_cast<std::size_t>(top_ - span_begin_);
+  block_capacity_ = std::max(2 * block_capacity_, 2 * span_size);
+  capacity_ += block_capacity_;
+  blocks_.emplace_back(new svr::SphericalVoxel[block_capacity_]);
+  svr::SphericalVoxel *block = blocks_.back().get();
+  std::copy(span_begin_, top_, block);
+  span_begin_ = block;
+  top_ = block + span_size;
+  block_end_ = block + block_capacity_;
+}
+
+VoxelSpan walkSphericalVolume(const Ray &ray,
+                              const svr::SphericalVoxelGrid &grid,
+                              double max_t, TraversalArena &arena) noexcept {
+  TraversalCursor cursor(ray, grid, max_t);
+  svr::SphericalVoxel voxel;
+  while (cursor.next(voxel)) arena.push_back(voxel);
+  return arena.closeSpan();
+}
+
+VoxelSpan walkSphericalVolume(const Ray &ray,
+                              const svr::SphericalVoxelGrid &grid,
+                              double t_begin, double t_end,
+                              TraversalArena &arena,
+                              TraversalDirection direction) noexcept {
+  TraversalCursor cursor(ray, grid, t_begin, t_end, direction);
+  svr::SphericalVoxel voxel;
+  while (cursor.next(voxel)) arena.push_back(voxel);
+  return arena.closeSpan();
+}
+
+std::vector<svr::SphericalVoxel> walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid, double max_t,
+    std::vector<VoxelCrossing> &crossings) noexcept {
+  TraversalCursor cursor(ray, grid, max_t);
+  std::vector<svr::SphericalVoxel> voxels;
+  crossings.clear();
+  const std::size_t capacity = grid.numRadialSections() +
+                               grid.numPolarSections() +
+                               grid.numAzimuthalSections();
+  voxels.reserve(capacity);
+  crossings.reserve(capacity);
+  svr::SphericalVoxel voxel;
+  VoxelCrossing crossing;
+  while (cursor.next(voxel, crossing)) {
+    voxels.push_back(voxel);
+    crossings.push_back(crossing);
+  }
+  return voxels;
+}
+
+std::vector<svr::SphericalVoxel> walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid, double t_begin,
+    double t_end, TraversalDirection direction) noexcept {
+  TraversalCursor cursor(ray, grid, t_begin, t_end, direction);
+  return traverseToCompletion(cursor, grid);
+}
+
+VoxelSample sampleRay(const Ray &ray, const svr::SphericalVoxelGrid &grid,
+                      double t) noexcept {
+  const BoundVec3 position = ray.pointAtParameter(t);
+  const FreeVec3 center_to_position = position - grid.sphereCenter();
+  double polar = std::atan2(center_to_position.y(), center_to_position.x());
+  double azimuthal = std::atan2(center_to_position.z(), center_to_position.x());
+  if (polar < 0.0) polar += TAU;
+  if (azimuthal < 0.0) azimuthal += TAU;
+  return {.t = t,
+          .position = position,
+          .radius = center_to_position.length(),
+          .polar = polar,
+          .azimuthal = azimuthal};
+}
+
+void sampleVoxel(const Ray &ray, const svr::SphericalVoxelGrid &grid,
+                 const SphericalVoxel &voxel, std::size_t num_samples,
+                 VoxelSample *samples) noexcept {
+  const double stratum_length =
+      (voxel.exit_t - voxel.enter_t) / static_cast<double>(num_samples);
+  for (std::size_t i = 0; i < num_samples; ++i) {
+    samples[i] = sampleRay(
+        ray, grid,
+        voxel.enter_t + stratum_length * (static_cast<double>(i) + 0.5));
+  }
+}
+
+std::vector<svr::SphericalVoxel> walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid, double t_begin,
+    double t_end, std::size_t samples_per_voxel,
+    std::vector<VoxelSample> &samples) noexcept {
+  TraversalCursor cursor(ray, grid, t_begin, t_end);
+  std::vector<svr::SphericalVoxel> voxels;
+  samples.clear();
+  svr::SphericalVoxel voxel;
+  if (!cursor.next(voxel)) return voxels;
+  const std::size_t capacity = grid.numRadialSections() +
+                               grid.numPolarSections() +
+                               grid.numAzimuthalSections();
+  voxels.reserve(capacity);
+  samples.reserve(capacity * samples_per_voxel);
+  // Each voxel is sampled as soon as its exit time is known.
+  do {
+    voxels.push_back(voxel);
+    samples.resize(samples.size() + samples_per_voxel);
+    sampleVoxel(ray, grid, voxel, samples_per_voxel,
+                samples.data() + samples.size() - samples_per_voxel);
+  } while (cursor.next(voxel));
+  return voxels;
 }
 
 // LCOV_EXCL_START
@@ -639,6 +1395,471 @@ std::vector<svr::SphericalVoxel> walkSphericalVolume(
           BoundVec3(sphere_center[0], sphere_center[1], sphere_center[2])),
       max_t);
 }
+
+std::vector<svr::SphericalVoxel> walkSphericalVolume(
+    double *ray_origin, double *ray_direction, double *min_bound,
+    double *max_bound, std::size_t num_radial_voxels,
+    std::size_t num_polar_voxels, std::size_t num_azimuthal_voxels,
+    double *sphere_center, double t_begin, double t_end,
+    TraversalDirection direction) noexcept {
+  return svr::walkSphericalVolume(
+      Ray(BoundVec3(ray_origin[0], ray_origin[1], ray_origin[2]),
+          UnitVec3(ray_direction[0], ray_direction[1], ray_direction[2])),
+      svr::SphericalVoxelGrid(
+          svr::SphereBound{.radial = min_bound[0],
+                           .polar = min_bound[1],
+                           .azimuthal = min_bound[2]},
+          svr::SphereBound{.radial = max_bound[0],
+                           .polar = max_bound[1],
+                           .azimuthal = max_bound[2]},
+          num_radial_voxels, num_polar_voxels, num_azimuthal_voxels,
+          BoundVec3(sphere_center[0], sphere_center[1], sphere_center[2])),
+      t_begin, t_end, direction);
+}
+// LCOV_EXCL_STOP
+
+std::vector<std::vector<svr::SphericalVoxel>> walkOrthographicImage(
+    const OrthographicImage &image, const svr::SphericalVoxelGrid &grid,
+    double max_t, ImageTraversalMode mode) noexcept {
+  const std::size_t width = image.width;
+  const std::size_t height = image.height;
+  std::vector<std::vector<svr::SphericalVoxel>> pixels(width * height);
+  const ImageMirrors mirrors = mode == EXPLOIT_MIRROR_SYMMETRY
+                                   ? imageMirrors(image, grid)
+                                   : ImageMirrors{.xz = false, .yz = false};
+
+  // Pixels beyond the canonical width and height are derived from the voxels
+  // of their mirror pixel.
+  const std::size_t canonical_width = mirrors.yz ? (width + 1) / 2 : width;
+  const std::size_t canonical_height = mirrors.xz ? (height + 1) / 2 : height;
+
+  const auto pixel_ray = [&image, width, height](std::size_t i,
+                                                 std::size_t j) -> Ray {
+    return Ray(image.image_center +
+                   image.horizontal *
+                       ((i + 0.5) / static_cast<double>(width) - 0.5) +
+                   image.vertical *
+                       ((j + 0.5) / static_cast<double>(height) - 0.5),
+               image.direction);
+  };
+  for (std::size_t j = 0; j < canonical_height; ++j) {
+    const std::size_t mirror_j = height - 1 - j;
+    const bool has_xz_mirror = mirrors.xz && mirror_j != j;
+    for (std::size_t i = 0; i < canonical_width; ++i) {
+      const Ray ray = pixel_ray(i, j);
+      auto &voxels = pixels[j * width + i];
+      voxels = walkSphericalVolume(ray, grid, max_t);
+
+      const std::size_t mirror_i = width - 1 - i;
+      const bool has_yz_mirror = mirrors.yz && mirror_i != i;
+      // The mirrors of a ray whose traversal meets a voxel boundary in a tie do
+      // so as well, and are traversed rather than derived.
+      const bool traverse_mirrors =
+          (has_xz_mirror || has_yz_mirror) &&
+          hasVoxelBoundaryTie(ray, grid, max_t);
+      const auto mirror_pixel = [&](std::size_t mirror_pixel_i,
+                                    std::size_t mirror_pixel_j, bool across_xz,
+                                    bool across_yz) {
+        pixels[mirror_pixel_j * width + mirror_pixel_i] =
+            traverse_mirrors
+                ? walkSphericalVolume(
+                      pixel_ray(mirror_pixel_i, mirror_pixel_j), grid, max_t)
+                : mirrorVoxels(voxels, grid, across_xz, across_yz);
+      };
+      if (has_yz_mirror) {
+        mirror_pixel(mirror_i, j, /*across_xz=*/false, /*across_yz=*/true);
+      }
+      if (has_xz_mirror) {
+        mirror_pixel(i, mirror_j, /*across_xz=*/true, /*across_yz=*/false);
+      }
+      if (has_xz_mirror && has_yz_mirror) {
+        mirror_pixel(mirror_i, mirror_j, /*across_xz=*/true,
+                     /*across_yz=*/true);
+      }
+    }
+  }
+  return pixels;
+}
+
+std::vector<std::size_t> raysIntersectingGrid(
+    const RayBatch &rays, const svr::SphericalVoxelGrid &grid) noexcept {
+  const std::size_t num_rays = rays.size();
+  // The sphere radius is inflated so that rays which only miss the sphere due
+  // to rounding are kept. These are then rejected by the traversal itself.
+  const double inflated_radius_squared =
+      grid.sphereMaxRadius() * grid.sphereMaxRadius() * (1.0 + REL_EPSILON);
+  const BoundVec3 &center = grid.sphereCenter();
+  const bool is_sectored =
+      !(grid.sphereMinBoundPolar() == 0.0 &&
+        svr::isEqual(grid.sphereMaxBoundPolar(), TAU) &&
+        grid.sphereMinBoundAzi() == 0.0 &&
+        svr::isEqual(grid.sphereMaxBoundAzi(), TAU));
+  const BoundingBox box = sectorBoundingBox(grid);
+
+  // The first pass is free of data-dependent branches over contiguous arrays
+  // so that it may be vectorized. The second pass compacts the hits.
+  const double *origin_x = rays.originX();
+  const double *origin_y = rays.originY();
+  const double *origin_z = rays.originZ();
+  const double *direction_x = rays.directionX();
+  const double *direction_y = rays.directionY();
+  const double *direction_z = rays.directionZ();
+  std::vector<unsigned char> is_hit(num_rays);
+  for (std::size_t i = 0; i < num_rays; ++i) {
+    const double dx = direction_x[i];
+    const double dy = direction_y[i];
+    const double dz = direction_z[i];
+    const double rsv_x = center.x() - origin_x[i];
+    const double rsv_y = center.y() - origin_y[i];
+    const double rsv_z = center.z() - origin_z[i];
+    const double inv_length = 1.0 / std::sqrt(dx * dx + dy * dy + dz * dz);
+    const double v = (rsv_x * dx + rsv_y * dy + rsv_z * dz) * inv_length;
+    const double rsvd_minus_v_squared =
+        rsv_x * rsv_x + rsv_y * rsv_y + rsv_z * rsv_z - v * v;
+    const double discriminant =
+        std::max(inflated_radius_squared - rsvd_minus_v_squared, 0.0);
+    is_hit[i] = rsvd_minus_v_squared < inflated_radius_squared &&
+                v + std::sqrt(discriminant) >= 0.0;
+  }
+  if (is_sectored) {
+    for (std::size_t i = 0; i < num_rays; ++i) {
+      const SlabTimes x = slabTimes(origin_x[i], direction_x[i], box.min.x(),
+                                    box.max.x());
+      const SlabTimes y = slabTimes(origin_y[i], direction_y[i], box.min.y(),
+                                    box.max.y());
+      const SlabTimes z = slabTimes(origin_z[i], direction_z[i], box.min.z(),
+                                    box.max.z());
+      const double t_enter = std::max(std::max(x.enter, y.enter), z.enter);
+      const double t_exit = std::min(std::min(x.exit, y.exit), z.exit);
+      is_hit[i] &= t_enter <= t_exit && t_exit >= 0.0;
+    }
+  }
+
+  std::vector<std::size_t> ray_indices;
+  ray_indices.reserve(num_rays);
+  for (std::size_t i = 0; i < num_rays; ++i) {
+    if (is_hit[i]) ray_indices.push_back(i);
+  }
+  return ray_indices;
+}
+
+std::vector<std::size_t> coherentRayOrder(
+    const RayBatch &rays,
+    const std::vector<std::size_t> &ray_indices) noexcept {
+  if (ray_indices.empty()) return {};
+  // The number of quantization levels per dimension for the origin and the
+  // direction Morton codes respectively.
+  constexpr std::uint64_t ORIGIN_LEVELS = 1 << 12;
+  constexpr std::uint64_t DIRECTION_LEVELS = 1 << 8;
+  BoundVec3 min_origin = rays.origin(ray_indices.front());
+  BoundVec3 max_origin = min_origin;
+  for (const std::size_t i : ray_indices) {
+    const BoundVec3 origin = rays.origin(i);
+    min_origin = BoundVec3(std::min(min_origin.x(), origin.x()),
+                           std::min(min_origin.y(), origin.y()),
+                           std::min(min_origin.z(), origin.z()));
+    max_origin = BoundVec3(std::max(max_origin.x(), origin.x()),
+                           std::max(max_origin.y(), origin.y()),
+                           std::max(max_origin.z(), origin.z()));
+  }
+  const double inv_extent_x = inverseExtent(min_origin.x(), max_origin.x());
+  const double inv_extent_y = inverseExtent(min_origin.y(), max_origin.y());
+  const double inv_extent_z = inverseExtent(min_origin.z(), max_origin.z());
+
+  std::vector<std::pair<std::uint64_t, std::size_t>> keyed_rays;
+  keyed_rays.reserve(ray_indices.size());
+  for (const std::size_t i : ray_indices) {
+    const BoundVec3 origin = rays.origin(i);
+    const FreeVec3 direction = rays.direction(i);
+    const std::uint64_t octant = (direction.x() < 0.0) |
+                                 (direction.y() < 0.0) << 1 |
+                                 (direction.z() < 0.0) << 2;
+    const std::uint64_t origin_code = mortonCode(
+        quantize(origin.x(), min_origin.x(), inv_extent_x, ORIGIN_LEVELS),
+        quantize(origin.y(), min_origin.y(), inv_extent_y, ORIGIN_LEVELS),
+        quantize(origin.z(), min_origin.z(), inv_extent_z, ORIGIN_LEVELS));
+    // Unit direction components lie within [-1, 1].
+    const FreeVec3 unit_direction = direction / direction.length();
+    const std::uint64_t direction_code = mortonCode(
+        quantize(unit_direction.x(), -1.0, 0.5, DIRECTION_LEVELS),
+        quantize(unit_direction.y(), -1.0, 0.5, DIRECTION_LEVELS),
+        quantize(unit_direction.z(), -1.0, 0.5, DIRECTION_LEVELS));
+    keyed_rays.push_back(
+        {octant << 60 | origin_code << 24 | direction_code, i});
+  }
+  std::sort(keyed_rays.begin(), keyed_rays.end());
+
+  std::vector<std::size_t> sorted_ray_indices(keyed_rays.size());
+  std::transform(keyed_rays.cbegin(), keyed_rays.cend(),
+                 sorted_ray_indices.begin(),
+                 [](const std::pair<std::uint64_t, std::size_t> &keyed_ray)
+                     -> std::size_t { return keyed_ray.second; });
+  return sorted_ray_indices;
+}
+
+std::vector<std::size_t> coherentRayOrder(const RayBatch &rays) noexcept {
+  std::vector<std::size_t> ray_indices(rays.size());
+  std::iota(ray_indices.begin(), ray_indices.end(), 0);
+  return coherentRayOrder(rays, ray_indices);
+}
+
+std::vector<std::vector<svr::SphericalVoxel>> walkSphericalVolumeBatch(
+    const RayBatch &rays, const std::vector<std::size_t> &ray_indices,
+    const svr::SphericalVoxelGrid &grid, double max_t) noexcept {
+  std::vector<std::vector<svr::SphericalVoxel>> voxels(rays.size());
+  for (const std::size_t i : ray_indices) {
+    voxels[i] = walkSphericalVolume(rays.ray(i), grid, max_t);
+  }
+  return voxels;
+}
+
+std::vector<std::vector<svr::SphericalVoxel>> walkSphericalVolumeInterleaved(
+    const RayBatch &rays, const std::vector<std::size_t> &ray_indices,
+    const svr::SphericalVoxelGrid &grid, double max_t) noexcept {
+  std::vector<std::vector<svr::SphericalVoxel>> voxels(rays.size());
+  const std::size_t max_voxels_per_ray = grid.numRadialSections() +
+                                         grid.numPolarSections() +
+                                         grid.numAzimuthalSections();
+  // Each lane holds the index of its ray and the cursor of that ray.
+  std::vector<std::pair<std::size_t, TraversalCursor>> lanes;
+  lanes.reserve(NUM_INTERLEAVED_RAYS);
+  std::size_t next_index = 0;
+
+  // Begins the traversal of the next ray which traverses at least one voxel.
+  // Returns false if there are no such rays remaining.
+  const auto begin_next_ray = [&](std::size_t lane) -> bool {
+    while (next_index < ray_indices.size()) {
+      const std::size_t i = ray_indices[next_index++];
+      const TraversalCursor cursor(rays.ray(i), grid, max_t);
+      if (!cursor.hasNext()) continue;
+      voxels[i].reserve(max_voxels_per_ray);
+      if (lane == lanes.size()) {
+        lanes.emplace_back(i, cursor);
+      } else {
+        lanes[lane] = std::make_pair(i, cursor);
+      }
+      return true;
+    }
+    return false;
+  };
+
+  while (lanes.size() < NUM_INTERLEAVED_RAYS &&
+         begin_next_ray(lanes.size())) {
+  }
+  // Each iteration advances every lane by one voxel. Since the lanes are
+  // independent, the latency of the square roots and divisions of one lane is
+  // overlapped with the work of the others.
+  svr::SphericalVoxel voxel;
+  while (!lanes.empty()) {
+    for (std::size_t lane = 0; lane < lanes.size();) {
+      if (lanes[lane].second.next(voxel)) {
+        voxels[lanes[lane].first].push_back(voxel);
+        ++lane;
+        continue;
+      }
+      if (begin_next_ray(lane)) {
+        ++lane;
+        continue;
+      }
+      lanes[lane] = lanes.back();
+      lanes.pop_back();
+    }
+  }
+  return voxels;
+}
+
+std::vector<std::vector<svr::SphericalVoxel>> walkSphericalVolumeBatch(
+    const RayBatch &rays, const svr::SphericalVoxelGrid &grid, double max_t,
+    RayOrdering ordering) noexcept {
+  if (max_t <= 0.0) {
+    return std::vector<std::vector<svr::SphericalVoxel>>(rays.size());
+  }
+  const std::vector<std::size_t> ray_indices = raysIntersectingGrid(rays, grid);
+  return walkSphericalVolumeBatch(
+      rays,
+      ordering == COHERENT_ORDER ? coherentRayOrder(rays, ray_indices)
+                                 : ray_indices,
+      grid, max_t);
+}
+
+std::vector<VoxelSpan> walkSphericalVolumeBatch(
+    const RayBatch &rays, const std::vector<std::size_t> &ray_indices,
+    const svr::SphericalVoxelGrid &grid, double max_t,
+    TraversalArena &arena) noexcept {
+  std::vector<VoxelSpan> spans(rays.size(), {.data = nullptr, .size = 0});
+  for (const std::size_t i : ray_indices) {
+    spans[i] = walkSphericalVolume(rays.ray(i), grid, max_t, arena);
+  }
+  return spans;
+}
+
+std::vector<VoxelSpan> walkSphericalVolumeBatch(
+    const RayBatch &rays, const svr::SphericalVoxelGrid &grid, double max_t,
+    TraversalArena &arena, RayOrdering ordering) noexcept {
+  if (max_t <= 0.0) {
+    return std::vector<VoxelSpan>(rays.size(), {.data = nullptr, .size = 0});
+  }
+  const std::vector<std::size_t> ray_indices = raysIntersectingGrid(rays, grid);
+  return walkSphericalVolumeBatch(
+      rays,
+      ordering == COHERENT_ORDER ? coherentRayOrder(rays, ray_indices)
+                                 : ray_indices,
+      grid, max_t, arena);
+}
+
+void walkSphericalVolumeBatch(const RayBatch &rays,
+                              const std::vector<std::size_t> &ray_indices,
+                              const svr::SphericalVoxelGrid &grid,
+                              double max_t, VoxelColumns &columns,
+                              const VoxelLayout *layout) noexcept {
+  columns.clear();
+  columns.first.resize(rays.size(), 0);
+  columns.count.resize(rays.size(), 0);
+  svr::SphericalVoxel voxel;
+  for (const std::size_t i : ray_indices) {
+    TraversalCursor cursor(rays.ray(i), grid, max_t);
+    columns.first[i] = columns.size();
+    if (layout == nullptr) {
+      while (cursor.next(voxel)) columns.push_back(voxel);
+    } else {
+      VoxelIndexer indexer(*layout);
+      while (cursor.next(voxel)) {
+        columns.push_back(voxel);
+        columns.index.push_back(indexer(voxel));
+      }
+    }
+    columns.count[i] = columns.size() - columns.first[i];
+  }
+}
+
+void walkSphericalVolumeBatch(const RayBatch &rays,
+                              const svr::SphericalVoxelGrid &grid,
+                              double max_t, VoxelColumns &columns,
+                              RayOrdering ordering,
+                              const VoxelLayout *layout) noexcept {
+  if (max_t <= 0.0) {
+    walkSphericalVolumeBatch(rays, std::vector<std::size_t>(), grid, max_t,
+                             columns, layout);
+    return;
+  }
+  const std::vector<std::size_t> ray_indices = raysIntersectingGrid(rays, grid);
+  walkSphericalVolumeBatch(
+      rays,
+      ordering == COHERENT_ORDER ? coherentRayOrder(rays, ray_indices)
+                                 : ray_indices,
+      grid, max_t, columns, layout);
+}
+
+void locatePoints(const double *points, std::size_t num_points,
+                  const svr::SphericalVoxelGrid &grid, int *voxels) noexcept {
+  // The points are located in blocks, each in several passes over arrays of
+  // the block. The first pass computes the offset, distance, and radial
+  // estimate of each point free of data-dependent branches, so that it may be
+  // vectorized. The second pass corrects the estimates, which resolves points
+  // on radial boundaries exactly. The last pass locates the angular voxels of
+  // the points within the sphere, for which the angle only estimates a voxel
+  // that is then checked against its boundaries.
+  constexpr std::size_t BLOCK_SIZE = 256;
+  const BoundVec3 &center = grid.sphereCenter();
+  const std::size_t num_radial_sections = grid.numRadialSections();
+  const double max_radius = std::sqrt(grid.deltaRadiiSquared(0));
+  const double inverse_delta_radius = 1.0 / grid.deltaRadius();
+  const double max_estimate = static_cast<double>(num_radial_sections);
+  double d_x[BLOCK_SIZE], d_y[BLOCK_SIZE], d_z[BLOCK_SIZE];
+  double SED[BLOCK_SIZE], estimate[BLOCK_SIZE];
+  int radial[BLOCK_SIZE];
+  for (std::size_t begin = 0; begin < num_points; begin += BLOCK_SIZE) {
+    const std::size_t n = std::min(BLOCK_SIZE, num_points - begin);
+    const double *block_points = points + 3 * begin;
+    int *block_voxels = voxels + 3 * begin;
+    for (std::size_t i = 0; i < n; ++i) {
+      d_x[i] = block_points[3 * i] - center.x();
+      d_y[i] = block_points[3 * i + 1] - center.y();
+      d_z[i] = block_points[3 * i + 2] - center.z();
+      SED[i] = d_x[i] * d_x[i] + d_y[i] * d_y[i] + d_z[i] * d_z[i];
+      estimate[i] = std::min(
+          std::max((max_radius - std::sqrt(SED[i])) * inverse_delta_radius +
+                       1.0,
+                   0.0),
+          max_estimate);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      radial[i] = locateRadialVoxelID(grid, SED[i], estimate[i]);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      int *voxel = block_voxels + 3 * i;
+      voxel[0] = voxel[1] = voxel[2] = -1;
+      if (radial[i] == 0) continue;
+      const double radius =
+          grid.deltaRadius() *
+          static_cast<double>(num_radial_sections - (radial[i] - 1));
+      const int polar = locateAngularVoxelID(
+          grid.polarTrigValues(), grid.numPolarSections(),
+          grid.sphereMinBoundPolar(), grid.deltaTheta(), radius, center.x(),
+          center.y(), d_x[i], d_y[i]);
+      if (static_cast<std::size_t>(polar) >= grid.numPolarSections()) continue;
+      const int azimuthal = locateAngularVoxelID(
+          grid.azimuthalTrigValues(), grid.numAzimuthalSections(),
+          grid.sphereMinBoundAzi(), grid.deltaPhi(), radius, center.x(),
+          center.z(), d_x[i], d_z[i]);
+      if (static_cast<std::size_t>(azimuthal) >=
+          grid.numAzimuthalSections()) {
+        continue;
+      }
+      voxel[0] = radial[i];
+      voxel[1] = polar;
+      voxel[2] = azimuthal;
+    }
+  }
+}
+
+// LCOV_EXCL_START
+void walkSphericalVolumeBatch(
+    const double *ray_origins, const double *ray_directions,
+    std::size_t num_rays, double *min_bound, double *max_bound,
+    std::size_t num_radial_voxels, std::size_t num_polar_voxels,
+    std::size_t num_azimuthal_voxels, double *sphere_center, double max_t,
+    VoxelColumns &columns) noexcept {
+  RayBatch rays;
+  rays.reserve(num_rays);
+  for (std::size_t i = 0; i < num_rays; ++i) {
+    const double *origin = ray_origins + 3 * i;
+    const double *direction = ray_directions + 3 * i;
+    rays.push_back(BoundVec3(origin[0], origin[1], origin[2]),
+                   FreeVec3(direction[0], direction[1], direction[2]));
+  }
+  svr::walkSphericalVolumeBatch(
+      rays,
+      svr::SphericalVoxelGrid(
+          svr::SphereBound{.radial = min_bound[0],
+                           .polar = min_bound[1],
+                           .azimuthal = min_bound[2]},
+          svr::SphereBound{.radial = max_bound[0],
+                           .polar = max_bound[1],
+                           .azimuthal = max_bound[2]},
+          num_radial_voxels, num_polar_voxels, num_azimuthal_voxels,
+          BoundVec3(sphere_center[0], sphere_center[1], sphere_center[2])),
+      max_t, columns);
+}
+
+void locatePoints(const double *points, std::size_t num_points,
+                  double *min_bound, double *max_bound,
+                  std::size_t num_radial_voxels, std::size_t num_polar_voxels,
+                  std::size_t num_azimuthal_voxels, double *sphere_center,
+                  int *voxels) noexcept {
+  svr::locatePoints(
+      points, num_points,
+      svr::SphericalVoxelGrid(
+          svr::SphereBound{.radial = min_bound[0],
+                           .polar = min_bound[1],
+                           .azimuthal = min_bound[2]},
+          svr::SphereBound{.radial = max_bound[0],
+                           .polar = max_bound[1],
+                           .azimuthal = max_bound[2]},
+          num_radial_voxels, num_polar_voxels, num_azimuthal_voxels,
+          BoundVec3(sphere_center[0], sphere_center[1], sphere_center[2])),
+      voxels);
+}
 // LCOV_EXCL_STOP
 
-}  // namespace svr
\ No newline at end of file
+}  // namespace svr
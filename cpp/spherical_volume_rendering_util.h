@@ -1,11 +1,17 @@
 #ifndef SPHERICAL_VOLUME_RENDERING_SPHERICALVOLUMERENDERINGUTIL_H
 #define SPHERICAL_VOLUME_RENDERING_SPHERICALVOLUMERENDERINGUTIL_H
 
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
 #include <vector>
 
 #include "ray.h"
+#include "ray_batch.h"
 #include "spherical_voxel_grid.h"
 #include "vec3.h"
+#include "voxel_layout.h"
 
 namespace svr {
 
@@ -20,6 +26,35 @@ struct SphericalVoxel {
   double exit_t;
 };
 
+// The voxel boundaries crossed upon entering a voxel, i.e. the type
+// corresponding to the voxel(s) with the minimum tMax value for a given
+// traversal step. Several boundaries are crossed at once when the ray passes
+// through an edge or corner of a voxel.
+enum VoxelIntersectionType {
+  // The voxel is entered without crossing a boundary, e.g. the ray origin or
+  // the beginning of a window lies within it.
+  NoIntersection = 0,
+  Radial = 1,
+  Polar = 2,
+  Azimuthal = 3,
+  RadialPolar = 4,
+  RadialAzimuthal = 5,
+  PolarAzimuthal = 6,
+  RadialPolarAzimuthal = 7
+};
+
+// Describes the voxel boundaries crossed upon entering a voxel.
+struct VoxelCrossing {
+  VoxelIntersectionType type;
+
+  // The unit normal of the crossed boundary at the point of entrance, oriented
+  // against the direction of traversal. This is the outward normal of the face
+  // through which the voxel is entered. If several boundaries are crossed at
+  // once, this is the normalized sum of their normals. The normal is zero for
+  // NoIntersection.
+  FreeVec3 normal;
+};
+
 // A spherical coordinate voxel traversal algorithm. The algorithm traces the
 // ray with unit direction over the spherical voxel grid provided. Returns a
 // vector of the spherical coordinate voxels traversed. max_t is the unitized
@@ -40,6 +75,609 @@ std::vector<SphericalVoxel> walkSphericalVolume(
     std::size_t num_polar_voxels, std::size_t num_azimuthal_voxels,
     double *sphere_center, double max_t) noexcept;
 
+// The directions in which a window of a ray may be traversed.
+enum TraversalDirection {
+  // Voxels are traversed from near to far, i.e. in order of increasing time.
+  FRONT_TO_BACK = 0,
+
+  // Voxels are traversed from far to near, beginning at the end of the window
+  // and walking toward the ray origin. Each voxel's enter and exit times remain
+  // those of the ray, so the voxels are those of a front-to-back traversal in
+  // reverse order.
+  BACK_TO_FRONT = 1
+};
+
+// Similar to above, but additionally stores the boundaries crossed upon
+// entering each voxel in 'crossings', i.e. crossings[i] is the crossing of the
+// i-th voxel returned.
+std::vector<SphericalVoxel> walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid, double max_t,
+    std::vector<VoxelCrossing> &crossings) noexcept;
+
+// Similar to above, but only traverses the ray within the window of times
+// [t_begin, t_end], where t is the parameter of the ray, i.e. the point
+// ray.origin() + ray.direction() * t. Unlike max_t, these are not unitized.
+// The window is clipped to the sphere of max radius and to t >= 0. Rather
+// than walking from the sphere entrance, the voxel at t_begin is located
+// directly, so the cost of a traversal is proportional to the voxels within
+// the window. This allows a ray to be traversed in segments, e.g. across
+// volume splits or clip planes, or to resume a previous traversal. The enter
+// time of the first voxel is the beginning of the clipped window, and the exit
+// time of the last voxel is the time at which the traversal ended. If the ray
+// lies outside a sectored grid at t_begin, no voxels are traversed. For a
+// back-to-front traversal, the voxel at the end of the clipped window is
+// instead located directly, and the traversal ends at the beginning of the
+// window.
+std::vector<SphericalVoxel> walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid, double t_begin,
+    double t_end, TraversalDirection direction = FRONT_TO_BACK) noexcept;
+
+// Simplified parameters to Cythonize the function; implementation remains the
+// same as above.
+std::vector<SphericalVoxel> walkSphericalVolume(
+    double *ray_origin, double *ray_direction, double *min_bound,
+    double *max_bound, std::size_t num_radial_voxels,
+    std::size_t num_polar_voxels, std::size_t num_azimuthal_voxels,
+    double *sphere_center, double t_begin, double t_end,
+    TraversalDirection direction = FRONT_TO_BACK) noexcept;
+
+// A sample position along the ray within a traversed voxel.
+struct VoxelSample {
+  // The time of the sample, and its position ray.pointAtParameter(t).
+  double t;
+  BoundVec3 position;
+
+  // The spherical coordinates of the position with respect to the sphere
+  // center, using the conventions of the grid: the polar angle lies in the XY
+  // plane and the azimuthal angle in the XZ plane, both measured from the X
+  // axis within [0, 2pi).
+  double radius;
+  double polar;
+  double azimuthal;
+};
+
+// Returns the sample of the ray at time t.
+VoxelSample sampleRay(const Ray &ray, const svr::SphericalVoxelGrid &grid,
+                      double t) noexcept;
+
+// Stores num_samples samples of the segment of the ray within the given voxel
+// in 'samples', i.e. between voxel.enter_t and voxel.exit_t. The segment is
+// divided into num_samples strata of equal length, and a sample is placed at
+// the center of each. A single sample is therefore the midpoint of the
+// segment.
+void sampleVoxel(const Ray &ray, const svr::SphericalVoxelGrid &grid,
+                 const SphericalVoxel &voxel, std::size_t num_samples,
+                 VoxelSample *samples) noexcept;
+
+// Similar to the windowed walkSphericalVolume(), but additionally stores
+// samples_per_voxel samples of each traversed voxel in 'samples', as in
+// sampleVoxel(). The samples of the i-th voxel returned are
+// samples[i * samples_per_voxel, (i + 1) * samples_per_voxel). Since the
+// window's enter and exit times are those at which the ray crosses each voxel
+// boundary, every sample lies within its voxel.
+std::vector<SphericalVoxel> walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid, double t_begin,
+    double t_end, std::size_t samples_per_voxel,
+    std::vector<VoxelSample> &samples) noexcept;
+
+// A resumable traversal of a single ray. The cursor holds the loop state of
+// walkSphericalVolume() and yields the traversed voxels one at a time with
+// next(), so no vector of voxels is materialized. A consumer may stop early,
+// interleave the cursors of many rays, or keep a cursor to resume its ray in a
+// later pass. The cursor is also an input range, e.g.
+//
+//   svr::TraversalCursor cursor(ray, grid, /*max_t=*/1.0);
+//   for (const svr::SphericalVoxel &voxel : cursor) { ... }
+//
+// The voxels yielded are those of the corresponding walkSphericalVolume().
+// The grid must outlive the cursor.
+class TraversalCursor {
+ public:
+  // An input iterator over the remaining voxels of a cursor. Each increment
+  // consumes a voxel from the cursor, so breaking out of a range-for loop
+  // and resuming the cursor continues after the last voxel visited.
+  class Iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = SphericalVoxel;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const SphericalVoxel *;
+    using reference = const SphericalVoxel &;
+
+    // Constructs the end iterator.
+    inline Iterator() noexcept : cursor_(nullptr) {}
+
+    inline explicit Iterator(TraversalCursor *cursor) noexcept
+        : cursor_(cursor) {
+      ++*this;
+    }
+
+    inline reference operator*() const noexcept { return voxel_; }
+
+    inline pointer operator->() const noexcept { return &voxel_; }
+
+    inline Iterator &operator++() noexcept {
+      if (!cursor_->next(voxel_)) cursor_ = nullptr;
+      return *this;
+    }
+
+    inline Iterator operator++(int) noexcept {
+      const Iterator previous = *this;
+      ++*this;
+      return previous;
+    }
+
+    inline bool operator==(const Iterator &other) const noexcept {
+      return cursor_ == other.cursor_;
+    }
+
+    inline bool operator!=(const Iterator &other) const noexcept {
+      return cursor_ != other.cursor_;
+    }
+
+   private:
+    // The cursor from which voxels are consumed. This is nullptr once the
+    // cursor has no voxels remaining.
+    TraversalCursor *cursor_;
+
+    // The voxel most recently consumed.
+    SphericalVoxel voxel_;
+  };
+
+  // Initializes the traversal of the ray with max_t, as in
+  // walkSphericalVolume().
+  TraversalCursor(const Ray &ray, const svr::SphericalVoxelGrid &grid,
+                  double max_t) noexcept;
+
+  // Initializes the traversal of the ray within the window [t_begin, t_end]
+  // in the given direction, as in walkSphericalVolume().
+  TraversalCursor(const Ray &ray, const svr::SphericalVoxelGrid &grid,
+                  double t_begin, double t_end,
+                  TraversalDirection direction = FRONT_TO_BACK) noexcept;
+
+  // Stores the next voxel of the traversal in 'voxel'. Returns false, leaving
+  // 'voxel' unchanged, if no voxels remain.
+  bool next(SphericalVoxel &voxel) noexcept;
+
+  // Similar to above, but additionally stores the boundaries crossed upon
+  // entering the voxel in 'crossing'. The normal is only calculated here, so
+  // the traversal is otherwise unaffected.
+  bool next(SphericalVoxel &voxel, VoxelCrossing &crossing) noexcept;
+
+  inline bool hasNext() const noexcept { return has_next_; }
+
+  // The voxel that the next call to next() returns, which is only valid if
+  // hasNext(). The cursor steps to each voxel before returning the previous
+  // one, so the upcoming voxel is known while the current voxel is processed,
+  // e.g. to prefetch its data. Only its radial, polar, and azimuthal indices
+  // are final.
+  inline const SphericalVoxel &upcoming() const noexcept { return voxel_; }
+
+  inline Iterator begin() noexcept { return Iterator(this); }
+
+  inline Iterator end() const noexcept { return Iterator(); }
+
+ private:
+  // Advances the traversal to the next voxel entered. Returns false once the
+  // traversal has ended. Otherwise, voxel_ is the next voxel.
+  bool step() noexcept;
+
+  // Initializes voxel_ with the entrance voxel, and the parameters used
+  // throughout the traversal. Returns false if the ray does not traverse any
+  // voxels.
+  bool initialize(double max_t) noexcept;
+
+  // Similar to above, for the window [t_begin, t_end]. The entrance voxel is
+  // located directly at t_begin.
+  bool initializeWindow(double t_begin, double t_end) noexcept;
+
+  // Similar to above, for a back-to-front traversal of the window. The ray is
+  // replaced by its reverse, which originates at the end of the clipped
+  // window, and the reversed window is initialized.
+  bool initializeReversedWindow(double t_begin, double t_end) noexcept;
+
+  // Returns the boundaries crossed upon entering voxel_.
+  VoxelCrossing crossing() const noexcept;
+
+  // Ends the traversal at time t_exit. Always returns false.
+  inline bool end(double t_exit) noexcept {
+    t_exit_ = t_exit;
+    return false;
+  }
+
+  // The ray being traversed.
+  Ray ray_;
+
+  // The grid being traversed.
+  const svr::SphericalVoxelGrid *grid_;
+
+  // Whether the traversal is limited to a window of times.
+  bool is_windowed_;
+
+  // Whether ray_ is the reverse of the ray being traversed. If so, a time t of
+  // ray_ is the time t_reversal_ - t of the ray being traversed.
+  bool is_reversed_;
+  double t_reversal_;
+
+  // Whether voxel_ has yet to be yielded by next().
+  bool has_next_;
+
+  // The last voxel entered. Its exit time is determined by the next step.
+  SphericalVoxel voxel_;
+
+  // The current radial, polar, and azimuthal voxels. These may differ from
+  // voxel_ only within step().
+  int current_radial_voxel_, current_polar_voxel_, current_azimuthal_voxel_;
+
+  // The dot product of the ray sphere vector and the ray direction, and the
+  // squared length of the ray sphere vector minus v_ squared.
+  double v_, rsvd_minus_v_squared_;
+
+  // The current time, the maximum time, the time at which the ray exits the
+  // sphere of entry, and the time at which the traversal ended.
+  double t_, max_t_, t_ray_exit_, t_exit_;
+
+  // The times used for collinear angular hits: 0.0, and the time at which the
+  // ray is nearest the sphere center.
+  std::array<double, 2> collinear_times_;
+
+  // The boundaries crossed upon entering voxel_, the time at which they are
+  // crossed, and the indices of the angular boundaries crossed.
+  VoxelIntersectionType crossing_type_;
+  double crossing_t_;
+  int crossing_polar_boundary_, crossing_azimuthal_boundary_;
+
+  bool radial_step_has_transitioned_;
+};
+
+// Computes the indices of the voxels of a traversal within a layout. Between
+// consecutive voxels of a traversal, usually a single voxel index changes, so
+// the indexer keeps the offset of each dimension and only looks up the offset
+// of an index that changed. The index is then the sum of three offsets, with
+// no multiplication. The layout must outlive the indexer.
+class VoxelIndexer {
+ public:
+  explicit VoxelIndexer(const VoxelLayout &layout) noexcept
+      : layout_(&layout),
+        radial_(-1),
+        polar_(-1),
+        azimuthal_(-1),
+        radial_offset_(0),
+        polar_offset_(0),
+        azimuthal_offset_(0) {}
+
+  inline std::size_t operator()(const SphericalVoxel &voxel) noexcept {
+    if (voxel.radial != radial_) {
+      radial_ = voxel.radial;
+      radial_offset_ = layout_->radialOffset(radial_);
+    }
+    if (voxel.polar != polar_) {
+      polar_ = voxel.polar;
+      polar_offset_ = layout_->polarOffset(polar_);
+    }
+    if (voxel.azimuthal != azimuthal_) {
+      azimuthal_ = voxel.azimuthal;
+      azimuthal_offset_ = layout_->azimuthalOffset(azimuthal_);
+    }
+    return radial_offset_ + polar_offset_ + azimuthal_offset_;
+  }
+
+ private:
+  const VoxelLayout *layout_;
+
+  // The voxel indices of the last voxel, and their offsets.
+  int radial_, polar_, azimuthal_;
+  std::size_t radial_offset_, polar_offset_, azimuthal_offset_;
+};
+
+// Similar to walkSphericalVolume(), but additionally stores the index of each
+// voxel traversed within the layout in 'indices', which is first cleared. The
+// layout must be of the grid's dimensions. Index may be a 32-bit integer if
+// every index of the layout fits, which halves the memory of the indices.
+template <typename Index>
+std::vector<SphericalVoxel> walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid, double max_t,
+    const VoxelLayout &layout, std::vector<Index> &indices) noexcept {
+  std::vector<SphericalVoxel> voxels;
+  indices.clear();
+  VoxelIndexer indexer(layout);
+  TraversalCursor cursor(ray, grid, max_t);
+  SphericalVoxel voxel;
+  while (cursor.next(voxel)) {
+    voxels.push_back(voxel);
+    indices.push_back(static_cast<Index>(indexer(voxel)));
+  }
+  return voxels;
+}
+
+// A contiguous run of voxels, e.g. the traversal of a ray stored in a
+// TraversalArena.
+struct VoxelSpan {
+  const SphericalVoxel *data;
+  std::size_t size;
+
+  inline const SphericalVoxel *begin() const noexcept { return data; }
+
+  inline const SphericalVoxel *end() const noexcept { return data + size; }
+
+  inline bool empty() const noexcept { return size == 0; }
+
+  inline const SphericalVoxel &operator[](std::size_t i) const noexcept {
+    return data[i];
+  }
+};
+
+// A monotonic buffer for the voxels of traversals. The voxels of each
+// traversal are appended to an open span, which is closed once the traversal
+// ends, so the traversals of a batch are bump-allocated one after another
+// rather than each allocating its own vector. Closed spans remain valid until
+// reset(), which discards them but keeps the memory for the next batch. An
+// arena is not thread-safe, so each thread should use its own.
+class TraversalArena {
+ public:
+  // Reserves memory for 'capacity' voxels.
+  explicit TraversalArena(std::size_t capacity = 1 << 16) noexcept;
+
+  // Appends a voxel to the open span. If the block is full, the open span is
+  // moved to a new block of at least twice the size, so that every span
+  // remains contiguous.
+  inline void push_back(const SphericalVoxel &voxel) noexcept {
+    if (top_ == block_end_) this->grow();
+    *top_++ = voxel;
+  }
+
+  // Closes the open span and returns it. Subsequent voxels begin a new span.
+  inline VoxelSpan closeSpan() noexcept {
+    const VoxelSpan span = {
+        .data = span_begin_,
+        .size = static_cast<std::size_t>(top_ - span_begin_)};
+    this->size_ += span.size;
+    this->span_begin_ = top_;
+    return span;
+  }
+
+  // Discards every span. If the spans overflowed into several blocks, these
+  // are replaced by a single block of their total size, so that the next
+  // batch is contiguous.
+  void reset() noexcept;
+
+  // The number of voxels within closed spans since the last reset().
+  inline std::size_t size() const noexcept { return this->size_; }
+
+  // The number of voxels the arena holds without allocating.
+  inline std::size_t capacity() const noexcept { return this->capacity_; }
+
+ private:
+  // Moves the open span to a new block.
+  void grow() noexcept;
+
+  // The blocks, the last of which is in use, and their total capacity.
+  std::vector<std::unique_ptr<SphericalVoxel[]>> blocks_;
+  std::size_t block_capacity_, capacity_;
+
+  // The open span is [span_begin_, top_), within the last block, which ends
+  // at block_end_.
+  SphericalVoxel *span_begin_, *top_, *block_end_;
+  std::size_t size_;
+};
+
+// Similar to walkSphericalVolume(), but appends the voxels traversed to the
+// arena, and returns their span.
+VoxelSpan walkSphericalVolume(const Ray &ray,
+                              const svr::SphericalVoxelGrid &grid,
+                              double max_t, TraversalArena &arena) noexcept;
+
+// Similar to the windowed walkSphericalVolume(), but appends the voxels
+// traversed to the arena, and returns their span.
+VoxelSpan walkSphericalVolume(
+    const Ray &ray, const svr::SphericalVoxelGrid &grid, double t_begin,
+    double t_end, TraversalArena &arena,
+    TraversalDirection direction = FRONT_TO_BACK) noexcept;
+
+// Describes an orthographic image of width x height parallel rays, each with
+// unit direction 'direction'. The vectors horizontal and vertical span the
+// entire image plane, which is centered at image_center. The ray origin of
+// pixel (i, j) is then:
+// image_center + horizontal * ((i + 0.5) / width - 0.5)
+//              + vertical * ((j + 0.5) / height - 0.5)
+struct OrthographicImage {
+  BoundVec3 image_center;
+  FreeVec3 horizontal;
+  FreeVec3 vertical;
+  UnitVec3 direction;
+  std::size_t width;
+  std::size_t height;
+};
+
+// The modes in which an orthographic image may be traversed.
+enum ImageTraversalMode {
+  // Each pixel's ray is traversed independently.
+  TRAVERSE_ALL_RAYS = 0,
+
+  // Only one symmetry class of rays is traversed. The voxels of the remaining
+  // rays are derived by remapping the angular voxel indices of their mirror
+  // ray. This requires the grid to span the entire sphere. A mirror across the
+  // XZ plane through the sphere center is used when the image is symmetric
+  // about it, i.e. the rays travel parallel to the plane, the image is
+  // centered on it, and 'vertical' is its normal. Similarly, a mirror across
+  // the YZ plane is used with 'horizontal' as the normal; this additionally
+  // requires an even number of polar and azimuthal sections. If neither
+  // mirror applies, each ray is traversed as in TRAVERSE_ALL_RAYS. The mirrors
+  // of a ray whose traversal begins or ends on a voxel boundary, such as a ray
+  // within an angular boundary plane, or that is tangent to a radial boundary
+  // sphere are traversed rather than derived, so the voxels are those of
+  // TRAVERSE_ALL_RAYS.
+  EXPLOIT_MIRROR_SYMMETRY = 1
+};
+
+// Traverses the spherical voxel grid with each ray of the orthographic image.
+// Returns the voxels traversed per pixel, where pixel (i, j) is located at
+// index j * image.width + i. max_t is used as in walkSphericalVolume().
+std::vector<std::vector<SphericalVoxel>> walkOrthographicImage(
+    const OrthographicImage &image, const svr::SphericalVoxelGrid &grid,
+    double max_t, ImageTraversalMode mode = TRAVERSE_ALL_RAYS) noexcept;
+
+// The order in which the rays of a batch are traversed.
+enum RayOrdering {
+  // Rays are traversed in the order of the batch.
+  INPUT_ORDER = 0,
+
+  // Rays are traversed in the order given by coherentRayOrder().
+  COHERENT_ORDER = 1
+};
+
+// A pre-pass that returns the indices of the rays in the batch which may
+// traverse the grid, in increasing order. A ray is rejected if it misses the
+// sphere, if the sphere lies behind it, or, for sectored grids, if it misses
+// the bounding box of the sector. Rejected rays are guaranteed to traverse no
+// voxels. The tests avoid constructing each Ray and operate over the
+// structure-of-arrays layout of the batch so that they may be vectorized.
+std::vector<std::size_t> raysIntersectingGrid(
+    const RayBatch &rays, const svr::SphericalVoxelGrid &grid) noexcept;
+
+// Returns the indices of the rays in the batch sorted by a 63-bit key. From
+// most to least significant, the key consists of the direction octant, the
+// Morton code of the ray origin quantized within the bounding box of all
+// origins, and the Morton code of the quantized unit direction. Consecutive
+// rays in this order traverse similar voxels, which improves cache behavior
+// for incoherent batches such as random or secondary rays.
+std::vector<std::size_t> coherentRayOrder(const RayBatch &rays) noexcept;
+
+// Similar to above, but only sorts the rays at the given indices.
+std::vector<std::size_t> coherentRayOrder(
+    const RayBatch &rays,
+    const std::vector<std::size_t> &ray_indices) noexcept;
+
+// Traverses the rays of the batch at the given indices, in the order given.
+// The voxels traversed by ray i are stored at index i of the returned vector,
+// so results are always in the order of the batch. A ray whose index is not
+// in ray_indices has no voxels. max_t is used as in walkSphericalVolume().
+std::vector<std::vector<SphericalVoxel>> walkSphericalVolumeBatch(
+    const RayBatch &rays, const std::vector<std::size_t> &ray_indices,
+    const svr::SphericalVoxelGrid &grid, double max_t) noexcept;
+
+// Similar to above, but the traversals of several rays are interleaved: each
+// ray is advanced one voxel at a time in round-robin order with the other rays
+// in flight, and a ray that exits the grid is replaced by the next ray in
+// ray_indices. The traversal of a single ray is a chain of dependent square
+// roots, divisions, and comparisons; interleaving independent rays allows the
+// processor to overlap their latencies without requiring SIMD lanes to step in
+// lockstep. The result is identical to walkSphericalVolumeBatch().
+std::vector<std::vector<SphericalVoxel>> walkSphericalVolumeInterleaved(
+    const RayBatch &rays, const std::vector<std::size_t> &ray_indices,
+    const svr::SphericalVoxelGrid &grid, double max_t) noexcept;
+
+// Similar to above, but traverses every ray of the batch in the given order.
+// Rays rejected by raysIntersectingGrid() are not traversed.
+std::vector<std::vector<SphericalVoxel>> walkSphericalVolumeBatch(
+    const RayBatch &rays, const svr::SphericalVoxelGrid &grid, double max_t,
+    RayOrdering ordering = INPUT_ORDER) noexcept;
+
+// Similar to walkSphericalVolumeBatch(), but the voxels of each ray are
+// bump-allocated in the arena, in the order given, so the traversals of the
+// batch are contiguous in memory. The span of ray i is at index i of the
+// returned vector, and remains valid until the arena is reset.
+std::vector<VoxelSpan> walkSphericalVolumeBatch(
+    const RayBatch &rays, const std::vector<std::size_t> &ray_indices,
+    const svr::SphericalVoxelGrid &grid, double max_t,
+    TraversalArena &arena) noexcept;
+
+// Similar to above, but traverses every ray of the batch in the given order.
+// Rays rejected by raysIntersectingGrid() are not traversed.
+std::vector<VoxelSpan> walkSphericalVolumeBatch(
+    const RayBatch &rays, const svr::SphericalVoxelGrid &grid, double max_t,
+    TraversalArena &arena, RayOrdering ordering = INPUT_ORDER) noexcept;
+
+// The voxels of a batch of traversals in structure-of-arrays form, with one
+// column per attribute of SphericalVoxel. A consumer that scans a single
+// attribute, e.g. the enter and exit times to integrate, or the indices to
+// gather field values, then reads only contiguous memory, and each column maps
+// directly to a NumPy array. The voxels of ray i are the rows
+// [first[i], first[i] + count[i]). If the traversal is given a VoxelLayout,
+// the index column holds the index of each voxel within the layout, so a
+// consumer addresses field values without converting voxel indices; otherwise
+// the column is empty. Clearing the columns keeps their capacity,
+// so columns reused across batches stop allocating once they have grown.
+struct VoxelColumns {
+  std::vector<int> radial;
+  std::vector<int> polar;
+  std::vector<int> azimuthal;
+  std::vector<double> enter_t;
+  std::vector<double> exit_t;
+  std::vector<std::size_t> index;
+  std::vector<std::size_t> first;
+  std::vector<std::size_t> count;
+
+  // The number of rows, i.e. voxels.
+  inline std::size_t size() const noexcept { return radial.size(); }
+
+  inline void clear() noexcept {
+    radial.clear();
+    polar.clear();
+    azimuthal.clear();
+    enter_t.clear();
+    exit_t.clear();
+    index.clear();
+    first.clear();
+    count.clear();
+  }
+
+  inline void push_back(const SphericalVoxel &voxel) noexcept {
+    radial.push_back(voxel.radial);
+    polar.push_back(voxel.polar);
+    azimuthal.push_back(voxel.azimuthal);
+    enter_t.push_back(voxel.enter_t);
+    exit_t.push_back(voxel.exit_t);
+  }
+};
+
+// Similar to walkSphericalVolumeBatch(), but writes the voxels of the batch to
+// 'columns', which are first cleared. The rows of each ray are contiguous, and
+// the rays are traversed in the order given. If 'layout' is not nullptr, the
+// index column is filled with the index of each voxel within it.
+void walkSphericalVolumeBatch(const RayBatch &rays,
+                              const std::vector<std::size_t> &ray_indices,
+                              const svr::SphericalVoxelGrid &grid,
+                              double max_t, VoxelColumns &columns,
+                              const VoxelLayout *layout = nullptr) noexcept;
+
+// Similar to above, but traverses every ray of the batch in the given order.
+// Rays rejected by raysIntersectingGrid() are not traversed.
+void walkSphericalVolumeBatch(const RayBatch &rays,
+                              const svr::SphericalVoxelGrid &grid,
+                              double max_t, VoxelColumns &columns,
+                              RayOrdering ordering = INPUT_ORDER,
+                              const VoxelLayout *layout = nullptr) noexcept;
+
+// Simplified parameters to Cythonize the function; implementation remains the
+// same as above. The origin and direction of ray i are ray_origins[3 * i,
+// 3 * i + 3) and ray_directions[3 * i, 3 * i + 3).
+void walkSphericalVolumeBatch(
+    const double *ray_origins, const double *ray_directions,
+    std::size_t num_rays, double *min_bound, double *max_bound,
+    std::size_t num_radial_voxels, std::size_t num_polar_voxels,
+    std::size_t num_azimuthal_voxels, double *sphere_center, double max_t,
+    VoxelColumns &columns) noexcept;
+
+// Locates the voxel containing each of the given points, e.g. to bin
+// particles onto the grid. The coordinates of point i are points[3 * i],
+// points[3 * i + 1], and points[3 * i + 2]. Its radial, polar, and azimuthal
+// voxel indices are stored likewise in voxels[3 * i], voxels[3 * i + 1], and
+// voxels[3 * i + 2]. A point on a voxel boundary is located in the same voxel
+// as the voxel of a traversal with that point as the ray origin, i.e. the
+// outer radial voxel and the lower angular voxel. If a point lies outside the
+// grid, its voxel indices are all -1.
+void locatePoints(const double *points, std::size_t num_points,
+                  const svr::SphericalVoxelGrid &grid, int *voxels) noexcept;
+
+// Simplified parameters to Cythonize the function; implementation remains the
+// same as above.
+void locatePoints(const double *points, std::size_t num_points,
+                  double *min_bound, double *max_bound,
+                  std::size_t num_radial_voxels, std::size_t num_polar_voxels,
+                  std::size_t num_azimuthal_voxels, double *sphere_center,
+                  int *voxels) noexcept;
+
 }  // namespace svr
 
 #endif  // SPHERICAL_VOLUME_RENDERING_SPHERICALVOLUMERENDERINGUTIL_H
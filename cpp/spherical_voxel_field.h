@@ -0,0 +1,520 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_SPHERICALVOXELFIELD_H
+#define SPHERICAL_VOLUME_RENDERING_SPHERICALVOXELFIELD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "floating_point_comparison_util.h"
+#include "spherical_volume_rendering_util.h"
+#include "spherical_voxel_grid.h"
+#include "voxel_layout.h"
+
+namespace svr {
+
+// Stores in 'values' the four values of the container at the given indices.
+// Containers of reduced precision may overload this to decode the values
+// together.
+template <typename Values>
+inline void gatherValues(const Values &container, const std::size_t *indices,
+                         double *values) noexcept {
+  for (std::size_t i = 0; i < 4; ++i) values[i] = container[indices[i]];
+}
+
+// The eight voxels surrounding a position within a field, by index of the
+// field's values, and their interpolation weights. The interpolated value is
+// the weighted sum of the voxel values, plus center_weight times the value
+// at the sphere center.
+struct InterpolationStencil {
+  std::size_t indices[8];
+  double weights[8];
+  double center_weight;
+};
+
+// Prefetches the value of the container at the given index into the cache.
+// Containers without contiguous values may overload this, and otherwise
+// nothing is prefetched.
+template <typename Values>
+inline void prefetchValue(const Values &, std::size_t) noexcept {}
+
+template <typename T, typename Allocator>
+inline void prefetchValue(const std::vector<T, Allocator> &container,
+                          std::size_t index) noexcept {
+  __builtin_prefetch(container.data() + index);
+}
+
+// A scalar field over a spherical voxel grid, with one value per voxel. The
+// value of the voxel (radial, polar, azimuthal), where radial lies within
+// [1, numRadialSections()] as in SphericalVoxel, is stored at its index within
+// the field's VoxelLayout. By default, the layout is RADIAL_MAJOR, i.e. the
+// index is ((radial - 1) * numPolarSections() + polar) *
+// numAzimuthalSections() + azimuthal. The grid must outlive the field.
+//
+// The values are stored in a container of type Values, which provides
+// size() and an operator[] returning the value at an index as a double, e.g.
+// std::vector<double>. See reduced_precision_field.h for compact containers.
+template <typename Values>
+class BasicSphericalVoxelField {
+ public:
+  // The values must contain one value per voxel of the grid, laid out
+  // RADIAL_MAJOR.
+  BasicSphericalVoxelField(const SphericalVoxelGrid &grid,
+                           Values values) noexcept
+      : BasicSphericalVoxelField(grid, std::move(values), VoxelLayout(grid)) {}
+
+  // The values must contain layout.size() values, laid out as given. The
+  // layout must be of the grid's dimensions.
+  BasicSphericalVoxelField(const SphericalVoxelGrid &grid, Values values,
+                           VoxelLayout layout) noexcept
+      : grid_(&grid),
+        values_(std::move(values)),
+        layout_(std::move(layout)),
+        num_polar_sections_(grid.numPolarSections()),
+        num_azimuthal_sections_(grid.numAzimuthalSections()),
+        inverse_delta_radius_(1.0 / grid.deltaRadius()),
+        inverse_delta_theta_(1.0 / grid.deltaTheta()),
+        inverse_delta_phi_(1.0 / grid.deltaPhi()),
+        polar_wraps_(svr::isEqual(
+            grid.sphereMaxBoundPolar() - grid.sphereMinBoundPolar(), TAU)),
+        azimuthal_wraps_(svr::isEqual(
+            grid.sphereMaxBoundAzi() - grid.sphereMinBoundAzi(), TAU)),
+        center_value_(innermostShellMean()) {}
+
+  inline std::size_t index(int radial, int polar,
+                           int azimuthal) const noexcept {
+    return this->layout_.index(radial, polar, azimuthal);
+  }
+
+  inline double value(int radial, int polar, int azimuthal) const noexcept {
+    return this->values_[this->index(radial, polar, azimuthal)];
+  }
+
+  inline double value(const SphericalVoxel &voxel) const noexcept {
+    return this->value(voxel.radial, voxel.polar, voxel.azimuthal);
+  }
+
+  inline const Values &values() const noexcept {
+    return this->values_;
+  }
+
+  inline const SphericalVoxelGrid &grid() const noexcept {
+    return *this->grid_;
+  }
+
+  inline const VoxelLayout &layout() const noexcept { return this->layout_; }
+
+  // Whether the polar and azimuthal voxels span the entire circle, in which
+  // case the first and last voxels are neighbors.
+  inline bool polarWraps() const noexcept { return this->polar_wraps_; }
+
+  inline bool azimuthalWraps() const noexcept {
+    return this->azimuthal_wraps_;
+  }
+
+  // Prefetches the values with which the field is interpolated within the
+  // given voxel, i.e. those of the voxel and its radial, polar, and azimuthal
+  // neighbors. As in the stencil, the angular neighbors wrap around when the
+  // grid spans the entire circle. An azimuthal neighbor whose value is
+  // adjacent to the voxel's, as within a run of a RADIAL_MAJOR layout or a
+  // brick of a BRICKED layout, is assumed to share its cache line and is not
+  // prefetched separately.
+  inline void prefetch(const SphericalVoxel &voxel) const noexcept {
+    const int num_radial_sections =
+        static_cast<int>(grid_->numRadialSections());
+    const int num_polar_sections = static_cast<int>(num_polar_sections_);
+    const int num_azimuthal_sections =
+        static_cast<int>(num_azimuthal_sections_);
+    const std::size_t voxel_azimuthal_offset =
+        layout_.azimuthalOffset(voxel.azimuthal);
+    std::size_t azimuthal_offsets[3] = {voxel_azimuthal_offset};
+    std::size_t num_azimuthal_offsets = 1;
+    for (const int a : {voxel.azimuthal - 1, voxel.azimuthal + 1}) {
+      int azimuthal = a;
+      if (azimuthal_wraps_) {
+        azimuthal = (a + num_azimuthal_sections) % num_azimuthal_sections;
+      } else if (a < 0 || a >= num_azimuthal_sections) {
+        continue;
+      }
+      const std::size_t offset = layout_.azimuthalOffset(azimuthal);
+      const bool is_adjacent = offset + 1 == voxel_azimuthal_offset ||
+                               offset == voxel_azimuthal_offset + 1;
+      if (azimuthal == voxel.azimuthal || is_adjacent) continue;
+      azimuthal_offsets[num_azimuthal_offsets++] = offset;
+    }
+    for (int r = std::max(voxel.radial - 1, 1);
+         r <= voxel.radial + 1 && r <= num_radial_sections; ++r) {
+      const std::size_t radial_offset = layout_.radialOffset(r);
+      for (int p = voxel.polar - 1; p <= voxel.polar + 1; ++p) {
+        int polar = p;
+        if (polar_wraps_) {
+          polar = (p + num_polar_sections) % num_polar_sections;
+        } else if (p < 0 || p >= num_polar_sections) {
+          continue;
+        }
+        const std::size_t offset = radial_offset + layout_.polarOffset(polar);
+        for (std::size_t i = 0; i < num_azimuthal_offsets; ++i) {
+          prefetchValue(values_, offset + azimuthal_offsets[i]);
+        }
+      }
+    }
+  }
+
+  // Interpolates the field at the given spherical coordinates, which follow
+  // the conventions of VoxelSample. Each voxel value is located at the center
+  // of its voxel in (radius, polar, azimuthal), and the values of the eight
+  // voxel centers surrounding the coordinates are interpolated trilinearly.
+  // The angular neighbors wrap around when the grid spans the entire circle,
+  // and are otherwise clamped to the sector. Radially, values are clamped at
+  // the outermost voxel centers. Toward the sphere center, the innermost
+  // voxels are interpolated with the mean of the innermost shell, which is
+  // the value at the center, so the field is continuous there.
+  inline double interpolate(double radius, double polar,
+                            double azimuthal) const noexcept {
+    return this->interpolate(this->stencil(radius, polar, azimuthal));
+  }
+
+  // Returns the stencil with which the field is interpolated at the given
+  // spherical coordinates. The stencil depends only on the grid and the
+  // layout, so it may be shared by every field of the same grid and layout.
+  inline InterpolationStencil stencil(double radius, double polar,
+                                      double azimuthal) const noexcept {
+    const SphericalVoxelGrid &grid = *this->grid_;
+    const std::size_t num_radial_sections = grid.numRadialSections();
+    const Neighbors p = neighbors(
+        (polar - grid.sphereMinBoundPolar()) * inverse_delta_theta_,
+        num_polar_sections_, polar_wraps_);
+    const Neighbors a = neighbors(
+        (azimuthal - grid.sphereMinBoundAzi()) * inverse_delta_phi_,
+        num_azimuthal_sections_, azimuthal_wraps_);
+    const double radial_coordinate =
+        (grid.sphereMaxRadius() - radius) * inverse_delta_radius_;
+    const double innermost_center =
+        static_cast<double>(num_radial_sections) - 0.5;
+    InterpolationStencil stencil;
+    Neighbors r;
+    if (radial_coordinate >= innermost_center) {
+      // The sphere center lies half a voxel past the innermost voxel centers.
+      stencil.center_weight =
+          std::min((radial_coordinate - innermost_center) * 2.0, 1.0);
+      r = {.lower = num_radial_sections - 1,
+           .upper = num_radial_sections - 1,
+           .weight = 0.0};
+    } else {
+      stencil.center_weight = 0.0;
+      r = neighbors(radial_coordinate, num_radial_sections, /*wraps=*/false);
+    }
+    const std::size_t shells[2] = {r.lower, r.upper};
+    const double radial_weights[2] = {1.0 - r.weight - stencil.center_weight,
+                                      r.weight};
+    const double angular_weights[4] = {
+        (1.0 - p.weight) * (1.0 - a.weight), (1.0 - p.weight) * a.weight,
+        p.weight * (1.0 - a.weight), p.weight * a.weight};
+    const std::size_t a_lower =
+        layout_.azimuthalOffset(static_cast<int>(a.lower));
+    const std::size_t a_upper =
+        layout_.azimuthalOffset(static_cast<int>(a.upper));
+    for (std::size_t i = 0; i < 2; ++i) {
+      const std::size_t shell =
+          layout_.radialOffset(static_cast<int>(shells[i]) + 1);
+      const std::size_t lower =
+          shell + layout_.polarOffset(static_cast<int>(p.lower));
+      const std::size_t upper =
+          shell + layout_.polarOffset(static_cast<int>(p.upper));
+      std::size_t *indices = stencil.indices + 4 * i;
+      indices[0] = lower + a_lower;
+      indices[1] = lower + a_upper;
+      indices[2] = upper + a_lower;
+      indices[3] = upper + a_upper;
+      for (std::size_t j = 0; j < 4; ++j) {
+        stencil.weights[4 * i + j] = radial_weights[i] * angular_weights[j];
+      }
+    }
+    return stencil;
+  }
+
+  inline InterpolationStencil stencil(
+      const VoxelSample &sample) const noexcept {
+    return this->stencil(sample.radius, sample.polar, sample.azimuthal);
+  }
+
+  // Interpolates the field with the given stencil.
+  inline double interpolate(
+      const InterpolationStencil &stencil) const noexcept {
+    double corners[8];
+    gatherValues(values_, stencil.indices, corners);
+    gatherValues(values_, stencil.indices + 4, corners + 4);
+    double value = stencil.center_weight * center_value_;
+    for (std::size_t i = 0; i < 8; ++i) {
+      value += stencil.weights[i] * corners[i];
+    }
+    return value;
+  }
+
+  inline double interpolate(const VoxelSample &sample) const noexcept {
+    return this->interpolate(sample.radius, sample.polar, sample.azimuthal);
+  }
+
+  // Interpolates the field at each of the num_samples samples, and stores the
+  // results in 'values'.
+  inline void interpolate(const VoxelSample *samples, std::size_t num_samples,
+                          double *values) const noexcept {
+    for (std::size_t i = 0; i < num_samples; ++i) {
+      values[i] = this->interpolate(samples[i]);
+    }
+  }
+
+ private:
+  // The two voxel indices whose centers surround a coordinate along a single
+  // dimension, and the weight of the upper index.
+  struct Neighbors {
+    std::size_t lower;
+    std::size_t upper;
+    double weight;
+  };
+
+  // Returns the neighbors of the given coordinate, in units of voxels from
+  // the lower bound of the dimension. The center of voxel i is i + 0.5.
+  static inline Neighbors neighbors(double coordinate,
+                                    std::size_t num_sections,
+                                    bool wraps) noexcept {
+    const double x = coordinate - 0.5;
+    const double lower = std::floor(x);
+    const double weight = x - lower;
+    const double last = static_cast<double>(num_sections) - 1.0;
+    if (wraps) {
+      const double n = static_cast<double>(num_sections);
+      const double wrapped = lower - n * std::floor(lower / n);
+      const std::size_t i = static_cast<std::size_t>(std::min(wrapped, last));
+      return {.lower = i,
+              .upper = i + 1 == num_sections ? 0 : i + 1,
+              .weight = weight};
+    }
+    if (x <= 0.0) return {.lower = 0, .upper = 0, .weight = 0.0};
+    if (x >= last) {
+      const std::size_t i = num_sections - 1;
+      return {.lower = i, .upper = i, .weight = 0.0};
+    }
+    const std::size_t i = static_cast<std::size_t>(lower);
+    return {.lower = i, .upper = i + 1, .weight = weight};
+  }
+
+  // Returns the mean value of the innermost radial voxels.
+  inline double innermostShellMean() const noexcept {
+    const std::size_t shell_size =
+        num_polar_sections_ * num_azimuthal_sections_;
+    if (values_.size() < layout_.size() || shell_size == 0) return 0.0;
+    const int innermost = static_cast<int>(grid_->numRadialSections());
+    double sum = 0.0;
+    for (std::size_t p = 0; p < num_polar_sections_; ++p) {
+      for (std::size_t a = 0; a < num_azimuthal_sections_; ++a) {
+        sum += values_[this->index(innermost, static_cast<int>(p),
+                                   static_cast<int>(a))];
+      }
+    }
+    return sum / static_cast<double>(shell_size);
+  }
+
+  // The grid over which the field is defined.
+  const SphericalVoxelGrid *grid_;
+
+  // The value of each voxel, at its index within layout_.
+  Values values_;
+  VoxelLayout layout_;
+
+  std::size_t num_polar_sections_, num_azimuthal_sections_;
+
+  // The inverse of the grid's deltas, used to convert spherical coordinates
+  // to units of voxels.
+  double inverse_delta_radius_, inverse_delta_theta_, inverse_delta_phi_;
+
+  bool polar_wraps_, azimuthal_wraps_;
+
+  // The value of the field at the sphere center.
+  double center_value_;
+};
+
+using SphericalVoxelField = BasicSphericalVoxelField<std::vector<double>>;
+
+// Gathers the values of a field at the voxels of several traversals, e.g.
+// those of a tile of rays from walkSphericalVolumeBatch(). Gathering the
+// values in the order of each ray's path scatters accesses across a large
+// field. Instead, the plan buckets the voxels by blocks of BLOCK_SIZE
+// consecutive field values, so the values are gathered in memory order and
+// scattered back to their position along each path. The plan depends only on
+// the layout and the traversals, so it may be reused for every field of the
+// same grid and layout.
+class VoxelGatherPlan {
+ public:
+  // 512 doubles span 4 KiB.
+  static constexpr std::size_t BLOCK_SIZE = 512;
+
+  // Plans the gather from fields of the grid in the RADIAL_MAJOR layout.
+  VoxelGatherPlan(
+      const SphericalVoxelGrid &grid,
+      const std::vector<std::vector<SphericalVoxel>> &traversals) noexcept
+      : VoxelGatherPlan(VoxelLayout(grid), traversals) {}
+
+  // Plans the gather from fields in the given layout.
+  VoxelGatherPlan(
+      const VoxelLayout &layout,
+      const std::vector<std::vector<SphericalVoxel>> &traversals) noexcept
+      : offsets_(traversals.size() + 1, 0) {
+    for (std::size_t i = 0; i < traversals.size(); ++i) {
+      offsets_[i + 1] = offsets_[i] + traversals[i].size();
+    }
+    // A counting sort of the voxels by block.
+    std::vector<std::size_t> indices;
+    indices.reserve(offsets_.back());
+    std::vector<std::size_t> block_offsets(layout.size() / BLOCK_SIZE + 2, 0);
+    for (const std::vector<SphericalVoxel> &traversal : traversals) {
+      for (const SphericalVoxel &voxel : traversal) {
+        const std::size_t index =
+            layout.index(voxel.radial, voxel.polar, voxel.azimuthal);
+        indices.push_back(index);
+        ++block_offsets[index / BLOCK_SIZE + 1];
+      }
+    }
+    for (std::size_t b = 1; b < block_offsets.size(); ++b) {
+      block_offsets[b] += block_offsets[b - 1];
+    }
+    gathers_.resize(indices.size());
+    for (std::size_t position = 0; position < indices.size(); ++position) {
+      const std::size_t index = indices[position];
+      gathers_[block_offsets[index / BLOCK_SIZE]++] = {.index = index,
+                                                       .position = position};
+    }
+  }
+
+  // The number of voxels of all traversals.
+  inline std::size_t numVoxels() const noexcept {
+    return this->offsets_.back();
+  }
+
+  // The position of the first voxel of traversal i among all voxels, which
+  // are ordered by traversal and then along each path.
+  inline std::size_t offset(std::size_t i) const noexcept {
+    return this->offsets_[i];
+  }
+
+  // Gathers the value of each voxel from the field, which must be in the
+  // layout of the plan. The value of voxel j of traversal i is stored in
+  // values[offset(i) + j].
+  template <typename Values>
+  inline void gather(const BasicSphericalVoxelField<Values> &field,
+                     double *values) const noexcept {
+    const Values &field_values = field.values();
+    for (const Gather &gather : gathers_) {
+      values[gather.position] = field_values[gather.index];
+    }
+  }
+
+ private:
+  // A voxel, by its index within a field, and its position among all voxels.
+  struct Gather {
+    std::size_t index;
+    std::size_t position;
+  };
+
+  // offsets_[i] is the position of the first voxel of traversal i, and the
+  // last element is the number of voxels.
+  std::vector<std::size_t> offsets_;
+
+  // The voxels in order of their blocks.
+  std::vector<Gather> gathers_;
+};
+
+// A set of fields over the same grid, e.g. the density, temperature, and
+// velocity of a dataset, with the values of each field stored separately.
+// The set is sampled with a single traversal per ray, and each interpolation
+// stencil is computed once and applied to every field.
+template <typename Values>
+class BasicSphericalVoxelFieldSet {
+ public:
+  // Each of the channels holds the values of a field, as in
+  // BasicSphericalVoxelField.
+  BasicSphericalVoxelFieldSet(const SphericalVoxelGrid &grid,
+                              std::vector<Values> channels) noexcept
+      : BasicSphericalVoxelFieldSet(grid, std::move(channels),
+                                    VoxelLayout(grid)) {}
+
+  // Similar to above, but every channel is laid out in the given layout, so
+  // that a single stencil addresses every field.
+  BasicSphericalVoxelFieldSet(const SphericalVoxelGrid &grid,
+                              std::vector<Values> channels,
+                              const VoxelLayout &layout) noexcept {
+    fields_.reserve(channels.size());
+    for (Values &channel : channels) {
+      fields_.emplace_back(grid, std::move(channel), layout);
+    }
+  }
+
+  inline std::size_t numFields() const noexcept { return this->fields_.size(); }
+
+  inline const BasicSphericalVoxelField<Values> &field(
+      std::size_t i) const noexcept {
+    return this->fields_[i];
+  }
+
+  // Interpolates each field at the given sample, and stores the value of
+  // field i in values[i].
+  inline void interpolate(const VoxelSample &sample,
+                          double *values) const noexcept {
+    if (fields_.empty()) return;
+    const InterpolationStencil stencil = fields_.front().stencil(sample);
+    for (std::size_t i = 0; i < fields_.size(); ++i) {
+      values[i] = fields_[i].interpolate(stencil);
+    }
+  }
+
+  // Interpolates each field at each of the num_samples samples, and stores
+  // the value of field i at sample s in values[s * numFields() + i].
+  inline void interpolate(const VoxelSample *samples, std::size_t num_samples,
+                          double *values) const noexcept {
+    for (std::size_t s = 0; s < num_samples; ++s) {
+      this->interpolate(samples[s], values + s * fields_.size());
+    }
+  }
+
+  // Integrates each field along the window [t_begin, t_end] of the ray with
+  // a single traversal, and stores the integral of field i in integrals[i].
+  // The segment of the ray within each voxel is integrated with
+  // samples_per_voxel samples, placed as in sampleVoxel().
+  inline void integrate(const Ray &ray, double t_begin, double t_end,
+                        std::size_t samples_per_voxel,
+                        double *integrals) const noexcept {
+    std::fill(integrals, integrals + fields_.size(), 0.0);
+    if (fields_.empty() || samples_per_voxel == 0) return;
+    const SphericalVoxelGrid &grid = fields_.front().grid();
+    std::vector<VoxelSample> samples(samples_per_voxel);
+    std::vector<double> values(fields_.size());
+    TraversalCursor cursor(ray, grid, t_begin, t_end);
+    SphericalVoxel voxel;
+    while (cursor.next(voxel)) {
+      if (cursor.hasNext()) {
+        for (const BasicSphericalVoxelField<Values> &field : fields_) {
+          field.prefetch(cursor.upcoming());
+        }
+      }
+      sampleVoxel(ray, grid, voxel, samples_per_voxel, samples.data());
+      const double stratum_length = (voxel.exit_t - voxel.enter_t) /
+                                    static_cast<double>(samples_per_voxel);
+      for (const VoxelSample &sample : samples) {
+        this->interpolate(sample, values.data());
+        for (std::size_t i = 0; i < fields_.size(); ++i) {
+          integrals[i] += stratum_length * values[i];
+        }
+      }
+    }
+  }
+
+ private:
+  std::vector<BasicSphericalVoxelField<Values>> fields_;
+};
+
+using SphericalVoxelFieldSet = BasicSphericalVoxelFieldSet<std::vector<double>>;
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_SPHERICALVOXELFIELD_H
@@ -1,6 +1,8 @@
 #ifndef SPHERICAL_VOLUME_RENDERING_SPHERICALVOXELGRID_H
 #define SPHERICAL_VOLUME_RENDERING_SPHERICALVOXELGRID_H
 
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "vec3.h"
@@ -28,6 +30,41 @@ struct TrigonometricValues {
   double sine;
 };
 
+// A read-only view of the contiguous elements of a table, which does not own
+// them. A vector converts implicitly to a view of its elements.
+template <typename T>
+class TableView {
+ public:
+  using value_type = T;
+  using const_iterator = const T *;
+
+  TableView(const T *data, std::size_t size) noexcept
+      : data_(data), size_(size) {}
+
+  TableView(const std::vector<T> &elements) noexcept
+      : data_(elements.data()), size_(elements.size()) {}
+
+  inline const T &operator[](std::size_t i) const noexcept {
+    return this->data_[i];
+  }
+
+  inline const T *data() const noexcept { return this->data_; }
+
+  inline std::size_t size() const noexcept { return this->size_; }
+
+  inline const T *begin() const noexcept { return this->data_; }
+
+  inline const T *end() const noexcept { return this->data_ + this->size_; }
+
+  inline const T *cbegin() const noexcept { return this->begin(); }
+
+  inline const T *cend() const noexcept { return this->end(); }
+
+ private:
+  const T *data_;
+  std::size_t size_;
+};
+
 namespace {
 
 constexpr double TAU = 2 * M_PI;
@@ -84,9 +121,11 @@ std::vector<TrigonometricValues> initializeTrigonometricValues(
 //
 // The LineSegment points P1 and P2 are calculated with the following equation:
 // .P1 = max_radius * trig_value.cosine + center.x().
-// .P2 = max_radius * trig_value.sine + center.y().
+// .P2 = max_radius * trig_value.sine + center_2.
+// where center_2 is center.y() for polar voxels, and center.z() for azimuthal
+// voxels.
 std::vector<LineSegment> initializeMaxRadiusLineSegments(
-    const std::size_t num_voxels, const BoundVec3 &center,
+    const std::size_t num_voxels, const BoundVec3 &center, double center_2,
     const double max_radius,
     const std::vector<TrigonometricValues> &trig_values) {
   std::vector<LineSegment> line_segments(num_voxels + 1);
@@ -94,7 +133,7 @@ std::vector<LineSegment> initializeMaxRadiusLineSegments(
                  line_segments.begin(),
                  [&](const TrigonometricValues &trig_value) -> LineSegment {
                    return {.P1 = max_radius * trig_value.cosine + center.x(),
-                           .P2 = max_radius * trig_value.sine + center.y()};
+                           .P2 = max_radius * trig_value.sine + center_2};
                  });
   return line_segments;
 }
@@ -129,12 +168,32 @@ std::vector<BoundVec3> initializeCenterToAzimuthalPMaxVectors(
 
 }  // namespace
 
+// The tables that a grid computes once for its traversals. Each table holds
+// one element per voxel boundary, i.e. the number of radial, polar, or
+// azimuthal sections plus one. The tables point into 'storage', which keeps
+// them alive: the vectors of tables computed by a grid, or the mapping of a
+// grid file from which they are read in place. The tables are immutable, so
+// copies of a grid, and grids constructed with the same tables, share a single
+// reference-counted instance.
+struct SphericalVoxelGridTables {
+  const double *delta_radii_sq;
+  const TrigonometricValues *polar_trig_values, *azimuthal_trig_values;
+  const LineSegment *P_max_polar, *P_max_azimuthal;
+  const BoundVec3 *center_to_polar_bound_vectors,
+      *center_to_azimuthal_bound_vectors;
+  std::shared_ptr<const void> storage;
+};
+
 // Represents a spherical voxel grid used for ray casting. The bounds of the
 // grid are determined by min_bound and max_bound. The deltas are then
 // determined by (max_bound.X - min_bound.X) / num_X_sections. To minimize
 // calculation duplication, many calculations are completed once here and used
 // each time a ray traverses the spherical voxel grid.
 //
+// The tables of these calculations are shared between copies of the grid, so
+// a grid is cheap to copy, move, and assign, e.g. to store grids by value in a
+// container or to hand a grid to several owners.
+//
 // Note that the grid system currently does not align with one would expect
 // from spherical coordinates. We represent both polar and azimuthal within
 // bounds [0, 2pi].
@@ -146,6 +205,22 @@ struct SphericalVoxelGrid {
                      std::size_t num_polar_sections,
                      std::size_t num_azimuthal_sections,
                      const BoundVec3 &sphere_center)
+      : SphericalVoxelGrid(
+            min_bound, max_bound, num_radial_sections, num_polar_sections,
+            num_azimuthal_sections, sphere_center,
+            computeTables(min_bound, max_bound, num_radial_sections,
+                          num_polar_sections, num_azimuthal_sections,
+                          sphere_center)) {}
+
+  // Similar to above, but the tables are given rather than computed, e.g. the
+  // tables of another grid or of a grid read from a file. These must be the
+  // tables of a grid with the same bounds, sections, and sphere center.
+  SphericalVoxelGrid(const SphereBound &min_bound, const SphereBound &max_bound,
+                     std::size_t num_radial_sections,
+                     std::size_t num_polar_sections,
+                     std::size_t num_azimuthal_sections,
+                     const BoundVec3 &sphere_center,
+                     std::shared_ptr<const SphericalVoxelGridTables> tables)
       : num_radial_sections_(num_radial_sections),
         num_polar_sections_(num_polar_sections),
         num_azimuthal_sections_(num_azimuthal_sections),
@@ -157,32 +232,23 @@ struct SphericalVoxelGrid {
         // TODO(cgyurgyik): Verify we want the sphere_max_radius to simply be
         // max_bound.radial.
         sphere_max_radius_(max_bound.radial),
+        sphere_min_radius_(min_bound.radial),
         sphere_max_diameter_(sphere_max_radius_ * 2.0),
         delta_radius_((max_bound.radial - min_bound.radial) /
                       num_radial_sections),
         delta_theta_((max_bound.polar - min_bound.polar) / num_polar_sections),
         delta_phi_((max_bound.azimuthal - min_bound.azimuthal) /
                    num_azimuthal_sections),
-        // TODO(cgyurgyik): Verify this is actually what we want for
-        // 'max_radius'. The other option is simply using max_bound.radial
-        delta_radii_sq_(initializeDeltaRadiiSquared(
-            num_radial_sections,
-            /*max_radius=*/max_bound.radial - min_bound.radial, delta_radius_)),
-        polar_trig_values_(initializeTrigonometricValues(
-            num_polar_sections, min_bound.polar, delta_theta_)),
-        azimuthal_trig_values_(initializeTrigonometricValues(
-            num_azimuthal_sections, min_bound.azimuthal, delta_phi_)),
-        P_max_polar_(initializeMaxRadiusLineSegments(
-            num_polar_sections, sphere_center, sphere_max_radius_,
-            polar_trig_values_)),
-        P_max_azimuthal_(initializeMaxRadiusLineSegments(
-            num_azimuthal_sections, sphere_center, sphere_max_radius_,
-            azimuthal_trig_values_)),
+        tables_(std::move(tables)),
+        delta_radii_sq_(tables_->delta_radii_sq),
+        polar_trig_values_(tables_->polar_trig_values),
+        azimuthal_trig_values_(tables_->azimuthal_trig_values),
+        P_max_polar_(tables_->P_max_polar),
+        P_max_azimuthal_(tables_->P_max_azimuthal),
         center_to_polar_bound_vectors_(
-            initializeCenterToPolarPMaxVectors(P_max_polar_, sphere_center)),
+            tables_->center_to_polar_bound_vectors),
         center_to_azimuthal_bound_vectors_(
-            initializeCenterToAzimuthalPMaxVectors(P_max_azimuthal_,
-                                                   sphere_center)) {}
+            tables_->center_to_azimuthal_bound_vectors) {}
 
   inline std::size_t numRadialSections() const noexcept {
     return this->num_radial_sections_;
@@ -216,6 +282,12 @@ struct SphericalVoxelGrid {
     return this->sphere_max_radius_;
   }
 
+  // The minimum radial bound, which determines deltaRadius() with
+  // sphereMaxRadius().
+  inline double sphereMinRadius() const noexcept {
+    return this->sphere_min_radius_;
+  }
+
   inline double sphereMaxDiameter() const noexcept {
     return this->sphere_max_diameter_;
   }
@@ -238,8 +310,8 @@ struct SphericalVoxelGrid {
     return this->P_max_polar_[i];
   }
 
-  inline const std::vector<LineSegment> &pMaxPolar() const noexcept {
-    return this->P_max_polar_;
+  inline TableView<LineSegment> pMaxPolar() const noexcept {
+    return {this->P_max_polar_, this->num_polar_sections_ + 1};
   }
 
   inline const BoundVec3 &centerToPolarBound(std::size_t i) const noexcept {
@@ -250,70 +322,148 @@ struct SphericalVoxelGrid {
     return this->P_max_azimuthal_[i];
   }
 
-  inline const std::vector<LineSegment> &pMaxAzimuthal() const noexcept {
-    return this->P_max_azimuthal_;
+  inline TableView<LineSegment> pMaxAzimuthal() const noexcept {
+    return {this->P_max_azimuthal_, this->num_azimuthal_sections_ + 1};
   }
 
   inline const BoundVec3 &centerToAzimuthalBound(std::size_t i) const noexcept {
     return this->center_to_azimuthal_bound_vectors_[i];
   }
 
-  inline const std::vector<TrigonometricValues> &polarTrigValues()
-      const noexcept {
-    return polar_trig_values_;
+  inline TableView<TrigonometricValues> polarTrigValues() const noexcept {
+    return {this->polar_trig_values_, this->num_polar_sections_ + 1};
+  }
+
+  inline TableView<TrigonometricValues> azimuthalTrigValues() const noexcept {
+    return {this->azimuthal_trig_values_, this->num_azimuthal_sections_ + 1};
+  }
+
+  inline TableView<double> deltaRadiiSquared() const noexcept {
+    return {this->delta_radii_sq_, this->num_radial_sections_ + 1};
+  }
+
+  inline TableView<BoundVec3> centerToPolarBounds() const noexcept {
+    return {this->center_to_polar_bound_vectors_,
+            this->num_polar_sections_ + 1};
+  }
+
+  inline TableView<BoundVec3> centerToAzimuthalBounds() const noexcept {
+    return {this->center_to_azimuthal_bound_vectors_,
+            this->num_azimuthal_sections_ + 1};
   }
 
-  inline const std::vector<TrigonometricValues> &azimuthalTrigValues()
+  // The tables of the grid, which may be shared with other grids.
+  inline const std::shared_ptr<const SphericalVoxelGridTables> &tables()
       const noexcept {
-    return azimuthal_trig_values_;
+    return this->tables_;
   }
 
  private:
+  // The storage of the tables computed by a grid.
+  struct ComputedTables {
+    std::vector<double> delta_radii_sq;
+    std::vector<TrigonometricValues> polar_trig_values, azimuthal_trig_values;
+    std::vector<LineSegment> P_max_polar, P_max_azimuthal;
+    std::vector<BoundVec3> center_to_polar_bound_vectors,
+        center_to_azimuthal_bound_vectors;
+  };
+
+  // Computes the tables of a grid with the given bounds, sections, and sphere
+  // center.
+  static std::shared_ptr<const SphericalVoxelGridTables> computeTables(
+      const SphereBound &min_bound, const SphereBound &max_bound,
+      std::size_t num_radial_sections, std::size_t num_polar_sections,
+      std::size_t num_azimuthal_sections, const BoundVec3 &sphere_center) {
+    const double delta_radius =
+        (max_bound.radial - min_bound.radial) / num_radial_sections;
+    const double delta_theta =
+        (max_bound.polar - min_bound.polar) / num_polar_sections;
+    const double delta_phi =
+        (max_bound.azimuthal - min_bound.azimuthal) / num_azimuthal_sections;
+    const std::shared_ptr<ComputedTables> storage =
+        std::make_shared<ComputedTables>();
+    ComputedTables &tables = *storage;
+    // TODO(cgyurgyik): Verify this is actually what we want for
+    // 'max_radius'. The other option is simply using max_bound.radial
+    tables.delta_radii_sq = initializeDeltaRadiiSquared(
+        num_radial_sections,
+        /*max_radius=*/max_bound.radial - min_bound.radial, delta_radius);
+    tables.polar_trig_values = initializeTrigonometricValues(
+        num_polar_sections, min_bound.polar, delta_theta);
+    tables.azimuthal_trig_values = initializeTrigonometricValues(
+        num_azimuthal_sections, min_bound.azimuthal, delta_phi);
+    tables.P_max_polar = initializeMaxRadiusLineSegments(
+        num_polar_sections, sphere_center, sphere_center.y(), max_bound.radial,
+        tables.polar_trig_values);
+    tables.P_max_azimuthal = initializeMaxRadiusLineSegments(
+        num_azimuthal_sections, sphere_center, sphere_center.z(),
+        max_bound.radial, tables.azimuthal_trig_values);
+    tables.center_to_polar_bound_vectors =
+        initializeCenterToPolarPMaxVectors(tables.P_max_polar, sphere_center);
+    tables.center_to_azimuthal_bound_vectors =
+        initializeCenterToAzimuthalPMaxVectors(tables.P_max_azimuthal,
+                                               sphere_center);
+    return std::make_shared<const SphericalVoxelGridTables>(
+        SphericalVoxelGridTables{
+            .delta_radii_sq = tables.delta_radii_sq.data(),
+            .polar_trig_values = tables.polar_trig_values.data(),
+            .azimuthal_trig_values = tables.azimuthal_trig_values.data(),
+            .P_max_polar = tables.P_max_polar.data(),
+            .P_max_azimuthal = tables.P_max_azimuthal.data(),
+            .center_to_polar_bound_vectors =
+                tables.center_to_polar_bound_vectors.data(),
+            .center_to_azimuthal_bound_vectors =
+                tables.center_to_azimuthal_bound_vectors.data(),
+            .storage = storage});
+  }
+
   // The number of radial, polar, and azimuthal voxels.
-  const std::size_t num_radial_sections_, num_polar_sections_,
+  std::size_t num_radial_sections_, num_polar_sections_,
       num_azimuthal_sections_;
 
   // The center of the sphere.
-  const BoundVec3 sphere_center_;
+  BoundVec3 sphere_center_;
 
   // The maximum polar bound of the sphere.
-  const double sphere_max_bound_polar_;
+  double sphere_max_bound_polar_;
 
   // The minimum polar bound of the sphere.
-  const double sphere_min_bound_polar_;
+  double sphere_min_bound_polar_;
 
   // The maximum azimuthal bound of the sphere.
-  const double sphere_max_bound_azimuthal_;
+  double sphere_max_bound_azimuthal_;
 
   // The minimum azimuthal bound of the sphere.
-  const double sphere_min_bound_azimuthal_;
+  double sphere_min_bound_azimuthal_;
 
   // The maximum radius of the sphere.
-  const double sphere_max_radius_;
+  double sphere_max_radius_;
+
+  // The minimum radial bound of the sphere.
+  double sphere_min_radius_;
 
   // The maximum diamater of the sphere.
-  const double sphere_max_diameter_;
+  double sphere_max_diameter_;
 
   // The maximum sphere radius divided by the number of radial sections.
-  const double delta_radius_;
+  double delta_radius_;
 
   // 2 * PI divided by X, where X is the number of polar and number of azimuthal
   // sections respectively.
-  const double delta_theta_, delta_phi_;
-
-  // The delta radii squared calculated for use in radial hit calculations.
-  const std::vector<double> delta_radii_sq_;
-
-  // The trigonometric values calculated for the azimuthal and polar voxels.
-  const std::vector<TrigonometricValues> azimuthal_trig_values_,
-      polar_trig_values_;
-
-  // The maximum radius line segments for polar and azimuthal voxels.
-  const std::vector<LineSegment> P_max_polar_, P_max_azimuthal_;
-
-  // The vectors represented by the vector sphere center - P_max[i].
-  const std::vector<BoundVec3> center_to_polar_bound_vectors_,
-      center_to_azimuthal_bound_vectors_;
+  double delta_theta_, delta_phi_;
+
+  // The delta radii squared, the trigonometric values, the maximum radius line
+  // segments, and the vectors sphere center - P_max[i] of the polar and
+  // azimuthal voxels.
+  std::shared_ptr<const SphericalVoxelGridTables> tables_;
+
+  // The tables, within tables_. These are cached so that a traversal step
+  // reads an element with a single indirection.
+  const double *delta_radii_sq_;
+  const TrigonometricValues *polar_trig_values_, *azimuthal_trig_values_;
+  const LineSegment *P_max_polar_, *P_max_azimuthal_;
+  const BoundVec3 *center_to_polar_bound_vectors_,
+      *center_to_azimuthal_bound_vectors_;
 };
 
 }  // namespace svr
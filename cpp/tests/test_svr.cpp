@@ -1,6 +1,19 @@
 #include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <set>
+#include <thread>
 
+#include "../gradient_field.h"
+#include "../grid_file.h"
+#include "../huge_page_allocator.h"
+#include "../reduced_precision_field.h"
+#include "../sparse_field.h"
 #include "../spherical_volume_rendering_util.h"
+#include "../spherical_voxel_field.h"
+#include "../transfer_function.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -48,6 +61,25 @@ void verifyEqualVoxels(const std::vector<svr::SphericalVoxel> &actual_voxels,
   EXPECT_THAT(phi_voxels, testing::ContainerEq(expected_phi_voxels));
 }
 
+// Determines equality amongst the voxels traversed per pixel of two images.
+void verifyEqualImages(
+    const std::vector<std::vector<svr::SphericalVoxel>> &actual_pixels,
+    const std::vector<std::vector<svr::SphericalVoxel>> &expected_pixels) {
+  ASSERT_EQ(actual_pixels.size(), expected_pixels.size());
+  for (std::size_t i = 0; i < actual_pixels.size(); ++i) {
+    ASSERT_EQ(actual_pixels[i].size(), expected_pixels[i].size());
+    for (std::size_t j = 0; j < actual_pixels[i].size(); ++j) {
+      const auto &actual = actual_pixels[i][j];
+      const auto &expected = expected_pixels[i][j];
+      EXPECT_EQ(actual.radial, expected.radial);
+      EXPECT_EQ(actual.polar, expected.polar);
+      EXPECT_EQ(actual.azimuthal, expected.azimuthal);
+      EXPECT_NEAR(actual.enter_t, expected.enter_t, 1e-6);
+      EXPECT_NEAR(actual.exit_t, expected.exit_t, 1e-6);
+    }
+  }
+}
+
 TEST(SphericalCoordinateTraversal, RayDoesNotEnterSphere) {
   const BoundVec3 sphere_center(15.0, 15.0, 15.0);
   const double sphere_max_radius = 10.0;
@@ -326,6 +358,38 @@ TEST(SphericalCoordinateTraversal, SphereNotCenteredAtOrigin) {
                     expected_theta_voxels, expected_phi_voxels);
 }
 
+TEST(SphericalCoordinateTraversal, SphereCenterWithDistinctYAndZ) {
+  // The azimuthal voxel boundaries lie in the XZ plane, so they are offset by
+  // the z coordinate of the sphere center rather than its y coordinate.
+  const BoundVec3 sphere_center(1.0, -2.0, 3.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 6, 8,
+                                     sphere_center);
+  const svr::SphericalVoxelGrid centered_grid(MIN_BOUND, max_bound, 4, 6, 8,
+                                              BoundVec3(0.0, 0.0, 0.0));
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> target(-5.0, 5.0);
+  std::vector<std::vector<svr::SphericalVoxel>> actual, expected;
+  for (std::size_t i = 0; i < 100; ++i) {
+    const FreeVec3 offset(origin(generator), origin(generator),
+                          origin(generator));
+    const FreeVec3 direction =
+        FreeVec3(target(generator), target(generator), target(generator)) -
+        offset;
+    const UnitVec3 unit_direction(direction.x(), direction.y(),
+                                  direction.z());
+    actual.push_back(walkSphericalVolume(
+        Ray(sphere_center + offset, unit_direction), grid, /*max_t=*/1.0));
+    expected.push_back(walkSphericalVolume(
+        Ray(BoundVec3(offset.x(), offset.y(), offset.z()), unit_direction),
+        centered_grid, /*max_t=*/1.0));
+  }
+  verifyEqualImages(actual, expected);
+}
+
 TEST(SphericalCoordinateTraversal, RaySlightOffsetInXYPlane) {
   const BoundVec3 sphere_center(0.0, 0.0, 0.0);
   const double sphere_max_radius = 10.0;
@@ -1129,4 +1193,2163 @@ TEST(SphericalCoordinateTraversal, FirstQuadrantMiss) {
   };
 }
 
+TEST(OrthographicImage, PixelsAreTraversedInRowMajorOrder) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  const svr::OrthographicImage image = {
+      .image_center = BoundVec3(0.0, 0.0, -15.0),
+      .horizontal = FreeVec3(16.0, 0.0, 0.0),
+      .vertical = FreeVec3(0.0, 12.0, 0.0),
+      .direction = UnitVec3(0.0, 0.0, 1.0),
+      .width = 4,
+      .height = 3};
+  const auto pixels = svr::walkOrthographicImage(image, grid, /*max_t=*/1.0);
+  ASSERT_EQ(pixels.size(), 12);
+  // Pixel (3, 1) has its ray origin at {6.0, 0.0, -15.0}.
+  const auto expected_voxels = walkSphericalVolume(
+      Ray(BoundVec3(6.0, 0.0, -15.0), UnitVec3(0.0, 0.0, 1.0)), grid,
+      /*max_t=*/1.0);
+  verifyEqualImages({pixels[1 * 4 + 3]}, {expected_voxels});
+}
+
+TEST(OrthographicImage, MirrorSymmetryMatchesTraversingAllRays) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10e4;
+  const std::size_t num_sections = 16;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, num_sections,
+                                     num_sections, num_sections, sphere_center);
+  // The pixel spacing is chosen such that no ray lies on a voxel boundary.
+  const svr::OrthographicImage image = {
+      .image_center = BoundVec3(0.0, 0.0, -(sphere_max_radius + 1.0)),
+      .horizontal = FreeVec3(2000.0, 0.0, 0.0),
+      .vertical = FreeVec3(0.0, 1300.0, 0.0),
+      .direction = UnitVec3(0.0, 0.0, 1.0),
+      .width = 32,
+      .height = 20};
+  verifyEqualImages(
+      svr::walkOrthographicImage(image, grid, /*max_t=*/1.0,
+                                 svr::EXPLOIT_MIRROR_SYMMETRY),
+      svr::walkOrthographicImage(image, grid, /*max_t=*/1.0,
+                                 svr::TRAVERSE_ALL_RAYS));
+}
+
+TEST(OrthographicImage, MirrorSymmetryWithOddImageDimensions) {
+  const BoundVec3 sphere_center(1.0, -2.0, 3.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 8, 4,
+                                     sphere_center);
+  const svr::OrthographicImage image = {
+      .image_center = BoundVec3(1.0, -2.0, 15.0),
+      .horizontal = FreeVec3(13.0, 0.0, 0.0),
+      .vertical = FreeVec3(0.0, 11.0, 0.0),
+      .direction = UnitVec3(0.0, 0.0, -1.0),
+      .width = 7,
+      .height = 9};
+  verifyEqualImages(
+      svr::walkOrthographicImage(image, grid, /*max_t=*/0.8,
+                                 svr::EXPLOIT_MIRROR_SYMMETRY),
+      svr::walkOrthographicImage(image, grid, /*max_t=*/0.8,
+                                 svr::TRAVERSE_ALL_RAYS));
+}
+
+TEST(OrthographicImage, MirrorSymmetryWithRaysOnVoxelBoundaries) {
+  const BoundVec3 sphere_center(1.0, -2.0, 3.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 8, 8,
+                                     sphere_center);
+  // The image is centered on the sphere with equal pixel spacing, so the rays
+  // of its center row, center column, and diagonals lie on polar voxel
+  // boundary planes, and others begin or end on voxel boundaries.
+  const svr::OrthographicImage image = {
+      .image_center = BoundVec3(1.0, -2.0, -15.0),
+      .horizontal = FreeVec3(18.0, 0.0, 0.0),
+      .vertical = FreeVec3(0.0, 18.0, 0.0),
+      .direction = UnitVec3(0.0, 0.0, 1.0),
+      .width = 9,
+      .height = 9};
+  for (const double max_t : {1.0, 0.8}) {
+    verifyEqualImages(
+        svr::walkOrthographicImage(image, grid, max_t,
+                                   svr::EXPLOIT_MIRROR_SYMMETRY),
+        svr::walkOrthographicImage(image, grid, max_t,
+                                   svr::TRAVERSE_ALL_RAYS));
+  }
+}
+
+TEST(OrthographicImage, MirrorSymmetryIgnoredForSectoredGrid) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = M_PI, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  const svr::OrthographicImage image = {
+      .image_center = BoundVec3(0.0, 0.0, -15.0),
+      .horizontal = FreeVec3(13.0, 0.0, 0.0),
+      .vertical = FreeVec3(0.0, 11.0, 0.0),
+      .direction = UnitVec3(0.0, 0.0, 1.0),
+      .width = 6,
+      .height = 6};
+  verifyEqualImages(
+      svr::walkOrthographicImage(image, grid, /*max_t=*/1.0,
+                                 svr::EXPLOIT_MIRROR_SYMMETRY),
+      svr::walkOrthographicImage(image, grid, /*max_t=*/1.0,
+                                 svr::TRAVERSE_ALL_RAYS));
+}
+
+TEST(RayBatch, CoherentRayOrderIsPermutationGroupedByOctant) {
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> distribution(-20.0, 20.0);
+  RayBatch rays;
+  for (std::size_t i = 0; i < 500; ++i) {
+    rays.push_back(BoundVec3(distribution(generator), distribution(generator),
+                             distribution(generator)),
+                   FreeVec3(distribution(generator), distribution(generator),
+                            distribution(generator)));
+  }
+  const auto ray_indices = svr::coherentRayOrder(rays);
+  std::vector<std::size_t> sorted_indices(ray_indices);
+  std::sort(sorted_indices.begin(), sorted_indices.end());
+  std::vector<std::size_t> expected_indices(rays.size());
+  std::iota(expected_indices.begin(), expected_indices.end(), 0);
+  EXPECT_THAT(sorted_indices, testing::ContainerEq(expected_indices));
+
+  const auto octant = [&rays](std::size_t i) -> int {
+    return (rays.direction(i).x() < 0.0) | (rays.direction(i).y() < 0.0) << 1 |
+           (rays.direction(i).z() < 0.0) << 2;
+  };
+  EXPECT_TRUE(std::is_sorted(ray_indices.cbegin(), ray_indices.cend(),
+                             [&](std::size_t a, std::size_t b) {
+                               return octant(a) < octant(b);
+                             }));
+}
+
+TEST(RayBatch, CoherentOrderMatchesInputOrder) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> distribution(-15.0, 15.0);
+  RayBatch rays;
+  for (std::size_t i = 0; i < 200; ++i) {
+    rays.push_back(BoundVec3(distribution(generator), distribution(generator),
+                             distribution(generator)),
+                   FreeVec3(distribution(generator), distribution(generator),
+                            distribution(generator)));
+  }
+  const auto input_order_voxels = svr::walkSphericalVolumeBatch(
+      rays, grid, /*max_t=*/1.0, svr::INPUT_ORDER);
+  const auto coherent_order_voxels = svr::walkSphericalVolumeBatch(
+      rays, grid, /*max_t=*/1.0, svr::COHERENT_ORDER);
+  verifyEqualImages(coherent_order_voxels, input_order_voxels);
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    verifyEqualImages({input_order_voxels[i]},
+                      {walkSphericalVolume(rays.ray(i), grid, /*max_t=*/1.0)});
+  }
+}
+
+TEST(RayBatch, RaysIntersectingGridRejectsOnlyMisses) {
+  const BoundVec3 sphere_center(1.0, 2.0, -1.0);
+  const double sphere_max_radius = 10.0;
+  const std::vector<svr::SphereBound> max_bounds = {
+      {.radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU},
+      {.radial = sphere_max_radius, .polar = M_PI, .azimuthal = TAU},
+      {.radial = sphere_max_radius, .polar = M_PI / 2.0,
+       .azimuthal = M_PI / 2.0}};
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<double> distribution(-30.0, 30.0);
+  RayBatch rays;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    rays.push_back(BoundVec3(distribution(generator), distribution(generator),
+                             distribution(generator)),
+                   FreeVec3(distribution(generator), distribution(generator),
+                            distribution(generator)));
+  }
+  for (const auto &max_bound : max_bounds) {
+    const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                       sphere_center);
+    const auto ray_indices = svr::raysIntersectingGrid(rays, grid);
+    EXPECT_TRUE(std::is_sorted(ray_indices.cbegin(), ray_indices.cend()));
+    EXPECT_LT(ray_indices.size(), rays.size());
+    std::vector<bool> is_kept(rays.size(), false);
+    for (const std::size_t i : ray_indices) is_kept[i] = true;
+    std::size_t num_hits = 0;
+    for (std::size_t i = 0; i < rays.size(); ++i) {
+      const auto voxels =
+          walkSphericalVolume(rays.ray(i), grid, /*max_t=*/1.0);
+      if (!voxels.empty()) {
+        ++num_hits;
+        EXPECT_TRUE(is_kept[i]);
+      }
+    }
+    EXPECT_GT(num_hits, 0);
+  }
+}
+
+TEST(RayBatch, BatchTraversalSkipsRejectedRays) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  RayBatch rays;
+  rays.push_back(BoundVec3(-13.0, -13.0, -13.0), FreeVec3(1.0, 1.0, 1.0));
+  // The sphere lies behind this ray.
+  rays.push_back(BoundVec3(-13.0, -13.0, -13.0), FreeVec3(-1.0, -1.0, -1.0));
+  // This ray misses the sphere.
+  rays.push_back(BoundVec3(15.0, 15.0, 15.0), FreeVec3(0.0, 0.0, 1.0));
+  rays.push_back(BoundVec3(-3.0, 4.0, 5.0), FreeVec3(1.0, -1.0, -1.0));
+  const auto ray_indices = svr::raysIntersectingGrid(rays, grid);
+  EXPECT_THAT(ray_indices, testing::ElementsAre(0, 3));
+  const auto voxels = svr::walkSphericalVolumeBatch(rays, grid, /*max_t=*/1.0);
+  ASSERT_EQ(voxels.size(), 4);
+  EXPECT_EQ(voxels[0].size(), 8);
+  EXPECT_EQ(voxels[1].size(), 0);
+  EXPECT_EQ(voxels[2].size(), 0);
+  EXPECT_EQ(voxels[3].size(), 9);
+}
+
+TEST(RayBatch, InterleavedTraversalMatchesBatchTraversal) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  RayBatch rays;
+  for (std::size_t i = 0; i < 100; ++i) {
+    rays.push_back(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        FreeVec3(direction(generator), direction(generator),
+                 direction(generator)));
+  }
+  // Every other ray, in reverse order, so that some rays are never traversed.
+  std::vector<std::size_t> ray_indices;
+  for (std::size_t i = rays.size(); i >= 2; i -= 2) {
+    ray_indices.push_back(i - 1);
+  }
+  for (const double max_t : {0.5, 1.0}) {
+    const auto expected =
+        svr::walkSphericalVolumeBatch(rays, ray_indices, grid, max_t);
+    const auto actual =
+        svr::walkSphericalVolumeInterleaved(rays, ray_indices, grid, max_t);
+    verifyEqualImages(actual, expected);
+  }
+}
+
+TEST(RayBatch, ArenaTraversalMatchesBatchTraversal) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  RayBatch rays;
+  for (std::size_t i = 0; i < 100; ++i) {
+    rays.push_back(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        FreeVec3(direction(generator), direction(generator),
+                 direction(generator)));
+  }
+  // The arena is too small for a single ray, so spans are moved as it grows.
+  svr::TraversalArena arena(4);
+  for (const double max_t : {1.0, 0.5}) {
+    const auto expected = svr::walkSphericalVolumeBatch(rays, grid, max_t);
+    arena.reset();
+    const std::vector<svr::VoxelSpan> spans =
+        svr::walkSphericalVolumeBatch(rays, grid, max_t, arena);
+    ASSERT_EQ(spans.size(), rays.size());
+    std::vector<std::vector<svr::SphericalVoxel>> actual;
+    std::size_t num_voxels = 0;
+    for (const svr::VoxelSpan &span : spans) {
+      actual.emplace_back(span.begin(), span.end());
+      num_voxels += span.size;
+    }
+    verifyEqualImages(actual, expected);
+    EXPECT_EQ(arena.size(), num_voxels);
+  }
+  // After a reset, the arena holds a batch in a single block, so the spans
+  // are contiguous.
+  const std::size_t capacity = arena.capacity();
+  arena.reset();
+  EXPECT_EQ(arena.capacity(), capacity);
+  const std::vector<svr::VoxelSpan> spans =
+      svr::walkSphericalVolumeBatch(rays, grid, 0.5, arena);
+  EXPECT_EQ(arena.capacity(), capacity);
+  const svr::SphericalVoxel *next = nullptr;
+  for (const svr::VoxelSpan &span : spans) {
+    if (span.empty()) continue;
+    if (next != nullptr) {
+      EXPECT_EQ(span.data, next);
+    }
+    next = span.end();
+  }
+  // A single ray, windowed.
+  const svr::VoxelSpan span =
+      svr::walkSphericalVolume(rays.ray(0), grid, 2.0, 20.0, arena);
+  verifyEqualImages(
+      {std::vector<svr::SphericalVoxel>(span.begin(), span.end())},
+      {svr::walkSphericalVolume(rays.ray(0), grid, 2.0, 20.0)});
+}
+
+TEST(RayBatch, ColumnTraversalMatchesBatchTraversal) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  RayBatch rays;
+  for (std::size_t i = 0; i < 100; ++i) {
+    rays.push_back(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        FreeVec3(direction(generator), direction(generator),
+                 direction(generator)));
+  }
+  svr::VoxelColumns columns;
+  for (const svr::RayOrdering ordering :
+       {svr::INPUT_ORDER, svr::COHERENT_ORDER}) {
+    const auto expected = svr::walkSphericalVolumeBatch(rays, grid, 1.0);
+    svr::walkSphericalVolumeBatch(rays, grid, 1.0, columns, ordering);
+    ASSERT_EQ(columns.first.size(), rays.size());
+    ASSERT_EQ(columns.count.size(), rays.size());
+    ASSERT_EQ(columns.polar.size(), columns.size());
+    ASSERT_EQ(columns.azimuthal.size(), columns.size());
+    ASSERT_EQ(columns.enter_t.size(), columns.size());
+    ASSERT_EQ(columns.exit_t.size(), columns.size());
+    std::vector<std::vector<svr::SphericalVoxel>> actual(rays.size());
+    std::size_t num_voxels = 0;
+    for (std::size_t i = 0; i < rays.size(); ++i) {
+      for (std::size_t row = columns.first[i];
+           row < columns.first[i] + columns.count[i]; ++row) {
+        actual[i].push_back({.radial = columns.radial[row],
+                             .polar = columns.polar[row],
+                             .azimuthal = columns.azimuthal[row],
+                             .enter_t = columns.enter_t[row],
+                             .exit_t = columns.exit_t[row]});
+      }
+      num_voxels += columns.count[i];
+    }
+    EXPECT_EQ(num_voxels, columns.size());
+    verifyEqualImages(actual, expected);
+  }
+}
+
+// Verifies that the voxels traversed over each window of times, concatenated,
+// are the voxels traversed over the full window. A voxel split across two
+// windows appears at the end of the first and the beginning of the second.
+void verifyWindowsConcatenate(const Ray &ray,
+                              const svr::SphericalVoxelGrid &grid,
+                              const std::vector<double> &window_times) {
+  const auto expected = svr::walkSphericalVolume(
+      ray, grid, window_times.front(), window_times.back());
+  std::vector<svr::SphericalVoxel> actual;
+  for (std::size_t i = 1; i < window_times.size(); ++i) {
+    const auto voxels = svr::walkSphericalVolume(ray, grid, window_times[i - 1],
+                                                 window_times[i]);
+    for (const auto &voxel : voxels) {
+      if (!actual.empty() && actual.back().radial == voxel.radial &&
+          actual.back().polar == voxel.polar &&
+          actual.back().azimuthal == voxel.azimuthal) {
+        EXPECT_DOUBLE_EQ(actual.back().exit_t, voxel.enter_t);
+        actual.back().exit_t = voxel.exit_t;
+        continue;
+      }
+      actual.push_back(voxel);
+    }
+  }
+  ASSERT_EQ(actual.size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(actual[i].radial, expected[i].radial);
+    EXPECT_EQ(actual[i].polar, expected[i].polar);
+    EXPECT_EQ(actual[i].azimuthal, expected[i].azimuthal);
+    EXPECT_NEAR(actual[i].enter_t, expected[i].enter_t, 1e-6);
+    EXPECT_NEAR(actual[i].exit_t, expected[i].exit_t, 1e-6);
+  }
+}
+
+TEST(WindowedTraversal, ReadmeExample) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  const Ray ray(BoundVec3(-13.0, -13.0, -13.0), UnitVec3(1.0, 1.0, 1.0));
+  const auto voxels =
+      svr::walkSphericalVolume(ray, grid, /*t_begin=*/0.0, /*t_end=*/40.0);
+  const std::vector<int> expected_radial_voxels = {1, 2, 3, 4, 4, 3, 2, 1};
+  const std::vector<int> expected_theta_voxels = {2, 2, 2, 2, 0, 0, 0, 0};
+  const std::vector<int> expected_phi_voxels = {2, 2, 2, 2, 0, 0, 0, 0};
+  verifyEqualVoxels(voxels, expected_radial_voxels, expected_theta_voxels,
+                    expected_phi_voxels);
+  // The ray enters the sphere at sqrt(3) * 13 - 10 and exits it 20 later.
+  const double t_entrance = std::sqrt(3.0) * 13.0 - 10.0;
+  EXPECT_DOUBLE_EQ(voxels.front().enter_t, t_entrance);
+  EXPECT_DOUBLE_EQ(voxels.back().exit_t, t_entrance + 20.0);
+}
+
+TEST(WindowedTraversal, WindowIsClippedToTheSphere) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 8, 8,
+                                     sphere_center);
+  const Ray ray(BoundVec3(-15.0, 1.0, 2.0), UnitVec3(1.0, 0.0, 0.0));
+  EXPECT_TRUE(svr::walkSphericalVolume(ray, grid, 0.0, 4.0).empty());
+  EXPECT_TRUE(svr::walkSphericalVolume(ray, grid, 30.0, 40.0).empty());
+  EXPECT_TRUE(svr::walkSphericalVolume(ray, grid, 20.0, 10.0).empty());
+  const auto voxels = svr::walkSphericalVolume(ray, grid, 15.0, 15.5);
+  ASSERT_EQ(voxels.size(), 1);
+  EXPECT_EQ(voxels[0].radial, 4);
+  EXPECT_DOUBLE_EQ(voxels[0].enter_t, 15.0);
+  EXPECT_DOUBLE_EQ(voxels[0].exit_t, 15.5);
+  // The ray origin lies within the sphere, so negative times are clipped.
+  const Ray inside_ray(BoundVec3(1.0, 1.0, 2.0), UnitVec3(1.0, 0.0, 0.0));
+  const auto inside_voxels =
+      svr::walkSphericalVolume(inside_ray, grid, -5.0, 1.0);
+  ASSERT_FALSE(inside_voxels.empty());
+  EXPECT_DOUBLE_EQ(inside_voxels.front().enter_t, 0.0);
+  EXPECT_DOUBLE_EQ(inside_voxels.back().exit_t, 1.0);
+}
+
+TEST(WindowedTraversal, FullWindowMatchesTraversal) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  for (std::size_t i = 0; i < 100; ++i) {
+    const Ray ray(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        UnitVec3(direction(generator), direction(generator),
+                 direction(generator)));
+    // Rays with origins within the sphere are skipped, since max_t does not
+    // clip their traversal to the sphere of max radius.
+    const double origin_squared_distance = ray.origin().squared_length();
+    if (origin_squared_distance <= sphere_max_radius * sphere_max_radius) {
+      continue;
+    }
+    const auto expected = svr::walkSphericalVolume(ray, grid, /*max_t=*/1.0);
+    const auto actual = svr::walkSphericalVolume(
+        ray, grid, 0.0, std::numeric_limits<double>::max());
+    ASSERT_EQ(actual.size(), expected.size());
+    for (std::size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(actual[j].radial, expected[j].radial);
+      EXPECT_EQ(actual[j].polar, expected[j].polar);
+      EXPECT_EQ(actual[j].azimuthal, expected[j].azimuthal);
+      if (j > 0) {
+        EXPECT_DOUBLE_EQ(actual[j].enter_t, expected[j].enter_t);
+      }
+      if (j + 1 < expected.size()) {
+        EXPECT_DOUBLE_EQ(actual[j].exit_t, expected[j].exit_t);
+      }
+    }
+  }
+}
+
+// Splits the traversal of random rays into windows, both within voxels and on
+// voxel boundaries.
+void verifyRandomWindowsConcatenate(const svr::SphericalVoxelGrid &grid) {
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  std::uniform_real_distribution<double> fraction(0.0, 1.0);
+  for (std::size_t i = 0; i < 100; ++i) {
+    const Ray ray(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        UnitVec3(direction(generator), direction(generator),
+                 direction(generator)));
+    const auto voxels = svr::walkSphericalVolume(
+        ray, grid, 0.0, std::numeric_limits<double>::max());
+    if (voxels.empty()) continue;
+    const double t_begin = voxels.front().enter_t;
+    const double t_end = voxels.back().exit_t;
+    // Windows split within voxels.
+    std::vector<double> window_times = {t_begin};
+    for (std::size_t j = 1; j < 8; ++j) {
+      window_times.push_back(t_begin + (t_end - t_begin) * j / 8.0 *
+                                           (0.9 + 0.2 * fraction(generator)));
+    }
+    window_times.push_back(t_end);
+    std::sort(window_times.begin(), window_times.end());
+    verifyWindowsConcatenate(ray, grid, window_times);
+
+    // Windows split on voxel boundaries, as when resuming a traversal.
+    std::vector<double> boundary_times = {t_begin};
+    for (std::size_t j = 1; j < voxels.size(); ++j) {
+      boundary_times.push_back(voxels[j].enter_t);
+    }
+    boundary_times.push_back(t_end);
+    verifyWindowsConcatenate(ray, grid, boundary_times);
+  }
+}
+
+TEST(WindowedTraversal, WindowsConcatenateToFullTraversal) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  verifyRandomWindowsConcatenate(
+      svr::SphericalVoxelGrid(MIN_BOUND, max_bound, 8, 8, 8, sphere_center));
+  // Angular steps past voxel 0 wrap around to the last voxel.
+  verifyRandomWindowsConcatenate(
+      svr::SphericalVoxelGrid(MIN_BOUND, max_bound, 5, 7, 3, sphere_center));
+}
+
+TEST(TraversalCursor, YieldsVoxelsOfWalkSphericalVolume) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  std::vector<std::vector<svr::SphericalVoxel>> actual, expected;
+  for (std::size_t i = 0; i < 100; ++i) {
+    const Ray ray(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        UnitVec3(direction(generator), direction(generator),
+                 direction(generator)));
+    svr::TraversalCursor cursor(ray, grid, /*max_t=*/1.0);
+    actual.emplace_back(cursor.begin(), cursor.end());
+    expected.push_back(svr::walkSphericalVolume(ray, grid, /*max_t=*/1.0));
+
+    svr::TraversalCursor window_cursor(ray, grid, 5.0, 15.0);
+    actual.emplace_back();
+    for (const svr::SphericalVoxel &voxel : window_cursor) {
+      actual.back().push_back(voxel);
+    }
+    expected.push_back(svr::walkSphericalVolume(ray, grid, 5.0, 15.0));
+  }
+  verifyEqualImages(actual, expected);
+}
+
+TEST(TraversalCursor, ResumesAfterStoppingEarly) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  const Ray ray(BoundVec3(-13.0, -13.0, -13.0), UnitVec3(1.0, 1.0, 1.0));
+  svr::TraversalCursor cursor(ray, grid, /*max_t=*/1.0);
+  std::vector<svr::SphericalVoxel> voxels;
+  for (const svr::SphericalVoxel &voxel : cursor) {
+    voxels.push_back(voxel);
+    if (voxel.radial == 4) break;
+  }
+  EXPECT_EQ(voxels.size(), 4);
+  EXPECT_TRUE(cursor.hasNext());
+  svr::SphericalVoxel voxel;
+  while (cursor.next(voxel)) voxels.push_back(voxel);
+  EXPECT_FALSE(cursor.hasNext());
+  EXPECT_FALSE(cursor.next(voxel));
+  EXPECT_TRUE(cursor.begin() == cursor.end());
+  verifyEqualImages({voxels}, {svr::walkSphericalVolume(ray, grid, 1.0)});
+}
+
+TEST(TraversalCursor, UpcomingIsTheNextVoxel) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  for (std::size_t i = 0; i < 100; ++i) {
+    const Ray ray(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        UnitVec3(direction(generator), direction(generator),
+                 direction(generator)));
+    svr::TraversalCursor cursor(ray, grid, 2.0, 25.0);
+    svr::SphericalVoxel voxel;
+    while (cursor.hasNext()) {
+      const svr::SphericalVoxel upcoming = cursor.upcoming();
+      ASSERT_TRUE(cursor.next(voxel));
+      EXPECT_EQ(voxel.radial, upcoming.radial);
+      EXPECT_EQ(voxel.polar, upcoming.polar);
+      EXPECT_EQ(voxel.azimuthal, upcoming.azimuthal);
+    }
+  }
+}
+
+TEST(BackToFrontTraversal, ReversesFrontToBackTraversal) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 5, 7, 3,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  std::uniform_real_distribution<double> time(0.0, 30.0);
+  std::vector<std::vector<svr::SphericalVoxel>> actual, expected;
+  for (std::size_t i = 0; i < 200; ++i) {
+    const Ray ray(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        UnitVec3(direction(generator), direction(generator),
+                 direction(generator)));
+    const double t_1 = time(generator);
+    const double t_2 = time(generator);
+    const double t_begin = i % 2 == 0 ? std::min(t_1, t_2) : 0.0;
+    const double t_end = i % 2 == 0 ? std::max(t_1, t_2) : 100.0;
+    actual.push_back(svr::walkSphericalVolume(ray, grid, t_begin, t_end,
+                                              svr::BACK_TO_FRONT));
+    expected.push_back(svr::walkSphericalVolume(ray, grid, t_begin, t_end));
+    std::reverse(expected.back().begin(), expected.back().end());
+  }
+  verifyEqualImages(actual, expected);
+}
+
+TEST(BackToFrontTraversal, CursorBeginsAtEndOfWindow) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  const Ray ray(BoundVec3(-13.0, -12.0, -11.0), UnitVec3(1.0, 1.0, 1.0));
+  svr::TraversalCursor cursor(ray, grid, 0.0, 25.0, svr::BACK_TO_FRONT);
+  std::vector<svr::SphericalVoxel> voxels;
+  for (const svr::SphericalVoxel &voxel : cursor) {
+    voxels.push_back(voxel);
+    if (voxels.size() == 2) break;
+  }
+  EXPECT_TRUE(cursor.hasNext());
+  svr::SphericalVoxel voxel;
+  while (cursor.next(voxel)) voxels.push_back(voxel);
+  ASSERT_FALSE(voxels.empty());
+  EXPECT_DOUBLE_EQ(voxels.front().exit_t, 25.0);
+  auto expected_voxels = svr::walkSphericalVolume(ray, grid, 0.0, 25.0);
+  std::reverse(expected_voxels.begin(), expected_voxels.end());
+  verifyEqualImages({voxels}, {expected_voxels});
+}
+
+TEST(VoxelCrossing, FirstCrossingIsSphereEntrance) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  const Ray ray(BoundVec3(-15.0, 3.0, 4.0), UnitVec3(1.0, 0.0, 0.0));
+  std::vector<svr::VoxelCrossing> crossings;
+  const auto voxels =
+      svr::walkSphericalVolume(ray, grid, /*max_t=*/1.0, crossings);
+  ASSERT_EQ(crossings.size(), voxels.size());
+  ASSERT_FALSE(crossings.empty());
+  EXPECT_EQ(crossings.front().type, svr::Radial);
+  const double entrance_x = -std::sqrt(75.0);
+  EXPECT_NEAR(crossings.front().normal.x(), entrance_x / 10.0, 1e-12);
+  EXPECT_NEAR(crossings.front().normal.y(), 0.3, 1e-12);
+  EXPECT_NEAR(crossings.front().normal.z(), 0.4, 1e-12);
+
+  // The ray enters the sphere at t = 15 - sqrt(75), before the window begins.
+  svr::TraversalCursor cursor(ray, grid, 8.0, 15.0);
+  svr::SphericalVoxel voxel;
+  svr::VoxelCrossing crossing;
+  ASSERT_TRUE(cursor.next(voxel, crossing));
+  EXPECT_EQ(crossing.type, svr::NoIntersection);
+  EXPECT_EQ(crossing.normal, FreeVec3(0.0, 0.0, 0.0));
+}
+
+TEST(VoxelCrossing, CrossingsMatchVoxelTransitions) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 5, 7, 3,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  for (std::size_t i = 0; i < 100; ++i) {
+    const Ray ray(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        UnitVec3(direction(generator), direction(generator),
+                 direction(generator)));
+    std::vector<svr::VoxelCrossing> crossings;
+    const auto voxels =
+        svr::walkSphericalVolume(ray, grid, /*max_t=*/1.0, crossings);
+    verifyEqualImages({voxels}, {svr::walkSphericalVolume(ray, grid, 1.0)});
+    ASSERT_EQ(crossings.size(), voxels.size());
+    for (std::size_t j = 1; j < voxels.size(); ++j) {
+      const svr::VoxelIntersectionType type = crossings[j].type;
+      EXPECT_EQ(voxels[j].radial != voxels[j - 1].radial,
+                type == svr::Radial || type == svr::RadialPolar ||
+                    type == svr::RadialAzimuthal ||
+                    type == svr::RadialPolarAzimuthal);
+      EXPECT_EQ(voxels[j].polar != voxels[j - 1].polar,
+                type == svr::Polar || type == svr::RadialPolar ||
+                    type == svr::PolarAzimuthal ||
+                    type == svr::RadialPolarAzimuthal);
+      EXPECT_EQ(voxels[j].azimuthal != voxels[j - 1].azimuthal,
+                type == svr::Azimuthal || type == svr::RadialAzimuthal ||
+                    type == svr::PolarAzimuthal ||
+                    type == svr::RadialPolarAzimuthal);
+
+      const FreeVec3 &normal = crossings[j].normal;
+      EXPECT_NEAR(normal.length(), 1.0, 1e-12);
+      EXPECT_LE(normal.dot(ray.direction().to_free()), 0.0);
+      // The crossed boundary contains the point of entrance.
+      const FreeVec3 center_to_point =
+          ray.pointAtParameter(voxels[j].enter_t) - sphere_center;
+      if (type == svr::Radial) {
+        EXPECT_NEAR(std::abs(normal.dot(center_to_point)),
+                    center_to_point.length(), 1e-9);
+      } else if (type == svr::Polar || type == svr::Azimuthal) {
+        EXPECT_NEAR(normal.dot(center_to_point), 0.0, 1e-9);
+      }
+    }
+  }
+}
+
+TEST(VoxelCrossing, RayThroughCenterCrossesBoundaryOfEnteredVoxel) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const int num_polar_sections = 7;
+  const int num_azimuthal_sections = 5;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4,
+                                     num_polar_sections, num_azimuthal_sections,
+                                     sphere_center);
+  // The ray passes through the sphere center, where the polar and azimuthal
+  // voxels each step across the center rather than to a neighboring voxel.
+  // With an odd number of sections, the boundaries of the voxels on either
+  // side of the center do not lie in the same plane.
+  const UnitVec3 direction(1.0, 2.0, 0.5);
+  const Ray ray(sphere_center - direction.to_free() * 15.0, direction);
+  std::vector<svr::VoxelCrossing> crossings;
+  const auto voxels =
+      svr::walkSphericalVolume(ray, grid, /*max_t=*/1.0, crossings);
+  ASSERT_EQ(crossings.size(), voxels.size());
+  const double delta_theta = TAU / num_polar_sections;
+  const double delta_phi = TAU / num_azimuthal_sections;
+  // Returns whether the normal is that of a polar boundary, an azimuthal
+  // boundary, or their sum, for the boundaries of the entered voxel.
+  const auto is_boundary_normal = [&](const FreeVec3 &normal, int polar,
+                                      int azimuthal) -> bool {
+    for (int p = polar; p <= polar + 1; ++p) {
+      for (int a = azimuthal; a <= azimuthal + 1; ++a) {
+        const FreeVec3 polar_normal(-std::sin(p * delta_theta),
+                                    std::cos(p * delta_theta), 0.0);
+        const FreeVec3 azimuthal_normal(-std::sin(a * delta_phi), 0.0,
+                                        std::cos(a * delta_phi));
+        const FreeVec3 sum = polar_normal + azimuthal_normal;
+        const FreeVec3 difference = polar_normal - azimuthal_normal;
+        for (const FreeVec3 &expected :
+             {polar_normal, azimuthal_normal, sum / sum.length(),
+              difference / difference.length()}) {
+          if (std::abs(std::abs(normal.dot(expected)) - 1.0) < 1e-9) {
+            return true;
+          }
+        }
+      }
+    }
+    return false;
+  };
+  bool steps_across_center = false;
+  for (std::size_t j = 1; j < voxels.size(); ++j) {
+    const int polar_step = std::abs(voxels[j].polar - voxels[j - 1].polar);
+    if (polar_step <= 1 || polar_step == num_polar_sections - 1) continue;
+    steps_across_center = true;
+    EXPECT_EQ(crossings[j].type, svr::PolarAzimuthal);
+    EXPECT_TRUE(is_boundary_normal(crossings[j].normal, voxels[j].polar,
+                                   voxels[j].azimuthal));
+  }
+  EXPECT_TRUE(steps_across_center);
+}
+
+TEST(VoxelSample, SamplesLieWithinTheirVoxels) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 5, 7, 3,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  const std::size_t samples_per_voxel = 3;
+  for (std::size_t i = 0; i < 100; ++i) {
+    const Ray ray(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        UnitVec3(direction(generator), direction(generator),
+                 direction(generator)));
+    std::vector<svr::VoxelSample> samples;
+    const auto voxels = svr::walkSphericalVolume(ray, grid, 0.0, 100.0,
+                                                 samples_per_voxel, samples);
+    verifyEqualImages({voxels},
+                      {svr::walkSphericalVolume(ray, grid, 0.0, 100.0)});
+    ASSERT_EQ(samples.size(), voxels.size() * samples_per_voxel);
+    std::vector<double> points;
+    for (const svr::VoxelSample &sample : samples) {
+      points.push_back(sample.position.x());
+      points.push_back(sample.position.y());
+      points.push_back(sample.position.z());
+    }
+    std::vector<int> located_voxels(points.size());
+    svr::locatePoints(points.data(), samples.size(), grid,
+                      located_voxels.data());
+    for (std::size_t j = 0; j < samples.size(); ++j) {
+      const svr::SphericalVoxel &voxel = voxels[j / samples_per_voxel];
+      const svr::VoxelSample &sample = samples[j];
+      const double stratum_length =
+          (voxel.exit_t - voxel.enter_t) / samples_per_voxel;
+      const double stratum = j % samples_per_voxel;
+      EXPECT_NEAR(sample.t, voxel.enter_t + stratum_length * (stratum + 0.5),
+                  1e-12);
+      EXPECT_EQ(located_voxels[3 * j], voxel.radial);
+      EXPECT_EQ(located_voxels[3 * j + 1], voxel.polar);
+      EXPECT_EQ(located_voxels[3 * j + 2], voxel.azimuthal);
+      // The spherical coordinates lie within the voxel's bounds.
+      EXPECT_LE(sample.radius, sphere_max_radius - (voxel.radial - 1) *
+                                                       grid.deltaRadius());
+      EXPECT_GE(sample.radius,
+                sphere_max_radius - voxel.radial * grid.deltaRadius());
+      EXPECT_GE(sample.polar, voxel.polar * grid.deltaTheta());
+      EXPECT_LE(sample.polar, (voxel.polar + 1) * grid.deltaTheta());
+      EXPECT_GE(sample.azimuthal, voxel.azimuthal * grid.deltaPhi());
+      EXPECT_LE(sample.azimuthal, (voxel.azimuthal + 1) * grid.deltaPhi());
+    }
+  }
+}
+
+TEST(VoxelSample, SingleSampleIsMidpoint) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 1, 1, 1,
+                                     sphere_center);
+  const Ray ray(BoundVec3(-15.0, 0.0, -1.0), UnitVec3(1.0, 0.0, 0.0));
+  const svr::SphericalVoxel voxel = {
+      .radial = 1, .polar = 0, .azimuthal = 0, .enter_t = 5.0, .exit_t = 25.0};
+  svr::VoxelSample sample;
+  svr::sampleVoxel(ray, grid, voxel, 1, &sample);
+  EXPECT_DOUBLE_EQ(sample.t, 15.0);
+  EXPECT_EQ(sample.position, BoundVec3(0.0, 0.0, -1.0));
+  EXPECT_DOUBLE_EQ(sample.radius, 1.0);
+  EXPECT_DOUBLE_EQ(sample.polar, 0.0);
+  EXPECT_DOUBLE_EQ(sample.azimuthal, 1.5 * M_PI);
+}
+
+TEST(SphericalVoxelField, InterpolationAtVoxelCentersIsVoxelValue) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 6, 5,
+                                     sphere_center);
+  std::vector<double> values(4 * 6 * 5);
+  std::iota(values.begin(), values.end(), 1.0);
+  const svr::SphericalVoxelField field(grid, values);
+  for (int radial = 1; radial <= 4; ++radial) {
+    for (int polar = 0; polar < 6; ++polar) {
+      for (int azimuthal = 0; azimuthal < 5; ++azimuthal) {
+        const double radius =
+            sphere_max_radius - (radial - 0.5) * grid.deltaRadius();
+        const double interpolated =
+            field.interpolate(radius, (polar + 0.5) * grid.deltaTheta(),
+                              (azimuthal + 0.5) * grid.deltaPhi());
+        EXPECT_NEAR(interpolated, field.value(radial, polar, azimuthal), 1e-9);
+      }
+    }
+  }
+}
+
+TEST(SphericalVoxelField, InterpolationIsLinearBetweenVoxelCenters) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  // The value of each voxel is the radius of its center.
+  std::vector<double> values;
+  for (int radial = 1; radial <= 4; ++radial) {
+    values.insert(values.end(), 16,
+                  sphere_max_radius - (radial - 0.5) * grid.deltaRadius());
+  }
+  const svr::SphericalVoxelField field(grid, values);
+  EXPECT_NEAR(field.interpolate(5.0, 1.0, 2.0), 5.0, 1e-12);
+  EXPECT_NEAR(field.interpolate(3.0, 4.0, 5.0), 3.0, 1e-12);
+  // The values are clamped at the outermost voxel centers.
+  EXPECT_NEAR(field.interpolate(9.9, 1.0, 2.0), 8.75, 1e-12);
+}
+
+TEST(SphericalVoxelField, AngularNeighborsWrapAround) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 1, 4, 1,
+                                     sphere_center);
+  const svr::SphericalVoxelField field(grid, {1.0, 2.0, 3.0, 4.0});
+  // The boundary between the last and first polar voxels is halfway between
+  // their centers.
+  EXPECT_NEAR(field.interpolate(5.0, 0.0, 0.0), 2.5, 1e-12);
+  EXPECT_NEAR(field.interpolate(5.0, TAU - 1e-12, 0.0), 2.5, 1e-9);
+  EXPECT_NEAR(field.interpolate(5.0, 0.125 * M_PI, 0.0), 1.75, 1e-12);
+
+  // A sectored grid is clamped instead.
+  const svr::SphereBound sector_max_bound = {
+      .radial = sphere_max_radius, .polar = M_PI, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid sector_grid(MIN_BOUND, sector_max_bound, 1, 4,
+                                            1, sphere_center);
+  const svr::SphericalVoxelField sector_field(sector_grid,
+                                              {1.0, 2.0, 3.0, 4.0});
+  EXPECT_NEAR(sector_field.interpolate(5.0, 0.0, 0.0), 1.0, 1e-12);
+  EXPECT_NEAR(sector_field.interpolate(5.0, M_PI, 0.0), 4.0, 1e-12);
+}
+
+// Values which record the indices prefetched by a field.
+struct PrefetchRecordingValues {
+  std::vector<double> values;
+  mutable std::set<std::size_t> prefetched;
+
+  double operator[](std::size_t index) const { return values[index]; }
+  std::size_t size() const { return values.size(); }
+};
+
+void prefetchValue(const PrefetchRecordingValues &container,
+                   std::size_t index) noexcept {
+  container.prefetched.insert(index);
+}
+
+TEST(SphericalVoxelField, PrefetchedPolarNeighborsWrapAround) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  for (const double max_polar : {TAU, M_PI}) {
+    const svr::SphereBound max_bound = {
+        .radial = sphere_max_radius, .polar = max_polar, .azimuthal = TAU};
+    const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 3, 4, 5,
+                                       sphere_center);
+    const svr::BasicSphericalVoxelField<PrefetchRecordingValues> field(
+        grid, PrefetchRecordingValues{std::vector<double>(3 * 4 * 5), {}});
+    const svr::SphericalVoxel voxel = {
+        .radial = 2, .polar = 0, .azimuthal = 2, .enter_t = 0.0, .exit_t = 0.0};
+    field.prefetch(voxel);
+    // The last polar voxel neighbors the first only if the grid spans the
+    // entire circle.
+    std::set<std::size_t> expected;
+    for (int r = 1; r <= 3; ++r) {
+      for (const int p : {0, 1, 3}) {
+        if (p == 3 && !field.polarWraps()) continue;
+        expected.insert(field.index(r, p, 2));
+      }
+    }
+    EXPECT_EQ(field.values().prefetched, expected);
+  }
+}
+
+TEST(SphericalVoxelField, PrefetchesAzimuthalNeighborsOfOtherCacheLines) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 3, 4, 6,
+                                     sphere_center);
+  // Returns the indices of the voxel's neighbors with the given azimuthal
+  // voxels.
+  const auto neighbors = [](const svr::VoxelLayout &layout,
+                            const std::vector<int> &azimuthal_voxels) {
+    std::set<std::size_t> indices;
+    for (int r = 1; r <= 3; ++r) {
+      for (const int p : {0, 1, 3}) {
+        for (const int a : azimuthal_voxels) {
+          indices.insert(layout.index(r, p, a));
+        }
+      }
+    }
+    return indices;
+  };
+  const svr::SphericalVoxel voxel = {
+      .radial = 2, .polar = 0, .azimuthal = 1, .enter_t = 0.0, .exit_t = 0.0};
+  // Azimuthal neighbors are adjacent within RADIAL_MAJOR runs and BRICKED
+  // bricks, except across the ends of a run or brick.
+  const std::vector<std::pair<svr::VoxelLayout, std::vector<int>>> cases = {
+      {svr::VoxelLayout(grid, svr::RADIAL_MAJOR), {1}},
+      {svr::VoxelLayout(grid, svr::AZIMUTHAL_MAJOR), {0, 1, 2}},
+      {svr::VoxelLayout(grid, svr::BRICKED, 2), {1, 2}}};
+  for (const auto &layout_and_azimuthal_voxels : cases) {
+    const svr::VoxelLayout &layout = layout_and_azimuthal_voxels.first;
+    const svr::BasicSphericalVoxelField<PrefetchRecordingValues> field(
+        grid, PrefetchRecordingValues{std::vector<double>(layout.size()), {}},
+        layout);
+    field.prefetch(voxel);
+    EXPECT_EQ(field.values().prefetched,
+              neighbors(layout, layout_and_azimuthal_voxels.second));
+  }
+}
+
+TEST(SphericalVoxelField, CenterValueIsMeanOfInnermostShell) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 2, 2, 2,
+                                     sphere_center);
+  const svr::SphericalVoxelField field(
+      grid, {0.0, 0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 6.0});
+  EXPECT_DOUBLE_EQ(field.interpolate(0.0, 0.3, 4.0), 3.0);
+  EXPECT_DOUBLE_EQ(field.interpolate(0.0, 5.0, 1.0), 3.0);
+  // Halfway between the innermost voxel center and the sphere center.
+  EXPECT_NEAR(field.interpolate(1.25, 0.5 * M_PI, 0.5 * M_PI), 2.0, 1e-12);
+}
+
+TEST(ReducedPrecisionField, HalfConversion) {
+  for (const float value : {0.0f, -0.0f, 1.0f, -2.5f, 0.333251953125f,
+                            65504.0f, 6.103515625e-05f, 5.9604644775390625e-8f,
+                            -1.1920928955078125e-7f}) {
+    EXPECT_EQ(svr::halfToFloat(svr::floatToHalf(value)), value);
+  }
+  // Rounds to the nearest even.
+  EXPECT_EQ(svr::halfToFloat(svr::floatToHalf(1.0f + 4.8828125e-4f)), 1.0f);
+  EXPECT_EQ(svr::halfToFloat(svr::floatToHalf(1.0f + 7.32421875e-4f)),
+            1.0f + 9.765625e-4f);
+  EXPECT_EQ(svr::halfToFloat(svr::floatToHalf(2.9802322387695312e-8f)), 0.0f);
+  EXPECT_EQ(svr::halfToFloat(svr::floatToHalf(65520.0f)),
+            std::numeric_limits<float>::infinity());
+  EXPECT_EQ(svr::halfToFloat(svr::floatToHalf(-1e10f)),
+            -std::numeric_limits<float>::infinity());
+  EXPECT_TRUE(std::isnan(svr::halfToFloat(
+      svr::floatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+TEST(ReducedPrecisionField, BFloat16Conversion) {
+  for (const float value : {0.0f, 1.0f, -3.0f, 393216.0f, 0.0078125f}) {
+    EXPECT_EQ(svr::bfloat16ToFloat(svr::floatToBFloat16(value)), value);
+  }
+  EXPECT_EQ(svr::bfloat16ToFloat(svr::floatToBFloat16(1.0f + 0.00390625f)),
+            1.0f);
+  EXPECT_EQ(svr::bfloat16ToFloat(svr::floatToBFloat16(1.0f + 0.005859375f)),
+            1.0f + 0.0078125f);
+  EXPECT_TRUE(std::isnan(svr::bfloat16ToFloat(
+      svr::floatToBFloat16(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+TEST(ReducedPrecisionField, ContainersAreWithinTheirPrecision) {
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> distribution(-100.0, 100.0);
+  std::vector<double> values(1000);
+  for (double &value : values) value = distribution(generator);
+  const svr::HalfVector halves(values);
+  const svr::BFloat16Vector bfloat16s(values);
+  const svr::QuantizedVector quantized(values);
+  ASSERT_EQ(halves.size(), values.size());
+  ASSERT_EQ(bfloat16s.size(), values.size());
+  ASSERT_EQ(quantized.size(), values.size());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    EXPECT_NEAR(halves[i], values[i], std::abs(values[i]) * 4.8828125e-4);
+    EXPECT_NEAR(bfloat16s[i], values[i], std::abs(values[i]) * 0.00390625);
+    EXPECT_NEAR(quantized[i], values[i], 200.0 / 510.0);
+  }
+  // Four values decoded together match those decoded one at a time.
+  const std::size_t indices[4] = {7, 3, 999, 500};
+  double gathered[4];
+  svr::gatherValues(halves, indices, gathered);
+  for (std::size_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(gathered[i], halves[indices[i]]);
+  }
+}
+
+#ifdef __F16C__
+TEST(ReducedPrecisionField, F16CDecodesEveryHalf) {
+  // Builds a container holding every half-precision value, by way of values
+  // that convert to each of them exactly.
+  std::vector<double> values(65536);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = svr::halfToFloat(static_cast<std::uint16_t>(i));
+  }
+  const svr::HalfVector halves(values);
+  for (std::size_t i = 0; i < values.size(); i += 4) {
+    const std::size_t indices[4] = {i + 3, i, i + 2, i + 1};
+    double gathered[4];
+    svr::gatherValues(halves, indices, gathered);
+    for (std::size_t j = 0; j < 4; ++j) {
+      const double expected = svr::halfToFloat(halves.halves()[indices[j]]);
+      if (std::isnan(expected)) {
+        EXPECT_TRUE(std::isnan(gathered[j]));
+      } else {
+        EXPECT_EQ(gathered[j], expected);
+      }
+    }
+  }
+}
+#endif
+
+TEST(ReducedPrecisionField, InterpolationMatchesDoubleField) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 6, 5,
+                                     sphere_center);
+  std::vector<double> values(4 * 6 * 5);
+  std::iota(values.begin(), values.end(), 1.0);
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::HalfSphericalVoxelField half_field(grid, svr::HalfVector(values));
+  const svr::BFloat16SphericalVoxelField bfloat16_field(
+      grid, svr::BFloat16Vector(values));
+  const svr::QuantizedSphericalVoxelField quantized_field(
+      grid, svr::QuantizedVector(values));
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<double> radius_distribution(0.0, 10.0);
+  std::uniform_real_distribution<double> angle_distribution(0.0, TAU);
+  for (std::size_t i = 0; i < 100; ++i) {
+    const double radius = radius_distribution(generator);
+    const double polar = angle_distribution(generator);
+    const double azimuthal = angle_distribution(generator);
+    const double expected = field.interpolate(radius, polar, azimuthal);
+    // The values are integers, which half precision represents exactly.
+    EXPECT_NEAR(half_field.interpolate(radius, polar, azimuthal), expected,
+                1e-9);
+    EXPECT_NEAR(bfloat16_field.interpolate(radius, polar, azimuthal),
+                expected, 120.0 * 0.00390625);
+    EXPECT_NEAR(quantized_field.interpolate(radius, polar, azimuthal),
+                expected, 64.0 / 510.0);
+  }
+}
+
+TEST(SphericalVoxelFieldSet, MatchesIndividualFields) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 6, 5,
+                                     sphere_center);
+  std::vector<std::vector<double>> channels(3, std::vector<double>(4 * 6 * 5));
+  std::iota(channels[0].begin(), channels[0].end(), 0.0);
+  std::iota(channels[1].rbegin(), channels[1].rend(), -7.0);
+  std::fill(channels[2].begin(), channels[2].end(), 2.5);
+  const svr::SphericalVoxelFieldSet fields(grid, channels);
+  ASSERT_EQ(fields.numFields(), 3);
+  const Ray ray(BoundVec3(-13.0, -12.0, -11.0), UnitVec3(1.0, 1.1, 1.2));
+  std::vector<svr::VoxelSample> samples;
+  svr::walkSphericalVolume(ray, grid, 0.0, 100.0, 3, samples);
+  ASSERT_FALSE(samples.empty());
+  std::vector<double> values(3 * samples.size());
+  fields.interpolate(samples.data(), samples.size(), values.data());
+  for (std::size_t s = 0; s < samples.size(); ++s) {
+    for (std::size_t i = 0; i < 3; ++i) {
+      EXPECT_DOUBLE_EQ(values[3 * s + i],
+                       svr::SphericalVoxelField(grid, channels[i])
+                           .interpolate(samples[s]));
+    }
+  }
+}
+
+TEST(SphericalVoxelFieldSet, IntegratesAlongRay) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  std::vector<double> increasing(4 * 4 * 4);
+  std::iota(increasing.begin(), increasing.end(), 0.0);
+  const svr::SphericalVoxelFieldSet fields(
+      grid, {std::vector<double>(4 * 4 * 4, 2.0), increasing});
+  // The ray passes 6 from the center, so its chord through the sphere has a
+  // length of 16.
+  const Ray ray(BoundVec3(-15.0, 6.0, 0.0), UnitVec3(1.0, 0.0, 0.0));
+  double integrals[2];
+  fields.integrate(ray, 0.0, 100.0, 2, integrals);
+  EXPECT_NEAR(integrals[0], 2.0 * 16.0, 1e-9);
+  // The second field matches integrating its samples individually.
+  std::vector<svr::VoxelSample> samples;
+  svr::walkSphericalVolume(ray, grid, 0.0, 100.0, 2, samples);
+  const svr::SphericalVoxelField field(grid, increasing);
+  double expected = 0.0;
+  const std::vector<svr::SphericalVoxel> voxels =
+      svr::walkSphericalVolume(ray, grid, 0.0, 100.0);
+  for (std::size_t v = 0; v < voxels.size(); ++v) {
+    const double stratum_length =
+        0.5 * (voxels[v].exit_t - voxels[v].enter_t);
+    expected += stratum_length * (field.interpolate(samples[2 * v]) +
+                                  field.interpolate(samples[2 * v + 1]));
+  }
+  EXPECT_NEAR(integrals[1], expected, 1e-9);
+}
+
+TEST(VoxelGatherPlan, MatchesPathOrderGather) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 16, 16, 16,
+                                     sphere_center);
+  std::vector<double> values(16 * 16 * 16);
+  std::iota(values.begin(), values.end(), 0.0);
+  const svr::SphericalVoxelField field(grid, values);
+  RayBatch rays;
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+  for (std::size_t i = 0; i < 50; ++i) {
+    rays.push_back(BoundVec3(-15.0, 10.0 * distribution(generator),
+                             10.0 * distribution(generator)),
+                   FreeVec3(1.0, 0.2 * distribution(generator),
+                            0.2 * distribution(generator)));
+  }
+  const std::vector<std::vector<svr::SphericalVoxel>> traversals =
+      svr::walkSphericalVolumeBatch(rays, grid, 100.0);
+  const svr::VoxelGatherPlan plan(grid, traversals);
+  std::vector<double> gathered(plan.numVoxels());
+  plan.gather(field, gathered.data());
+  std::size_t num_voxels = 0;
+  for (std::size_t i = 0; i < traversals.size(); ++i) {
+    EXPECT_EQ(plan.offset(i), num_voxels);
+    for (std::size_t j = 0; j < traversals[i].size(); ++j) {
+      EXPECT_EQ(gathered[plan.offset(i) + j], field.value(traversals[i][j]));
+    }
+    num_voxels += traversals[i].size();
+  }
+  EXPECT_EQ(plan.numVoxels(), num_voxels);
+  EXPECT_GT(num_voxels, 0);
+}
+
+TEST(SparseField, MatchesDenseValues) {
+  // A shell of non-zero values, with gaps, within rows of 8 values.
+  std::vector<double> values(4 * 5 * 8, 0.0);
+  for (std::size_t i = 40; i < 80; ++i) {
+    if (i % 8 != 3) values[i] = static_cast<double>(i);
+  }
+  values[159] = -1.0;
+  const svr::SparseVector sparse(values, 8);
+  ASSERT_EQ(sparse.size(), values.size());
+  EXPECT_EQ(sparse.numStoredValues(), 36);
+  std::size_t hint = 0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(sparse[i], values[i]);
+    EXPECT_EQ(sparse.value(i, hint), values[i]);
+  }
+  // Lookups with a stale hint are still correct.
+  hint = 0;
+  for (std::size_t i = values.size(); i-- > 0;) {
+    EXPECT_EQ(sparse.value(i, hint), values[i]);
+  }
+  std::vector<std::size_t> indices;
+  sparse.forEachValue([&](std::size_t index, double value) {
+    EXPECT_EQ(value, values[index]);
+    indices.push_back(index);
+  });
+  EXPECT_EQ(indices.size(), 36);
+  EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+
+  // Entries in any order give the same container.
+  const svr::SparseVector from_entries(
+      values.size(), 8, {{159, -1.0}, {41, 41.0}, {40, 40.0}}, 2.0);
+  EXPECT_EQ(from_entries[40], 40.0);
+  EXPECT_EQ(from_entries[41], 41.0);
+  EXPECT_EQ(from_entries[42], 2.0);
+  EXPECT_EQ(from_entries[159], -1.0);
+  EXPECT_EQ(from_entries[0], 2.0);
+}
+
+TEST(SparseField, TraversalLookupsMatchDenseField) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  // A thin shell, restricted to half of the polar voxels.
+  std::vector<double> values(8 * 8 * 8, 0.0);
+  for (std::size_t i = 2 * 64; i < 3 * 64; i += 2) values[i] = i;
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::SparseSphericalVoxelField sparse_field(
+      grid, svr::SparseVector(values, grid.numAzimuthalSections()));
+  const Ray ray(BoundVec3(-13.0, -12.0, -11.0), UnitVec3(1.0, 1.1, 1.2));
+  const std::vector<svr::SphericalVoxel> voxels =
+      svr::walkSphericalVolume(ray, grid, 0.0, 100.0);
+  ASSERT_FALSE(voxels.empty());
+  std::size_t hint = 0;
+  for (const svr::SphericalVoxel &voxel : voxels) {
+    const std::size_t index =
+        sparse_field.index(voxel.radial, voxel.polar, voxel.azimuthal);
+    EXPECT_EQ(sparse_field.values().value(index, hint), field.value(voxel));
+    const svr::VoxelSample sample =
+        svr::sampleRay(ray, grid, 0.5 * (voxel.enter_t + voxel.exit_t));
+    EXPECT_DOUBLE_EQ(sparse_field.interpolate(sample),
+                     field.interpolate(sample));
+  }
+}
+
+TEST(HugePageAllocator, AllocatesWithEachPolicy) {
+  std::vector<double> values(1 << 19);
+  std::iota(values.begin(), values.end(), 0.0);
+  for (const svr::HugePagePolicy policy :
+       {svr::BASE_PAGES, svr::TRANSPARENT_HUGE_PAGES,
+        svr::EXPLICIT_HUGE_PAGES}) {
+    svr::HugePageVector<double> huge_values =
+        svr::toHugePageVector(values, policy);
+    EXPECT_TRUE(std::equal(values.begin(), values.end(), huge_values.begin()));
+    if (huge_values.get_allocator().usesHugePages(huge_values.capacity())) {
+      // Explicit huge pages fall back to transparent ones without a pool,
+      // and both are aligned to a huge page.
+      EXPECT_EQ(reinterpret_cast<std::uintptr_t>(huge_values.data()) %
+                    svr::HUGE_PAGE_SIZE,
+                0);
+    }
+    // Growing reallocates with the same policy.
+    huge_values.push_back(-1.0);
+    EXPECT_EQ(huge_values.get_allocator().policy(), policy);
+    EXPECT_EQ(huge_values[values.size() - 1], values.back());
+    EXPECT_EQ(huge_values.back(), -1.0);
+  }
+  // Small allocations use operator new.
+  EXPECT_FALSE(svr::HugePageAllocator<double>().usesHugePages(1000));
+}
+
+TEST(HugePageAllocator, FieldMatchesDenseField) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 64, 64, 64,
+                                     sphere_center);
+  std::vector<double> values(64 * 64 * 64);
+  std::iota(values.begin(), values.end(), 0.0);
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::BasicSphericalVoxelField<svr::HugePageVector<double>> huge_field(
+      grid, svr::toHugePageVector(values));
+  const Ray ray(BoundVec3(-13.0, -12.0, -11.0), UnitVec3(1.0, 1.1, 1.2));
+  std::vector<svr::VoxelSample> samples;
+  svr::walkSphericalVolume(ray, grid, 0.0, 100.0, 4, samples);
+  ASSERT_FALSE(samples.empty());
+  for (const svr::VoxelSample &sample : samples) {
+    EXPECT_EQ(huge_field.interpolate(sample), field.interpolate(sample));
+  }
+}
+
+TEST(VoxelLayout, EachOrderingIsABijection) {
+  const std::size_t num_radial = 5, num_polar = 6, num_azimuthal = 7;
+  for (const svr::VoxelOrdering ordering :
+       {svr::RADIAL_MAJOR, svr::AZIMUTHAL_MAJOR, svr::BRICKED}) {
+    const svr::VoxelLayout layout(num_radial, num_polar, num_azimuthal,
+                                  ordering, /*brick_size=*/4);
+    EXPECT_GE(layout.size(), num_radial * num_polar * num_azimuthal);
+    std::vector<bool> used(layout.size(), false);
+    for (int r = 1; r <= static_cast<int>(num_radial); ++r) {
+      for (int p = 0; p < static_cast<int>(num_polar); ++p) {
+        for (int a = 0; a < static_cast<int>(num_azimuthal); ++a) {
+          const std::size_t index = layout.index(r, p, a);
+          ASSERT_LT(index, layout.size());
+          EXPECT_FALSE(used[index]);
+          used[index] = true;
+        }
+      }
+    }
+  }
+  const svr::VoxelLayout radial_major(num_radial, num_polar, num_azimuthal);
+  EXPECT_EQ(radial_major.size(), num_radial * num_polar * num_azimuthal);
+  EXPECT_EQ(radial_major.index(2, 3, 4),
+            (1 * num_polar + 3) * num_azimuthal + 4);
+  const svr::VoxelLayout azimuthal_major(num_radial, num_polar, num_azimuthal,
+                                         svr::AZIMUTHAL_MAJOR);
+  EXPECT_EQ(azimuthal_major.index(2, 3, 4),
+            (4 * num_polar + 3) * num_radial + 1);
+  // Each dimension of 5, 6, and 7 voxels is padded to 2 bricks of 4 voxels.
+  const svr::VoxelLayout bricked(num_radial, num_polar, num_azimuthal,
+                                 svr::BRICKED, 4);
+  EXPECT_EQ(bricked.size(), std::size_t{8 * 8 * 8});
+  EXPECT_EQ(bricked.index(1, 0, 3), std::size_t{3});
+  EXPECT_EQ(bricked.index(1, 0, 4), std::size_t{64});
+}
+
+TEST(VoxelLayout, FieldsMatchInEachOrdering) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const svr::SphereBound max_bound = {
+      .radial = 10.0, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 5, 6, 7,
+                                     sphere_center);
+  const svr::VoxelLayout radial_major(grid);
+  std::vector<double> values(radial_major.size());
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> value_distribution(-1.0, 1.0);
+  for (double &value : values) value = value_distribution(generator);
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::SphericalGradientField gradients(field, 1);
+  for (const svr::VoxelOrdering ordering :
+       {svr::AZIMUTHAL_MAJOR, svr::BRICKED}) {
+    const svr::VoxelLayout layout(grid, ordering, /*brick_size=*/4);
+    std::vector<double> reordered(layout.size(), 0.0);
+    for (int r = 1; r <= 5; ++r) {
+      for (int p = 0; p < 6; ++p) {
+        for (int a = 0; a < 7; ++a) {
+          reordered[layout.index(r, p, a)] =
+              values[radial_major.index(r, p, a)];
+        }
+      }
+    }
+    const svr::SphericalVoxelField reordered_field(grid, reordered, layout);
+    EXPECT_DOUBLE_EQ(reordered_field.interpolate(0.0, 0.0, 0.0),
+                     field.interpolate(0.0, 0.0, 0.0));
+    std::uniform_real_distribution<double> radius_distribution(0.0, 10.0);
+    std::uniform_real_distribution<double> angle_distribution(0.0, TAU);
+    for (std::size_t i = 0; i < 100; ++i) {
+      const double radius = radius_distribution(generator);
+      const double polar = angle_distribution(generator);
+      const double azimuthal = angle_distribution(generator);
+      EXPECT_DOUBLE_EQ(reordered_field.interpolate(radius, polar, azimuthal),
+                       field.interpolate(radius, polar, azimuthal));
+    }
+    const svr::SphericalGradientField reordered_gradients(reordered_field, 1);
+    for (int r = 1; r <= 5; ++r) {
+      for (int p = 0; p < 6; ++p) {
+        for (int a = 0; a < 7; ++a) {
+          const FreeVec3 expected = gradients.gradient(r, p, a);
+          const FreeVec3 actual = reordered_gradients.gradient(r, p, a);
+          for (std::size_t j = 0; j < 3; ++j) {
+            EXPECT_DOUBLE_EQ(actual[j], expected[j]);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(VoxelLayout, TraversalIndicesMatchLayout) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const svr::SphereBound max_bound = {
+      .radial = 10.0, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 8, 8, 8,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  RayBatch rays;
+  for (std::size_t i = 0; i < 50; ++i) {
+    rays.push_back(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        FreeVec3(direction(generator), direction(generator),
+                 direction(generator)));
+  }
+  for (const svr::VoxelOrdering ordering :
+       {svr::RADIAL_MAJOR, svr::AZIMUTHAL_MAJOR, svr::BRICKED}) {
+    const svr::VoxelLayout layout(grid, ordering, /*brick_size=*/4);
+    svr::VoxelColumns columns;
+    svr::walkSphericalVolumeBatch(rays, grid, 1.0, columns, svr::INPUT_ORDER,
+                                  &layout);
+    ASSERT_EQ(columns.index.size(), columns.size());
+    for (std::size_t row = 0; row < columns.size(); ++row) {
+      EXPECT_EQ(columns.index[row],
+                layout.index(columns.radial[row], columns.polar[row],
+                             columns.azimuthal[row]));
+    }
+    std::vector<std::uint32_t> indices;
+    for (std::size_t i = 0; i < rays.size(); ++i) {
+      const auto voxels =
+          svr::walkSphericalVolume(rays.ray(i), grid, 1.0, layout, indices);
+      ASSERT_EQ(indices.size(), voxels.size());
+      ASSERT_EQ(voxels.size(), columns.count[i]);
+      for (std::size_t j = 0; j < voxels.size(); ++j) {
+        EXPECT_EQ(indices[j], columns.index[columns.first[i] + j]);
+      }
+    }
+  }
+  svr::VoxelColumns columns;
+  svr::walkSphericalVolumeBatch(rays, grid, 1.0, columns);
+  EXPECT_TRUE(columns.index.empty());
+}
+
+TEST(SphericalGradientField, RadialFieldHasRadialGradient) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 6, 8,
+                                     sphere_center);
+  // The value of each voxel is the radius of its center.
+  std::vector<double> values;
+  for (int radial = 1; radial <= 4; ++radial) {
+    values.insert(values.end(), 6 * 8,
+                  sphere_max_radius - (radial - 0.5) * grid.deltaRadius());
+  }
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::SphericalGradientField gradients(field, /*num_threads=*/3);
+  EXPECT_GT(gradients.scale(), 0.0);
+  for (int radial = 1; radial <= 4; ++radial) {
+    for (int polar = 0; polar < 6; ++polar) {
+      for (int azimuthal = 0; azimuthal < 8; ++azimuthal) {
+        const FreeVec3 gradient = gradients.gradient(radial, polar, azimuthal);
+        EXPECT_NEAR(gradient.length(), 1.0, gradients.scale());
+        const double polar_angle = (polar + 0.5) * grid.deltaTheta();
+        const double azimuthal_angle = (azimuthal + 0.5) * grid.deltaPhi();
+        // Only voxels whose center has both angles point along them. Where a
+        // cosine is zero, the center lies on the yz-plane, so the other angle
+        // is arbitrary.
+        if (std::cos(polar_angle) * std::cos(azimuthal_angle) < 1e-6) {
+          continue;
+        }
+        double gradient_polar = std::atan2(gradient.y(), gradient.x());
+        double gradient_azimuthal = std::atan2(gradient.z(), gradient.x());
+        if (gradient_polar < 0.0) gradient_polar += TAU;
+        if (gradient_azimuthal < 0.0) gradient_azimuthal += TAU;
+        EXPECT_NEAR(gradient_polar, polar_angle, 1e-3);
+        EXPECT_NEAR(gradient_azimuthal, azimuthal_angle, 1e-3);
+      }
+    }
+  }
+}
+
+TEST(SphericalGradientField, PolarFieldHasTangentialGradient) {
+  const BoundVec3 sphere_center(1.0, 2.0, 3.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {.radial = sphere_max_radius,
+                                      .polar = 0.5 * M_PI,
+                                      .azimuthal = 0.5 * M_PI};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 3, 5, 4,
+                                     sphere_center);
+  // The value of each voxel is the polar angle of its center.
+  std::vector<double> values;
+  for (int radial = 1; radial <= 3; ++radial) {
+    for (int polar = 0; polar < 5; ++polar) {
+      values.insert(values.end(), 4, (polar + 0.5) * grid.deltaTheta());
+    }
+  }
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::SphericalGradientField gradients(field);
+  for (int radial = 1; radial <= 3; ++radial) {
+    for (int polar = 0; polar < 5; ++polar) {
+      for (int azimuthal = 0; azimuthal < 4; ++azimuthal) {
+        // Locates the voxel center, and differentiates the polar angle there.
+        const double radius =
+            sphere_max_radius - (radial - 0.5) * grid.deltaRadius();
+        const double tan_polar = std::tan((polar + 0.5) * grid.deltaTheta());
+        const double tan_azimuthal =
+            std::tan((azimuthal + 0.5) * grid.deltaPhi());
+        const double x = radius / std::sqrt(1.0 + tan_polar * tan_polar +
+                                            tan_azimuthal * tan_azimuthal);
+        const double y = x * tan_polar;
+        const FreeVec3 expected(-y / (x * x + y * y), x / (x * x + y * y),
+                                0.0);
+        const FreeVec3 gradient = gradients.gradient(radial, polar, azimuthal);
+        EXPECT_NEAR(gradient.x(), expected.x(), gradients.scale());
+        EXPECT_NEAR(gradient.y(), expected.y(), gradients.scale());
+        EXPECT_NEAR(gradient.z(), expected.z(), gradients.scale());
+      }
+    }
+  }
+}
+
+TEST(SphericalGradientField, SamplesPairValuesWithVoxelGradient) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  std::vector<double> values(4 * 4 * 4);
+  std::iota(values.begin(), values.end(), 0.0);
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::SphericalGradientField gradients(field);
+  const Ray ray(BoundVec3(-13.0, -12.0, -11.0), UnitVec3(1.0, 1.1, 1.2));
+  const std::vector<svr::SphericalVoxel> voxels =
+      svr::walkSphericalVolume(ray, grid, 0.0, 100.0);
+  ASSERT_FALSE(voxels.empty());
+  std::vector<svr::VoxelSample> samples(3);
+  std::vector<svr::FieldSample> field_samples(3);
+  for (const svr::SphericalVoxel &voxel : voxels) {
+    svr::sampleVoxel(ray, grid, voxel, 3, samples.data());
+    gradients.sample(voxel, samples.data(), 3, field_samples.data());
+    for (std::size_t i = 0; i < 3; ++i) {
+      EXPECT_DOUBLE_EQ(field_samples[i].value, field.interpolate(samples[i]));
+      EXPECT_EQ(field_samples[i].gradient, gradients.gradient(voxel));
+    }
+  }
+}
+
+TEST(PreIntegrationTable, ConstantTransferFunction) {
+  const svr::TransferFunction transfer_function = {
+      .min_value = 0.0,
+      .max_value = 1.0,
+      .control_points = {
+          {.red = 0.25, .green = 0.5, .blue = 1.0, .alpha = 0.3}}};
+  const svr::PreIntegrationParameters parameters = {
+      .num_scalar_samples = 4,
+      .num_length_samples = 5,
+      .max_segment_length = 2.0,
+      .num_integration_steps = 8,
+      .num_threads = 2};
+  const svr::PreIntegrationTable table(transfer_function, parameters);
+  // The integral of a homogeneous medium is exact at the table's lengths,
+  // including for segments composited from pieces of the maximum length.
+  // Between the table's lengths, it is interpolated linearly.
+  const std::vector<std::pair<double, double>> lengths_and_errors = {
+      {0.0, 1e-12}, {0.5, 1e-12}, {2.0, 1e-12}, {6.0, 1e-12},
+      {1.3, 1e-2},  {7.5, 1e-2}};
+  for (const auto &length_and_error : lengths_and_errors) {
+    const double length = length_and_error.first;
+    const double abs_error = length_and_error.second;
+    const double alpha = 1.0 - std::exp(-0.3 * length);
+    const svr::RGBA color = table.lookup(0.2, 0.9, length);
+    EXPECT_NEAR(color.alpha, alpha, abs_error);
+    EXPECT_NEAR(color.red, 0.25 * alpha, abs_error);
+    EXPECT_NEAR(color.green, 0.5 * alpha, abs_error);
+    EXPECT_NEAR(color.blue, 1.0 * alpha, abs_error);
+  }
+}
+
+TEST(PreIntegrationTable, InvalidMaxSegmentLength) {
+  const svr::TransferFunction transfer_function = {
+      .min_value = 0.0,
+      .max_value = 1.0,
+      .control_points = {
+          {.red = 0.25, .green = 0.5, .blue = 1.0, .alpha = 0.3}}};
+  // A maximum segment length that is not positive and finite is replaced by
+  // a length of 1, so lookups of long segments still terminate.
+  for (const double max_segment_length :
+       {0.0, -2.0, std::numeric_limits<double>::quiet_NaN(),
+        std::numeric_limits<double>::infinity()}) {
+    const svr::PreIntegrationParameters parameters = {
+        .num_scalar_samples = 4,
+        .num_length_samples = 5,
+        .max_segment_length = max_segment_length,
+        .num_integration_steps = 8,
+        .num_threads = 1};
+    const svr::PreIntegrationTable table(transfer_function, parameters);
+    for (const double length : {0.5, 1.0, 3.0}) {
+      EXPECT_NEAR(table.lookup(0.2, 0.9, length).alpha,
+                  1.0 - std::exp(-0.3 * length), 1e-12);
+    }
+    // The number of pieces of a very long segment is capped.
+    EXPECT_NEAR(table.lookup(0.2, 0.9, 1e300).alpha, 1.0, 1e-12);
+    EXPECT_NEAR(
+        table.lookup(0.2, 0.9, std::numeric_limits<double>::infinity()).alpha,
+        1.0, 1e-12);
+  }
+}
+
+TEST(PreIntegrationTable, MatchesOversampledIntegral) {
+  const svr::TransferFunction transfer_function = {
+      .min_value = -1.0,
+      .max_value = 1.0,
+      .control_points = {{.red = 1.0, .green = 0.0, .blue = 0.0, .alpha = 0.0},
+                         {.red = 0.0, .green = 1.0, .blue = 0.0, .alpha = 2.0},
+                         {.red = 0.0, .green = 0.0, .blue = 1.0,
+                          .alpha = 0.5}}};
+  const svr::PreIntegrationParameters parameters = {
+      .num_scalar_samples = 129,
+      .num_length_samples = 33,
+      .max_segment_length = 1.0,
+      .num_integration_steps = 64,
+      .num_threads = 0};
+  const svr::PreIntegrationTable table(transfer_function, parameters);
+  // Composites the segment with many small steps.
+  const auto oversampled = [&](double front_value, double back_value,
+                               double length) -> svr::RGBA {
+    svr::RGBA color = {.red = 0.0, .green = 0.0, .blue = 0.0, .alpha = 0.0};
+    const std::size_t num_steps = 10000;
+    for (std::size_t i = 0; i < num_steps; ++i) {
+      const double w = (i + 0.5) / num_steps;
+      const double value = front_value + (back_value - front_value) * w;
+      const double position = value + 1.0;
+      const std::size_t lower = std::min(static_cast<std::size_t>(position),
+                                         std::size_t{1});
+      const double weight = position - lower;
+      const svr::RGBA &a = transfer_function.control_points[lower];
+      const svr::RGBA &b = transfer_function.control_points[lower + 1];
+      const double alpha =
+          1.0 - std::exp(-(a.alpha + (b.alpha - a.alpha) * weight) * length /
+                         num_steps);
+      const double transmittance = 1.0 - color.alpha;
+      color.red += transmittance * alpha * (a.red + (b.red - a.red) * weight);
+      color.green +=
+          transmittance * alpha * (a.green + (b.green - a.green) * weight);
+      color.blue +=
+          transmittance * alpha * (a.blue + (b.blue - a.blue) * weight);
+      color.alpha += transmittance * alpha;
+    }
+    return color;
+  };
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> value_distribution(-1.0, 1.0);
+  std::uniform_real_distribution<double> length_distribution(0.0, 2.5);
+  for (std::size_t i = 0; i < 100; ++i) {
+    const double front_value = value_distribution(generator);
+    const double back_value = value_distribution(generator);
+    const double length = length_distribution(generator);
+    const svr::RGBA expected = oversampled(front_value, back_value, length);
+    const svr::RGBA actual = table.lookup(front_value, back_value, length);
+    EXPECT_NEAR(actual.red, expected.red, 1e-2);
+    EXPECT_NEAR(actual.green, expected.green, 1e-2);
+    EXPECT_NEAR(actual.blue, expected.blue, 1e-2);
+    EXPECT_NEAR(actual.alpha, expected.alpha, 1e-2);
+  }
+}
+
+TEST(PreIntegrationCache, ReturnsCachedTable) {
+  svr::TransferFunction transfer_function = {
+      .min_value = 0.0,
+      .max_value = 1.0,
+      .control_points = {{.red = 1.0, .green = 1.0, .blue = 1.0, .alpha = 0.0},
+                         {.red = 1.0, .green = 1.0, .blue = 1.0,
+                          .alpha = 1.0}}};
+  svr::PreIntegrationParameters parameters = {.num_scalar_samples = 8,
+                                              .num_length_samples = 4,
+                                              .max_segment_length = 1.0,
+                                              .num_integration_steps = 4,
+                                              .num_threads = 1};
+  svr::PreIntegrationCache cache;
+  const auto table = cache.table(transfer_function, parameters);
+  parameters.num_threads = 4;
+  EXPECT_EQ(cache.table(transfer_function, parameters), table);
+  transfer_function.control_points.back().alpha = 2.0;
+  const auto other_table = cache.table(transfer_function, parameters);
+  EXPECT_NE(other_table, table);
+  cache.clear();
+  EXPECT_NE(cache.table(transfer_function, parameters), other_table);
+  EXPECT_NEAR(table->lookup(1.0, 1.0, 1.0).alpha, 1.0 - std::exp(-1.0),
+              1e-12);
+}
+
+TEST(CompositeFrontToBack, WindowMatchesVoxels) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 6, 5,
+                                     sphere_center);
+  std::vector<double> values(4 * 6 * 5);
+  std::iota(values.begin(), values.end(), 0.0);
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::TransferFunction transfer_function = {
+      .min_value = 0.0,
+      .max_value = 119.0,
+      .control_points = {
+          {.red = 1.0, .green = 0.0, .blue = 0.0, .alpha = 0.01},
+          {.red = 0.0, .green = 0.0, .blue = 1.0, .alpha = 0.2}}};
+  const svr::PreIntegrationParameters parameters = {
+      .num_scalar_samples = 64,
+      .num_length_samples = 16,
+      .max_segment_length = 5.0,
+      .num_integration_steps = 16,
+      .num_threads = 0};
+  const svr::PreIntegrationTable table(transfer_function, parameters);
+  const Ray ray(BoundVec3(-13.0, -12.0, -11.0), UnitVec3(1.0, 1.1, 1.2));
+  const std::vector<svr::SphericalVoxel> voxels =
+      svr::walkSphericalVolume(ray, grid, 0.0, 100.0);
+  ASSERT_FALSE(voxels.empty());
+  const svr::RGBA expected =
+      svr::compositeFrontToBack(ray, field, table, voxels);
+  const svr::RGBA actual =
+      svr::compositeFrontToBack(ray, field, table, 0.0, 100.0);
+  EXPECT_GT(expected.alpha, 0.0);
+  EXPECT_DOUBLE_EQ(actual.red, expected.red);
+  EXPECT_DOUBLE_EQ(actual.green, expected.green);
+  EXPECT_DOUBLE_EQ(actual.blue, expected.blue);
+  EXPECT_DOUBLE_EQ(actual.alpha, expected.alpha);
+
+  // The traversal ends once the opacity reaches max_alpha.
+  const svr::RGBA terminated = svr::compositeFrontToBack(
+      ray, field, table, 0.0, 100.0, 0.5 * expected.alpha);
+  EXPECT_GE(terminated.alpha, 0.5 * expected.alpha);
+  EXPECT_LT(terminated.alpha, expected.alpha);
+}
+
+TEST(CompositeFrontToBack, PipelineMatchesEachRay) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 6, 5,
+                                     sphere_center);
+  std::vector<double> values(4 * 6 * 5);
+  std::iota(values.begin(), values.end(), 0.0);
+  const svr::SphericalVoxelField field(grid, values);
+  const svr::TransferFunction transfer_function = {
+      .min_value = 0.0,
+      .max_value = 119.0,
+      .control_points = {
+          {.red = 1.0, .green = 0.0, .blue = 0.0, .alpha = 0.01},
+          {.red = 0.0, .green = 0.0, .blue = 1.0, .alpha = 0.2}}};
+  const svr::PreIntegrationParameters parameters = {
+      .num_scalar_samples = 64,
+      .num_length_samples = 16,
+      .max_segment_length = 5.0,
+      .num_integration_steps = 16,
+      .num_threads = 0};
+  const svr::PreIntegrationTable table(transfer_function, parameters);
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  RayBatch rays;
+  for (std::size_t i = 0; i < 500; ++i) {
+    rays.push_back(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        FreeVec3(direction(generator), direction(generator),
+                 direction(generator)));
+  }
+  // A single segment per batch and small ring buffers exercise backpressure.
+  for (const svr::PipelineParameters &pipeline :
+       {svr::PipelineParameters{.num_traversal_threads = 1,
+                                .num_shading_threads = 1,
+                                .batch_size = 64,
+                                .queue_capacity = 1024},
+        svr::PipelineParameters{.num_traversal_threads = 2,
+                                .num_shading_threads = 3,
+                                .batch_size = 1,
+                                .queue_capacity = 2}}) {
+    for (const double max_alpha : {1.0, 0.3}) {
+      const std::vector<svr::RGBA> colors = svr::compositeFrontToBack(
+          rays, field, table, 0.0, 30.0, max_alpha, pipeline);
+      ASSERT_EQ(colors.size(), rays.size());
+      for (std::size_t i = 0; i < rays.size(); ++i) {
+        const svr::RGBA expected = svr::compositeFrontToBack(
+            rays.ray(i), field, table, 0.0, 30.0, max_alpha);
+        EXPECT_EQ(colors[i].red, expected.red);
+        EXPECT_EQ(colors[i].green, expected.green);
+        EXPECT_EQ(colors[i].blue, expected.blue);
+        EXPECT_EQ(colors[i].alpha, expected.alpha);
+      }
+    }
+  }
+}
+
+TEST(LocatePoints, MatchesFirstVoxelOfTraversal) {
+  const BoundVec3 sphere_center(1.0, -2.0, 0.5);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 16, 12, 20,
+                                     sphere_center);
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> coordinate(-7.0, 7.0);
+  std::vector<double> points;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    points.push_back(sphere_center.x() + coordinate(generator));
+    points.push_back(sphere_center.y() + coordinate(generator));
+    points.push_back(sphere_center.z() + coordinate(generator));
+  }
+  std::vector<int> voxels(points.size());
+  svr::locatePoints(points.data(), points.size() / 3, grid, voxels.data());
+  for (std::size_t i = 0; i < points.size(); i += 3) {
+    const BoundVec3 point(points[i], points[i + 1], points[i + 2]);
+    const FreeVec3 center_to_point = point - sphere_center;
+    if (center_to_point.dot(center_to_point) >=
+        sphere_max_radius * sphere_max_radius) {
+      EXPECT_THAT(std::vector<int>(voxels.begin() + i, voxels.begin() + i + 3),
+                  testing::Each(-1));
+      continue;
+    }
+    const auto traversal = svr::walkSphericalVolume(
+        Ray(point, UnitVec3(0.0, 0.0, 1.0)), grid, /*max_t=*/1.0);
+    ASSERT_FALSE(traversal.empty());
+    EXPECT_EQ(voxels[i], traversal.front().radial);
+    EXPECT_EQ(voxels[i + 1], traversal.front().polar);
+    EXPECT_EQ(voxels[i + 2], traversal.front().azimuthal);
+  }
+}
+
+TEST(LocatePoints, PointsOnBoundaries) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  const std::vector<double> points = {5.0,  0.0, 0.0, 0.0,  5.0, 0.0,
+                                      -1.0, 0.0, 0.0, 0.0,  0.0, 0.0,
+                                      0.0,  0.0, -7.5};
+  std::vector<int> voxels(points.size());
+  svr::locatePoints(points.data(), points.size() / 3, grid, voxels.data());
+  const std::vector<int> expected_voxels = {2, 0, 0, 2, 0, 0, 4, 1,
+                                            1, 4, 0, 0, 1, 0, 2};
+  EXPECT_THAT(voxels, testing::ContainerEq(expected_voxels));
+}
+
+TEST(LocatePoints, PointsOutsideGrid) {
+  const BoundVec3 sphere_center(0.0, 0.0, 0.0);
+  const double sphere_max_radius = 10.0;
+  const svr::SphereBound max_bound = {
+      .radial = sphere_max_radius, .polar = M_PI, .azimuthal = M_PI};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     sphere_center);
+  const std::vector<double> points = {10.0, 0.0,  0.0, 1.0, -1.0, 1.0,
+                                      1.0,  1.0, -1.0, 1.0, 1.0,  1.0};
+  std::vector<int> voxels(points.size());
+  svr::locatePoints(points.data(), points.size() / 3, grid, voxels.data());
+  const std::vector<int> expected_voxels = {-1, -1, -1, -1, -1, -1,
+                                            -1, -1, -1, 4,  0,  0};
+  EXPECT_THAT(voxels, testing::ContainerEq(expected_voxels));
+}
+
+TEST(SphericalVoxelGrid, CopiesShareTables) {
+  const svr::SphereBound max_bound = {
+      .radial = 10.0, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 8, 6,
+                                     BoundVec3(0.0, 0.0, 0.0));
+  const svr::SphericalVoxelGrid copy = grid;
+  EXPECT_EQ(copy.tables(), grid.tables());
+  EXPECT_EQ(copy.pMaxPolar().data(), grid.pMaxPolar().data());
+  // Grids may be stored by value and assigned.
+  std::vector<svr::SphericalVoxelGrid> grids(3, grid);
+  EXPECT_EQ(grid.tables().use_count(), 5);
+  grids[1] = svr::SphericalVoxelGrid(MIN_BOUND, max_bound, 2, 2, 2,
+                                     BoundVec3(1.0, 0.0, 0.0));
+  EXPECT_EQ(grids[1].numRadialSections(), std::size_t{2});
+  EXPECT_NE(grids[1].tables(), grid.tables());
+  svr::SphericalVoxelGrid moved = std::move(grids[0]);
+  EXPECT_EQ(moved.tables(), grid.tables());
+  EXPECT_EQ(grid.tables().use_count(), 4);
+  // A grid constructed with the tables of another traverses identically.
+  const svr::SphericalVoxelGrid shared(MIN_BOUND, max_bound, 4, 8, 6,
+                                       BoundVec3(0.0, 0.0, 0.0),
+                                       grid.tables());
+  const Ray ray(BoundVec3(-13.0, -13.0, -13.0), UnitVec3(1.0, 1.0, 1.0));
+  const auto expected = svr::walkSphericalVolume(ray, grid, 1.0);
+  ASSERT_FALSE(expected.empty());
+  const std::vector<const svr::SphericalVoxelGrid *> others = {
+      &moved, &grids[2], &shared};
+  for (const svr::SphericalVoxelGrid *other : others) {
+    const auto actual = svr::walkSphericalVolume(ray, *other, 1.0);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(actual[i].radial, expected[i].radial);
+      EXPECT_EQ(actual[i].polar, expected[i].polar);
+      EXPECT_EQ(actual[i].azimuthal, expected[i].azimuthal);
+      EXPECT_EQ(actual[i].enter_t, expected[i].enter_t);
+      EXPECT_EQ(actual[i].exit_t, expected[i].exit_t);
+    }
+  }
+}
+
+TEST(GridFile, RoundTripsGridAndSections) {
+  const BoundVec3 sphere_center(0.5, -1.0, 2.0);
+  const svr::SphereBound min_bound = {
+      .radial = 1.0, .polar = 0.25, .azimuthal = 0.5};
+  const svr::SphereBound max_bound = {
+      .radial = 10.0, .polar = M_PI, .azimuthal = 1.5 * M_PI};
+  const svr::SphericalVoxelGrid grid(min_bound, max_bound, 6, 5, 7,
+                                     sphere_center);
+  std::vector<double> values(6 * 5 * 7);
+  std::iota(values.begin(), values.end(), 0.0);
+  const std::vector<std::uint8_t> flags = {1, 0, 1};
+  const std::string path = testing::TempDir() + "svr_grid_file_test.svrg";
+  ASSERT_TRUE(svr::writeGridFile(
+      path, grid,
+      {{"values", values.data(), values.size() * sizeof(double)},
+       {"flags", flags.data(), flags.size()},
+       {"empty", nullptr, 0}}));
+  svr::MappedGridFile file(path);
+  ASSERT_TRUE(file.valid());
+  const svr::SphericalVoxelGrid &mapped_grid = file.grid();
+  EXPECT_EQ(mapped_grid.numRadialSections(), grid.numRadialSections());
+  EXPECT_EQ(mapped_grid.numPolarSections(), grid.numPolarSections());
+  EXPECT_EQ(mapped_grid.numAzimuthalSections(), grid.numAzimuthalSections());
+  EXPECT_EQ(mapped_grid.sphereMinRadius(), grid.sphereMinRadius());
+  EXPECT_EQ(mapped_grid.deltaRadius(), grid.deltaRadius());
+  EXPECT_EQ(mapped_grid.deltaTheta(), grid.deltaTheta());
+  EXPECT_EQ(mapped_grid.deltaPhi(), grid.deltaPhi());
+  EXPECT_THAT(mapped_grid.deltaRadiiSquared(),
+              testing::ElementsAreArray(grid.deltaRadiiSquared().begin(),
+                                        grid.deltaRadiiSquared().end()));
+  for (std::size_t i = 0; i <= grid.numPolarSections(); ++i) {
+    EXPECT_EQ(mapped_grid.polarTrigValues()[i].sine,
+              grid.polarTrigValues()[i].sine);
+    EXPECT_EQ(mapped_grid.pMaxPolar(i).P2, grid.pMaxPolar(i).P2);
+    EXPECT_EQ(mapped_grid.centerToPolarBound(i).y(),
+              grid.centerToPolarBound(i).y());
+  }
+  for (std::size_t i = 0; i <= grid.numAzimuthalSections(); ++i) {
+    EXPECT_EQ(mapped_grid.azimuthalTrigValues()[i].cosine,
+              grid.azimuthalTrigValues()[i].cosine);
+    EXPECT_EQ(mapped_grid.pMaxAzimuthal(i).P1, grid.pMaxAzimuthal(i).P1);
+    EXPECT_EQ(mapped_grid.centerToAzimuthalBound(i).z(),
+              grid.centerToAzimuthalBound(i).z());
+  }
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> origin(-15.0, 15.0);
+  std::uniform_real_distribution<double> direction(-1.0, 1.0);
+  for (std::size_t i = 0; i < 50; ++i) {
+    const Ray ray(
+        BoundVec3(origin(generator), origin(generator), origin(generator)),
+        UnitVec3(FreeVec3(direction(generator), direction(generator),
+                          direction(generator))));
+    const auto expected = svr::walkSphericalVolume(ray, grid, 1.0);
+    const auto actual = svr::walkSphericalVolume(ray, mapped_grid, 1.0);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (std::size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(actual[j].radial, expected[j].radial);
+      EXPECT_EQ(actual[j].polar, expected[j].polar);
+      EXPECT_EQ(actual[j].azimuthal, expected[j].azimuthal);
+      EXPECT_EQ(actual[j].enter_t, expected[j].enter_t);
+      EXPECT_EQ(actual[j].exit_t, expected[j].exit_t);
+    }
+  }
+  // The grid's own sections are not listed.
+  ASSERT_EQ(file.sections().size(), std::size_t{3});
+  EXPECT_EQ(file.sections()[0].name, "values");
+  std::size_t count;
+  const double *mapped_values = file.sectionArray<double>("values", count);
+  ASSERT_NE(mapped_values, nullptr);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mapped_values) % 64, 0u);
+  EXPECT_EQ(std::vector<double>(mapped_values, mapped_values + count), values);
+  const std::uint8_t *mapped_flags =
+      file.sectionArray<std::uint8_t>("flags", count);
+  ASSERT_NE(mapped_flags, nullptr);
+  EXPECT_EQ(std::vector<std::uint8_t>(mapped_flags, mapped_flags + count),
+            flags);
+  ASSERT_NE(file.section("empty"), nullptr);
+  EXPECT_EQ(file.section("empty")->size, std::size_t{0});
+  EXPECT_EQ(file.section("missing"), nullptr);
+  EXPECT_EQ(file.sectionArray<double>("flags", count), nullptr);
+  // Moving the file keeps its grid and sections in place.
+  const svr::MappedGridFile moved(std::move(file));
+  EXPECT_FALSE(file.valid());
+  ASSERT_TRUE(moved.valid());
+  EXPECT_EQ(&moved.grid(), &mapped_grid);
+  EXPECT_EQ(moved.sectionArray<double>("values", count), mapped_values);
+  std::remove(path.c_str());
+}
+
+TEST(GridFile, GridReadsTablesInPlace) {
+  const svr::SphereBound max_bound = {
+      .radial = 10.0, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 6, 5,
+                                     BoundVec3(1.0, -2.0, 3.0));
+  const std::string path = testing::TempDir() + "svr_grid_file_tables.svrg";
+  ASSERT_TRUE(svr::writeGridFile(path, grid));
+  svr::SphericalVoxelGrid copy = grid;
+  {
+    const svr::MappedGridFile file(path);
+    ASSERT_TRUE(file.valid());
+    // Each table begins a section of the file.
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(
+                  file.grid().centerToPolarBounds().data()) % 64,
+              0u);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(
+                  file.grid().pMaxAzimuthal().data()) % 64,
+              0u);
+    copy = file.grid();
+  }
+  // The copy keeps the tables of the file alive once the file is released.
+  std::remove(path.c_str());
+  for (std::size_t i = 0; i <= grid.numPolarSections(); ++i) {
+    EXPECT_EQ(copy.centerToPolarBound(i).x(), grid.centerToPolarBound(i).x());
+    EXPECT_EQ(copy.centerToPolarBound(i).y(), grid.centerToPolarBound(i).y());
+  }
+  for (std::size_t i = 0; i <= grid.numAzimuthalSections(); ++i) {
+    EXPECT_EQ(copy.centerToAzimuthalBound(i).z(),
+              grid.centerToAzimuthalBound(i).z());
+  }
+  const Ray ray(BoundVec3(-13.0, -17.0, -15.0),
+                UnitVec3(FreeVec3(1.0, 1.0, 1.0)));
+  const auto expected = svr::walkSphericalVolume(ray, grid, 1.0);
+  const auto actual = svr::walkSphericalVolume(ray, copy, 1.0);
+  ASSERT_EQ(actual.size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(actual[i].radial, expected[i].radial);
+    EXPECT_EQ(actual[i].polar, expected[i].polar);
+    EXPECT_EQ(actual[i].azimuthal, expected[i].azimuthal);
+  }
+}
+
+TEST(GridFile, ConcurrentWritersProduceAValidFile) {
+  const svr::SphereBound max_bound = {
+      .radial = 10.0, .polar = TAU, .azimuthal = TAU};
+  const std::string path = testing::TempDir() + "svr_grid_file_writers.svrg";
+  const std::size_t num_writers = 4;
+  std::vector<std::thread> writers;
+  std::atomic<std::size_t> num_written(0);
+  for (std::size_t i = 0; i < num_writers; ++i) {
+    writers.emplace_back([&, i]() {
+      // Each writer writes a grid of its own number of radial sections.
+      const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, i + 1, 4, 4,
+                                         BoundVec3(0.0, 0.0, 0.0));
+      for (std::size_t j = 0; j < 20; ++j) {
+        num_written += svr::writeGridFile(path, grid);
+      }
+    });
+  }
+  for (std::thread &writer : writers) writer.join();
+  EXPECT_EQ(num_written, 20 * num_writers);
+  const svr::MappedGridFile file(path);
+  ASSERT_TRUE(file.valid());
+  EXPECT_GE(file.grid().numRadialSections(), std::size_t{1});
+  EXPECT_LE(file.grid().numRadialSections(), num_writers);
+  EXPECT_EQ(file.grid().deltaRadiiSquared().size(),
+            file.grid().numRadialSections() + 1);
+  std::remove(path.c_str());
+}
+
+TEST(GridFile, RejectsInvalidFiles) {
+  const svr::SphereBound max_bound = {
+      .radial = 10.0, .polar = TAU, .azimuthal = TAU};
+  const svr::SphericalVoxelGrid grid(MIN_BOUND, max_bound, 4, 4, 4,
+                                     BoundVec3(0.0, 0.0, 0.0));
+  const std::string path = testing::TempDir() + "svr_grid_file_invalid.svrg";
+  EXPECT_FALSE(svr::MappedGridFile(path + ".missing").valid());
+  const int value = 0;
+  EXPECT_FALSE(svr::writeGridFile(path, grid, {{"svr.grid", &value, 4}}));
+  EXPECT_FALSE(svr::writeGridFile(
+      path, grid, {{"value", &value, 4}, {"value", &value, 4}}));
+  ASSERT_TRUE(svr::writeGridFile(path, grid));
+  ASSERT_TRUE(svr::MappedGridFile(path).valid());
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  std::vector<char> contents;
+  char byte;
+  while (std::fread(&byte, 1, 1, file) == 1) contents.push_back(byte);
+  std::fclose(file);
+  const auto write = [&](const std::vector<char> &bytes) {
+    std::FILE *output = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, bytes.size(), output);
+    std::fclose(output);
+  };
+  // Truncated within the tables.
+  write(std::vector<char>(contents.begin(), contents.end() - 8));
+  EXPECT_FALSE(svr::MappedGridFile(path).valid());
+  // Another magic number.
+  std::vector<char> corrupted = contents;
+  corrupted[0] = 'X';
+  write(corrupted);
+  EXPECT_FALSE(svr::MappedGridFile(path).valid());
+  // Another byte order.
+  corrupted = contents;
+  std::swap(corrupted[12], corrupted[15]);
+  write(corrupted);
+  EXPECT_FALSE(svr::MappedGridFile(path).valid());
+  write(std::vector<char>());
+  EXPECT_FALSE(svr::MappedGridFile(path).valid());
+  std::remove(path.c_str());
+}
+
 }  // namespace
@@ -0,0 +1,418 @@
+#include "transfer_function.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <system_error>
+#include <thread>
+
+#include "parallel_util.h"
+
+namespace svr {
+
+namespace {
+
+// The maximum number of pieces from which PreIntegrationTable::lookup()
+// composites a segment longer than the table's maximum segment length.
+constexpr double MAX_NUM_SEGMENT_PIECES = 1024.0;
+
+// The maximum segment length used if the given one is not positive and finite.
+constexpr double DEFAULT_MAX_SEGMENT_LENGTH = 1.0;
+
+// Linearly interpolates between a and b with weight w of b.
+inline RGBA interpolateRGBA(const RGBA &a, const RGBA &b, double w) noexcept {
+  return {.red = a.red + (b.red - a.red) * w,
+          .green = a.green + (b.green - a.green) * w,
+          .blue = a.blue + (b.blue - a.blue) * w,
+          .alpha = a.alpha + (b.alpha - a.alpha) * w};
+}
+
+// Composites the premultiplied 'back' behind the premultiplied 'front'.
+inline void compositeBehind(RGBA &front, const RGBA &back) noexcept {
+  const double transmittance = 1.0 - front.alpha;
+  front.red += transmittance * back.red;
+  front.green += transmittance * back.green;
+  front.blue += transmittance * back.blue;
+  front.alpha += transmittance * back.alpha;
+}
+
+// Returns the position of the value within [0, num_samples - 1], where 0 and
+// num_samples - 1 correspond to the minimum and maximum values respectively.
+inline double samplePosition(double value, double min_value,
+                             double value_range,
+                             std::size_t num_samples) noexcept {
+  if (!(value_range > 0.0)) return 0.0;
+  const double normalized =
+      std::min(std::max((value - min_value) / value_range, 0.0), 1.0);
+  return normalized * static_cast<double>(num_samples - 1);
+}
+
+// Returns the lower index of the two samples surrounding the given position,
+// and stores the weight of the upper sample in 'weight'.
+inline std::size_t lowerSample(double position, std::size_t num_samples,
+                               double &weight) noexcept {
+  const std::size_t lower =
+      std::min(static_cast<std::size_t>(position), num_samples - 2);
+  weight = position - static_cast<double>(lower);
+  return lower;
+}
+
+// Returns the RGBA of the transfer function at the given value.
+inline RGBA classify(const TransferFunction &transfer_function,
+                     double value) noexcept {
+  const std::vector<RGBA> &points = transfer_function.control_points;
+  if (points.size() == 1) return points.front();
+  double weight;
+  const std::size_t lower = lowerSample(
+      samplePosition(value, transfer_function.min_value,
+                     transfer_function.max_value - transfer_function.min_value,
+                     points.size()),
+      points.size(), weight);
+  return interpolateRGBA(points[lower], points[lower + 1], weight);
+}
+
+// Integrates the emission and absorption along a segment of the given length,
+// along which the value varies linearly from front_value to back_value. Uses
+// the midpoint rule with num_steps steps.
+inline RGBA integrateSegment(const TransferFunction &transfer_function,
+                             double front_value, double back_value,
+                             double length, std::size_t num_steps) noexcept {
+  RGBA integral = {.red = 0.0, .green = 0.0, .blue = 0.0, .alpha = 0.0};
+  const double step_length = length / static_cast<double>(num_steps);
+  for (std::size_t i = 0; i < num_steps; ++i) {
+    const double w =
+        (static_cast<double>(i) + 0.5) / static_cast<double>(num_steps);
+    const RGBA medium = classify(transfer_function,
+                                 front_value + (back_value - front_value) * w);
+    const double alpha = 1.0 - std::exp(-medium.alpha * step_length);
+    compositeBehind(integral, {.red = medium.red * alpha,
+                               .green = medium.green * alpha,
+                               .blue = medium.blue * alpha,
+                               .alpha = alpha});
+  }
+  return integral;
+}
+
+// The segment of a ray within a voxel, as passed from a traversal thread to a
+// shading thread. 'first' marks the first segment of the ray.
+struct VoxelSegment {
+  std::size_t ray;
+  double enter_t;
+  double exit_t;
+  bool first;
+};
+
+// The states of the threads of a pipeline, which wait until every thread of
+// the pipeline has been created.
+enum PipelineState {
+  PIPELINE_STARTING = 0,
+  PIPELINE_RUNNING = 1,
+  PIPELINE_CANCELLED = 2
+};
+
+}  // namespace
+
+PreIntegrationTable::PreIntegrationTable(
+    const TransferFunction &transfer_function,
+    const PreIntegrationParameters &parameters) noexcept
+    : min_value_(transfer_function.min_value),
+      value_range_(transfer_function.max_value - transfer_function.min_value),
+      num_scalar_samples_(std::max(parameters.num_scalar_samples,
+                                   std::size_t{2})),
+      num_length_samples_(std::max(parameters.num_length_samples,
+                                   std::size_t{2})),
+      max_segment_length_(parameters.max_segment_length > 0.0 &&
+                                  std::isfinite(parameters.max_segment_length)
+                              ? parameters.max_segment_length
+                              : DEFAULT_MAX_SEGMENT_LENGTH),
+      table_(num_length_samples_ * num_scalar_samples_ * num_scalar_samples_) {
+  const std::size_t num_steps =
+      std::max(parameters.num_integration_steps, std::size_t{1});
+  // Each row holds the entries of a single length and front value.
+  const std::size_t num_rows = num_length_samples_ * num_scalar_samples_;
+  parallelFor(num_rows, parameters.num_threads, [&](std::size_t row) {
+    const double length =
+        max_segment_length_ * static_cast<double>(row / num_scalar_samples_) /
+        static_cast<double>(num_length_samples_ - 1);
+    const double front_value =
+        min_value_ + value_range_ *
+                         static_cast<double>(row % num_scalar_samples_) /
+                         static_cast<double>(num_scalar_samples_ - 1);
+    for (std::size_t back = 0; back < num_scalar_samples_; ++back) {
+      const double back_value =
+          min_value_ + value_range_ * static_cast<double>(back) /
+                           static_cast<double>(num_scalar_samples_ - 1);
+      table_[row * num_scalar_samples_ + back] = integrateSegment(
+          transfer_function, front_value, back_value, length, num_steps);
+    }
+  });
+}
+
+RGBA PreIntegrationTable::lookup(double front_value, double back_value,
+                                 double length) const noexcept {
+  if (length <= max_segment_length_) {
+    return this->lookupWithinTable(front_value, back_value, length);
+  }
+  const double num_pieces =
+      std::min(std::ceil(length / max_segment_length_), MAX_NUM_SEGMENT_PIECES);
+  const double piece_length = length / num_pieces;
+  RGBA integral = {.red = 0.0, .green = 0.0, .blue = 0.0, .alpha = 0.0};
+  double piece_front_value = front_value;
+  for (double i = 1.0; i <= num_pieces; ++i) {
+    const double piece_back_value =
+        front_value + (back_value - front_value) * (i / num_pieces);
+    compositeBehind(integral, this->lookupWithinTable(piece_front_value,
+                                                      piece_back_value,
+                                                      piece_length));
+    piece_front_value = piece_back_value;
+  }
+  return integral;
+}
+
+RGBA PreIntegrationTable::lookupWithinTable(double front_value,
+                                            double back_value,
+                                            double length) const noexcept {
+  double front_weight, back_weight, length_weight;
+  const std::size_t front = lowerSample(
+      samplePosition(front_value, min_value_, value_range_,
+                     num_scalar_samples_),
+      num_scalar_samples_, front_weight);
+  const std::size_t back = lowerSample(
+      samplePosition(back_value, min_value_, value_range_,
+                     num_scalar_samples_),
+      num_scalar_samples_, back_weight);
+  const std::size_t length_index = lowerSample(
+      samplePosition(length, 0.0, max_segment_length_, num_length_samples_),
+      num_length_samples_, length_weight);
+  // Bilinearly interpolates the front and back values at the given length.
+  const auto bilinear = [&](std::size_t l) -> RGBA {
+    return interpolateRGBA(
+        interpolateRGBA(this->entry(front, back, l),
+                        this->entry(front, back + 1, l), back_weight),
+        interpolateRGBA(this->entry(front + 1, back, l),
+                        this->entry(front + 1, back + 1, l), back_weight),
+        front_weight);
+  };
+  return interpolateRGBA(bilinear(length_index), bilinear(length_index + 1),
+                         length_weight);
+}
+
+std::shared_ptr<const PreIntegrationTable> PreIntegrationCache::table(
+    const TransferFunction &transfer_function,
+    const PreIntegrationParameters &parameters) {
+  std::vector<double> key = {
+      transfer_function.min_value,
+      transfer_function.max_value,
+      static_cast<double>(parameters.num_scalar_samples),
+      static_cast<double>(parameters.num_length_samples),
+      parameters.max_segment_length,
+      static_cast<double>(parameters.num_integration_steps)};
+  key.reserve(key.size() + 4 * transfer_function.control_points.size());
+  for (const RGBA &point : transfer_function.control_points) {
+    key.insert(key.end(), {point.red, point.green, point.blue, point.alpha});
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_ptr<const PreIntegrationTable> &table = tables_[key];
+  if (table == nullptr) {
+    table = std::make_shared<const PreIntegrationTable>(transfer_function,
+                                                        parameters);
+  }
+  return table;
+}
+
+void PreIntegrationCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  tables_.clear();
+}
+
+RGBA compositeFrontToBack(const Ray &ray, const SphericalVoxelField &field,
+                          const PreIntegrationTable &table,
+                          const std::vector<SphericalVoxel> &voxels) noexcept {
+  RGBA color = {.red = 0.0, .green = 0.0, .blue = 0.0, .alpha = 0.0};
+  if (voxels.empty()) return color;
+  const SphericalVoxelGrid &grid = field.grid();
+  double front_value =
+      field.interpolate(sampleRay(ray, grid, voxels.front().enter_t));
+  for (const SphericalVoxel &voxel : voxels) {
+    const double back_value =
+        field.interpolate(sampleRay(ray, grid, voxel.exit_t));
+    compositeBehind(color, table.lookup(front_value, back_value,
+                                        voxel.exit_t - voxel.enter_t));
+    front_value = back_value;
+  }
+  return color;
+}
+
+RGBA compositeFrontToBack(const Ray &ray, const SphericalVoxelField &field,
+                          const PreIntegrationTable &table, double t_begin,
+                          double t_end, double max_alpha) noexcept {
+  RGBA color = {.red = 0.0, .green = 0.0, .blue = 0.0, .alpha = 0.0};
+  const SphericalVoxelGrid &grid = field.grid();
+  TraversalCursor cursor(ray, grid, t_begin, t_end);
+  SphericalVoxel voxel;
+  if (!cursor.next(voxel)) return color;
+  double front_value = field.interpolate(sampleRay(ray, grid, voxel.enter_t));
+  do {
+    if (cursor.hasNext()) field.prefetch(cursor.upcoming());
+    const double back_value =
+        field.interpolate(sampleRay(ray, grid, voxel.exit_t));
+    compositeBehind(color, table.lookup(front_value, back_value,
+                                        voxel.exit_t - voxel.enter_t));
+    front_value = back_value;
+  } while (color.alpha < max_alpha && cursor.next(voxel));
+  return color;
+}
+
+std::vector<RGBA> compositeFrontToBack(
+    const RayBatch &rays, const SphericalVoxelField &field,
+    const PreIntegrationTable &table, double t_begin, double t_end,
+    double max_alpha, const PipelineParameters &parameters) noexcept {
+  std::vector<RGBA> colors(
+      rays.size(), {.red = 0.0, .green = 0.0, .blue = 0.0, .alpha = 0.0});
+  const SphericalVoxelGrid &grid = field.grid();
+  const std::vector<std::size_t> ray_indices = raysIntersectingGrid(rays, grid);
+  if (ray_indices.empty()) return colors;
+  const std::size_t num_traversal_threads =
+      std::max(parameters.num_traversal_threads, std::size_t{1});
+  const std::size_t num_shading_threads =
+      std::max(parameters.num_shading_threads, std::size_t{1});
+  const std::size_t batch_size =
+      std::max(parameters.batch_size, std::size_t{1});
+
+  // The ring buffer from traversal thread t to shading thread s is
+  // queues[t * num_shading_threads + s]. The k-th intersecting ray is
+  // traversed by thread k % num_traversal_threads and shaded by thread
+  // k % num_shading_threads, so each ray is shaded in order by one thread.
+  std::vector<std::unique_ptr<SPSCRingBuffer<VoxelSegment>>> queues;
+  for (std::size_t i = 0; i < num_traversal_threads * num_shading_threads;
+       ++i) {
+    queues.emplace_back(new SPSCRingBuffer<VoxelSegment>(
+        std::max(parameters.queue_capacity, batch_size)));
+  }
+  // Set once a ray is opaque, so its traversal may end early.
+  std::unique_ptr<std::atomic<bool>[]> opaque(
+      new std::atomic<bool>[rays.size()]);
+  for (std::size_t i = 0; i < rays.size(); ++i) opaque[i] = false;
+  std::atomic<int> state(PIPELINE_STARTING);
+  const auto wait_until_running = [&]() -> bool {
+    int current;
+    while ((current = state.load(std::memory_order_acquire)) ==
+           PIPELINE_STARTING) {
+      std::this_thread::yield();
+    }
+    return current == PIPELINE_RUNNING;
+  };
+
+  const auto traverse = [&](std::size_t t) {
+    if (!wait_until_running()) return;
+    std::vector<std::vector<VoxelSegment>> pending(num_shading_threads);
+    for (std::vector<VoxelSegment> &segments : pending) {
+      segments.reserve(batch_size);
+    }
+    for (std::size_t k = t; k < ray_indices.size();
+         k += num_traversal_threads) {
+      const std::size_t i = ray_indices[k];
+      const std::size_t s = k % num_shading_threads;
+      SPSCRingBuffer<VoxelSegment> &queue =
+          *queues[t * num_shading_threads + s];
+      std::vector<VoxelSegment> &segments = pending[s];
+      TraversalCursor cursor(rays.ray(i), grid, t_begin, t_end);
+      SphericalVoxel voxel;
+      bool first = true;
+      while (cursor.next(voxel)) {
+        segments.push_back({.ray = i,
+                            .enter_t = voxel.enter_t,
+                            .exit_t = voxel.exit_t,
+                            .first = first});
+        first = false;
+        if (segments.size() == batch_size) {
+          queue.push(segments.data(), segments.size());
+          segments.clear();
+          if (opaque[i].load(std::memory_order_relaxed)) break;
+        }
+      }
+    }
+    for (std::size_t s = 0; s < num_shading_threads; ++s) {
+      SPSCRingBuffer<VoxelSegment> &queue =
+          *queues[t * num_shading_threads + s];
+      queue.push(pending[s].data(), pending[s].size());
+      queue.close();
+    }
+  };
+
+  const auto shade = [&](std::size_t s) {
+    if (!wait_until_running()) return;
+    std::vector<VoxelSegment> segments(batch_size);
+    std::vector<double> front_values(rays.size());
+    std::size_t current_ray = rays.size();
+    Ray ray = rays.ray(ray_indices.front());
+    std::size_t num_drained = 0;
+    std::vector<bool> drained(num_traversal_threads, false);
+    while (num_drained < num_traversal_threads) {
+      bool popped = false;
+      for (std::size_t t = 0; t < num_traversal_threads; ++t) {
+        if (drained[t]) continue;
+        SPSCRingBuffer<VoxelSegment> &queue =
+            *queues[t * num_shading_threads + s];
+        const std::size_t n = queue.tryPop(segments.data(), batch_size);
+        if (n == 0) {
+          if (queue.drained()) {
+            drained[t] = true;
+            ++num_drained;
+          }
+          continue;
+        }
+        popped = true;
+        for (std::size_t j = 0; j < n; ++j) {
+          const VoxelSegment &segment = segments[j];
+          RGBA &color = colors[segment.ray];
+          if (!segment.first && color.alpha >= max_alpha) continue;
+          if (segment.ray != current_ray) {
+            current_ray = segment.ray;
+            ray = rays.ray(current_ray);
+          }
+          double &front_value = front_values[segment.ray];
+          if (segment.first) {
+            front_value =
+                field.interpolate(sampleRay(ray, grid, segment.enter_t));
+          }
+          const double back_value =
+              field.interpolate(sampleRay(ray, grid, segment.exit_t));
+          compositeBehind(color,
+                          table.lookup(front_value, back_value,
+                                       segment.exit_t - segment.enter_t));
+          front_value = back_value;
+          if (color.alpha >= max_alpha) {
+            opaque[segment.ray].store(true, std::memory_order_relaxed);
+          }
+        }
+      }
+      if (!popped) std::this_thread::yield();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_traversal_threads + num_shading_threads);
+  try {
+    for (std::size_t t = 0; t < num_traversal_threads; ++t) {
+      threads.emplace_back(traverse, t);
+    }
+    for (std::size_t s = 0; s < num_shading_threads; ++s) {
+      threads.emplace_back(shade, s);
+    }
+    state.store(PIPELINE_RUNNING, std::memory_order_release);
+  } catch (const std::system_error &) {
+    state.store(PIPELINE_CANCELLED, std::memory_order_release);
+  }
+  for (std::thread &thread : threads) thread.join();
+  if (state.load(std::memory_order_relaxed) == PIPELINE_CANCELLED) {
+    for (const std::size_t i : ray_indices) {
+      colors[i] = compositeFrontToBack(rays.ray(i), field, table, t_begin,
+                                       t_end, max_alpha);
+    }
+  }
+  return colors;
+}
+
+}  // namespace svr
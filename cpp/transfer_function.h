@@ -0,0 +1,163 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_TRANSFERFUNCTION_H
+#define SPHERICAL_VOLUME_RENDERING_TRANSFERFUNCTION_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ray.h"
+#include "ray_batch.h"
+#include "spherical_volume_rendering_util.h"
+#include "spherical_voxel_field.h"
+
+namespace svr {
+
+// A color and opacity. Within a transfer function, (red, green, blue) is the
+// color of the medium and alpha is its extinction coefficient per unit
+// length. Once integrated over a segment, the color is premultiplied by the
+// segment's opacity, and alpha is the opacity within [0, 1].
+struct RGBA {
+  double red;
+  double green;
+  double blue;
+  double alpha;
+};
+
+// Maps scalar field values to RGBA. The control points are equally spaced
+// over [min_value, max_value], and linearly interpolated between. Values
+// outside the range are clamped.
+struct TransferFunction {
+  double min_value;
+  double max_value;
+  std::vector<RGBA> control_points;
+};
+
+// The resolution of a pre-integration table.
+struct PreIntegrationParameters {
+  // The number of front and back scalar values, equally spaced over the
+  // transfer function's range.
+  std::size_t num_scalar_samples;
+
+  // The number of segment lengths, equally spaced over
+  // [0, max_segment_length]. max_segment_length must be positive and finite;
+  // otherwise, a maximum length of 1 is used.
+  std::size_t num_length_samples;
+  double max_segment_length;
+
+  // The number of steps with which each segment is numerically integrated.
+  std::size_t num_integration_steps;
+
+  // The number of threads with which the table is built. If 0, the number of
+  // hardware threads is used.
+  std::size_t num_threads;
+};
+
+// A pre-integrated transfer function. For a segment along which the scalar
+// value varies linearly from its front value to its back value, the table
+// holds the color and opacity of the emission-absorption integral over the
+// segment. A ray is then composited with one lookup per traversed voxel,
+// rather than by oversampling each voxel. The table is built in parallel.
+class PreIntegrationTable {
+ public:
+  PreIntegrationTable(const TransferFunction &transfer_function,
+                      const PreIntegrationParameters &parameters) noexcept;
+
+  // Returns the integrated RGBA of a segment with the given front value, back
+  // value, and length. The table is interpolated trilinearly. A segment longer
+  // than max_segment_length is composited from equal pieces of at most that
+  // length. A segment of more than 1024 such pieces is composited from 1024
+  // pieces, each integrated as if it were max_segment_length long.
+  RGBA lookup(double front_value, double back_value,
+              double length) const noexcept;
+
+ private:
+  // Returns the table entry with the given indices.
+  inline const RGBA &entry(std::size_t front, std::size_t back,
+                           std::size_t length) const noexcept {
+    return this->table_[(length * num_scalar_samples_ + front) *
+                            num_scalar_samples_ +
+                        back];
+  }
+
+  // Similar to lookup(), for a length of at most max_segment_length_.
+  RGBA lookupWithinTable(double front_value, double back_value,
+                         double length) const noexcept;
+
+  double min_value_, value_range_;
+  std::size_t num_scalar_samples_, num_length_samples_;
+  double max_segment_length_;
+
+  // The entries, indexed by length, then front value, then back value.
+  std::vector<RGBA> table_;
+};
+
+// Caches pre-integration tables per transfer function, so each is built once
+// and shared by every ray composited with it. Safe to use from multiple
+// threads.
+class PreIntegrationCache {
+ public:
+  // Returns the table of the given transfer function and parameters,
+  // building it if it is not cached. num_threads does not affect the table.
+  std::shared_ptr<const PreIntegrationTable> table(
+      const TransferFunction &transfer_function,
+      const PreIntegrationParameters &parameters);
+
+  // Removes all cached tables. Tables in use remain valid.
+  void clear();
+
+ private:
+  std::mutex mutex_;
+
+  // The cached tables, keyed by their transfer function and parameters.
+  std::map<std::vector<double>, std::shared_ptr<const PreIntegrationTable>>
+      tables_;
+};
+
+// Composites the field along the given voxels of the ray front-to-back. The
+// voxels should be those of a windowed traversal, whose enter and exit times
+// are the times at which the ray crosses each voxel boundary. The field is
+// interpolated at each voxel boundary, and each voxel is composited as a
+// single pre-integrated segment between its front and back values. Returns
+// the premultiplied color and opacity of the ray.
+RGBA compositeFrontToBack(const Ray &ray, const SphericalVoxelField &field,
+                          const PreIntegrationTable &table,
+                          const std::vector<SphericalVoxel> &voxels) noexcept;
+
+// Similar to above, but traverses the window [t_begin, t_end] of the ray
+// itself. The traversal ends early once the opacity reaches max_alpha.
+RGBA compositeFrontToBack(const Ray &ray, const SphericalVoxelField &field,
+                          const PreIntegrationTable &table, double t_begin,
+                          double t_end, double max_alpha = 1.0) noexcept;
+
+// The thread split of a pipelined composite. Traversal threads walk the rays
+// and emit the voxel segments of each ray into single-producer,
+// single-consumer ring buffers, one per pair of traversal and shading
+// thread. Shading threads interpolate and composite the segments. Each
+// thread count is at least 1.
+struct PipelineParameters {
+  std::size_t num_traversal_threads;
+  std::size_t num_shading_threads;
+
+  // The number of segments pushed or popped at once.
+  std::size_t batch_size;
+
+  // The number of segments each ring buffer holds. A traversal thread waits
+  // while its ring buffer is full, so it runs at most this far ahead of its
+  // shading thread.
+  std::size_t queue_capacity;
+};
+
+// Similar to the windowed compositeFrontToBack(), but composites each ray of
+// the batch with the given pipeline, and returns the color of each ray. The
+// results are identical to those of compositing each ray on its own. If the
+// threads cannot be created, the rays are composited on the calling thread.
+std::vector<RGBA> compositeFrontToBack(
+    const RayBatch &rays, const SphericalVoxelField &field,
+    const PreIntegrationTable &table, double t_begin, double t_end,
+    double max_alpha, const PipelineParameters &parameters) noexcept;
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_TRANSFERFUNCTION_H
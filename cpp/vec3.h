@@ -180,7 +180,7 @@ inline BoundVec3 operator-(BoundVec3 v1, const FreeVec3 &v2) noexcept {
 
 // Represents a 3-dimensional unit vector, an abstraction over free vectors that
 // guarantees a length of 1. To prevent its length from changing, UnitVec3 does
-// not allow for mutations.
+// not allow for mutations. It may only be reassigned to another UnitVec3.
 struct UnitVec3 {
   inline explicit UnitVec3(double x, double y, double z)
       : UnitVec3(FreeVec3(x, y, z)) {}
@@ -203,7 +203,7 @@ struct UnitVec3 {
   }
 
  private:
-  const FreeVec3 inner_;
+  FreeVec3 inner_;
 };
 
 inline FreeVec3 operator*(const UnitVec3 &v, const double scalar) noexcept {
@@ -0,0 +1,204 @@
+#ifndef SPHERICAL_VOLUME_RENDERING_VOXELLAYOUT_H
+#define SPHERICAL_VOLUME_RENDERING_VOXELLAYOUT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "spherical_voxel_grid.h"
+
+namespace svr {
+
+// The orders in which the voxels of a grid may be laid out in memory.
+enum VoxelOrdering {
+  // The azimuthal voxels of each polar voxel are consecutive, and the shells
+  // are laid out from the outermost inward, i.e. the index of voxel
+  // (radial, polar, azimuthal) is
+  // ((radial - 1) * num_polar + polar) * num_azimuthal + azimuthal.
+  RADIAL_MAJOR = 0,
+
+  // The radial voxels of each angular voxel are consecutive, i.e. the index
+  // is (azimuthal * num_polar + polar) * num_radial + radial - 1. This suits
+  // rays that travel mostly radially.
+  AZIMUTHAL_MAJOR = 1,
+
+  // The voxels are grouped into cubic bricks of brick_size^3 voxels, which
+  // are laid out radial major, as are the voxels within each brick. A ray
+  // crossing a brick in any direction then reads a few contiguous runs. Each
+  // dimension is padded to a whole number of bricks.
+  BRICKED = 2
+};
+
+// Maps the voxels of a grid to linear indices of a value container. Each
+// ordering is a sum of one offset per dimension, so a traversal step that
+// changes a single voxel index changes a single offset. The offsets of a
+// strided ordering are computed with a multiplication, and those of a bricked
+// ordering are looked up in a table.
+class VoxelLayout {
+ public:
+  static constexpr std::size_t DEFAULT_BRICK_SIZE = 8;
+
+  VoxelLayout(std::size_t num_radial_sections, std::size_t num_polar_sections,
+              std::size_t num_azimuthal_sections,
+              VoxelOrdering ordering = RADIAL_MAJOR,
+              std::size_t brick_size = DEFAULT_BRICK_SIZE) noexcept
+      : ordering_(ordering),
+        brick_size_(ordering == BRICKED ? std::max(brick_size, std::size_t{1})
+                                        : 1),
+        radial_offsets_(num_radial_sections),
+        polar_offsets_(num_polar_sections),
+        azimuthal_offsets_(num_azimuthal_sections),
+        radial_stride_(0),
+        polar_stride_(0),
+        azimuthal_stride_(0) {
+    const std::size_t num_radial = num_radial_sections;
+    const std::size_t num_polar = num_polar_sections;
+    const std::size_t num_azimuthal = num_azimuthal_sections;
+    switch (ordering) {
+      case RADIAL_MAJOR:
+        radial_stride_ = num_polar * num_azimuthal;
+        polar_stride_ = num_azimuthal;
+        azimuthal_stride_ = 1;
+        break;
+      case AZIMUTHAL_MAJOR:
+        radial_stride_ = 1;
+        polar_stride_ = num_radial;
+        azimuthal_stride_ = num_polar * num_radial;
+        break;
+      case BRICKED: {
+        const std::size_t b = brick_size_;
+        const std::size_t brick_volume = b * b * b;
+        const std::size_t num_polar_bricks = (num_polar + b - 1) / b;
+        const std::size_t num_azimuthal_bricks = (num_azimuthal + b - 1) / b;
+        const std::size_t num_radial_bricks = (num_radial + b - 1) / b;
+        fillBrickedOffsets(
+            radial_offsets_, b * b,
+            num_polar_bricks * num_azimuthal_bricks * brick_volume);
+        fillBrickedOffsets(polar_offsets_, b,
+                           num_azimuthal_bricks * brick_volume);
+        fillBrickedOffsets(azimuthal_offsets_, 1, brick_volume);
+        size_ = num_radial_bricks * num_polar_bricks * num_azimuthal_bricks *
+                brick_volume;
+        break;
+      }
+    }
+    if (ordering != BRICKED) {
+      fillOffsets(radial_offsets_, radial_stride_);
+      fillOffsets(polar_offsets_, polar_stride_);
+      fillOffsets(azimuthal_offsets_, azimuthal_stride_);
+      size_ = num_radial * num_polar * num_azimuthal;
+    }
+  }
+
+  explicit VoxelLayout(const SphericalVoxelGrid &grid,
+                       VoxelOrdering ordering = RADIAL_MAJOR,
+                       std::size_t brick_size = DEFAULT_BRICK_SIZE) noexcept
+      : VoxelLayout(grid.numRadialSections(), grid.numPolarSections(),
+                    grid.numAzimuthalSections(), ordering, brick_size) {}
+
+  // The index of the voxel (radial, polar, azimuthal), where radial lies
+  // within [1, numRadialSections()] as in SphericalVoxel.
+  inline std::size_t index(int radial, int polar,
+                           int azimuthal) const noexcept {
+    return this->radialOffset(radial) + this->polarOffset(polar) +
+           this->azimuthalOffset(azimuthal);
+  }
+
+  // The offsets of each dimension, whose sum is the index of a voxel.
+  inline std::size_t radialOffset(int radial) const noexcept {
+    const std::size_t i = static_cast<std::size_t>(radial - 1);
+    return ordering_ == BRICKED ? this->radial_offsets_[i]
+                                : i * this->radial_stride_;
+  }
+
+  inline std::size_t polarOffset(int polar) const noexcept {
+    const std::size_t i = static_cast<std::size_t>(polar);
+    return ordering_ == BRICKED ? this->polar_offsets_[i]
+                                : i * this->polar_stride_;
+  }
+
+  inline std::size_t azimuthalOffset(int azimuthal) const noexcept {
+    const std::size_t i = static_cast<std::size_t>(azimuthal);
+    return ordering_ == BRICKED ? this->azimuthal_offsets_[i]
+                                : i * this->azimuthal_stride_;
+  }
+
+  // The offsets of every voxel of each dimension, where the radial offsets are
+  // indexed by radial - 1.
+  inline const std::vector<std::size_t> &radialOffsets() const noexcept {
+    return this->radial_offsets_;
+  }
+
+  inline const std::vector<std::size_t> &polarOffsets() const noexcept {
+    return this->polar_offsets_;
+  }
+
+  inline const std::vector<std::size_t> &azimuthalOffsets() const noexcept {
+    return this->azimuthal_offsets_;
+  }
+
+  // The number of indices, i.e. the size of a value container in this
+  // layout. This exceeds the number of voxels if the layout is padded.
+  inline std::size_t size() const noexcept { return this->size_; }
+
+  inline VoxelOrdering ordering() const noexcept { return this->ordering_; }
+
+  // The edge length of a brick, or 1 if the layout is not bricked.
+  inline std::size_t brickSize() const noexcept { return this->brick_size_; }
+
+  inline std::size_t numRadialSections() const noexcept {
+    return this->radial_offsets_.size();
+  }
+
+  inline std::size_t numPolarSections() const noexcept {
+    return this->polar_offsets_.size();
+  }
+
+  inline std::size_t numAzimuthalSections() const noexcept {
+    return this->azimuthal_offsets_.size();
+  }
+
+  inline bool operator==(const VoxelLayout &other) const noexcept {
+    return ordering_ == other.ordering_ && brick_size_ == other.brick_size_ &&
+           radial_offsets_ == other.radial_offsets_ &&
+           polar_offsets_ == other.polar_offsets_ &&
+           azimuthal_offsets_ == other.azimuthal_offsets_;
+  }
+
+  inline bool operator!=(const VoxelLayout &other) const noexcept {
+    return !(*this == other);
+  }
+
+ private:
+  // Sets offsets[i] to i * stride, for a dimension that is not bricked.
+  static void fillOffsets(std::vector<std::size_t> &offsets,
+                          std::size_t stride) noexcept {
+    for (std::size_t i = 0; i < offsets.size(); ++i) offsets[i] = i * stride;
+  }
+
+  // Sets the offset of voxel i within a bricked dimension, given the stride
+  // of the voxels within a brick and the stride of the bricks.
+  void fillBrickedOffsets(std::vector<std::size_t> &offsets,
+                          std::size_t voxel_stride,
+                          std::size_t brick_stride) const noexcept {
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+      offsets[i] = (i / brick_size_) * brick_stride +
+                   (i % brick_size_) * voxel_stride;
+    }
+  }
+
+  VoxelOrdering ordering_;
+  std::size_t brick_size_;
+  std::size_t size_;
+
+  // The offset of each radial, polar, and azimuthal voxel. The radial offsets
+  // are indexed by radial - 1.
+  std::vector<std::size_t> radial_offsets_, polar_offsets_, azimuthal_offsets_;
+
+  // The stride of each dimension, unless the ordering is BRICKED.
+  std::size_t radial_stride_, polar_stride_, azimuthal_stride_;
+};
+
+}  // namespace svr
+
+#endif  // SPHERICAL_VOLUME_RENDERING_VOXELLAYOUT_H